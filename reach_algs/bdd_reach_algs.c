@@ -75,11 +75,131 @@ partition_state(BDD s, BDDVAR topvar, BDD *s0, BDD *s1)
     }
 }
 
+/**
+ * Per-worker stack of BDD arrays, for the relations (and deadlock guards) of
+ * the next level in the recursion of the REACH functions. These arrays have
+ * an entry per relation on every level, which on the (8 MB) worker stack would overflow
+ * with many relations and deep BDDs. Tasks on a worker nest like calls (also
+ * the tasks that a worker steals while waiting in a SYNC), so the arrays are
+ * released in reverse order of allocation.
+ */
+#define ARENA_CHUNK 4096
+
+typedef struct arena_chunk {
+    struct arena_chunk *prev;
+    BDD *cur, *end;
+    BDD data[];
+} arena_chunk_t;
+
+static __thread arena_chunk_t *arena = NULL;
+static __thread arena_chunk_t *arena_spare = NULL; // last released chunk, reused
+
+static BDD*
+arena_alloc(size_t count)
+{
+    arena_chunk_t *c = arena;
+    if (c == NULL || (size_t)(c->end - c->cur) < count) {
+        arena_chunk_t *next = arena_spare;
+        arena_spare = NULL;
+        if (next == NULL || (size_t)(next->end - next->data) < count) {
+            free(next);
+            size_t size = count > ARENA_CHUNK ? count : ARENA_CHUNK;
+            next = (arena_chunk_t*)malloc(sizeof(arena_chunk_t) + sizeof(BDD[size]));
+            next->end = next->data + size;
+        }
+        next->prev = c;
+        next->cur = next->data;
+        arena = c = next;
+    }
+    BDD *res = c->cur;
+    c->cur += count;
+    return res;
+}
+
+/* Release ptr (the last array allocated on this worker) and everything after it */
+static void
+arena_release(BDD *ptr)
+{
+    arena_chunk_t *c = arena;
+    c->cur = ptr;
+    if (c->cur == c->data && c->prev != NULL) {
+        arena = c->prev;
+        free(arena_spare);
+        arena_spare = c;
+    }
+}
+
+/**
+ * Set by go_rec when it finds a reachable deadlock; checked by all go_rec
+ * calls that look for deadlocks so that they return as soon as possible.
+ */
+static volatile int reach_deadlock_found = 0;
+
+TASK_IMPL_3(BDD, bdd_guard_deadlocks, BDD, s, const BDD*, g, int, n)
+{
+    BDD res = s;
+    bdd_refs_pushptr(&res);
+    for (int i = 0; i < n && res != sylvan_false; i++) res = sylvan_diff(res, g[i]);
+    bdd_refs_popptr(1);
+    return res;
+}
+
+/* Does s contain a state outside of the guards? */
+static inline int
+has_deadlock(BDD s, const bdd_guards_t *guards)
+{
+    if (guards == NULL) return 0;
+    return bdd_guard_deadlocks(s, guards->g, guards->n) != sylvan_false;
+}
+
+/* The first variable of the guards (or level if that comes first) */
+static inline BDDVAR
+guards_level(const bdd_guards_t *guards, BDDVAR level)
+{
+    if (guards == NULL) return level;
+    for (int i = 0; i < guards->n; i++) {
+        if (sylvan_isconst(guards->g[i])) continue;
+        BDDVAR v = sylvan_var(guards->g[i]);
+        if (v < level) level = v;
+    }
+    return level;
+}
+
+/**
+ * Cofactor of the guards for value b of the variable at level, with the
+ * guards stored in buf (room for guards->n). Guards that are false there are
+ * dropped, keeping at least one so that every state is a deadlock. If a guard
+ * is true, every state is enabled and NULL is returned (nothing to check).
+ * The cofactors are reachable from the guards, which the caller protects.
+ */
+static const bdd_guards_t*
+cofactor_guards(const bdd_guards_t *guards, BDDVAR level, int b, BDD *buf, bdd_guards_t *res)
+{
+    if (guards == NULL) return NULL;
+    res->g = buf;
+    res->n = 0;
+    for (int i = 0; i < guards->n; i++) {
+        BDD g0, g1;
+        partition_state(guards->g[i], level, &g0, &g1);
+        BDD g = b ? g1 : g0;
+        if (g == sylvan_true) return NULL;
+        if (g != sylvan_false) buf[res->n++] = g;
+    }
+    if (res->n == 0) buf[res->n++] = sylvan_false;
+    return res;
+}
+
 /**
  * ReachBDD: Implementation of recursive reachability algorithm for a single 
  * global relation.
+ *
+ * If guards is not NULL, the search stops as soon as a state outside of all
+ * guards is reached. The result then contains such a deadlock state, but is
+ * not necessarily the full reachable set. Results are only cached when the
+ * search was not cut short, and are then the full reachable set whatever the
+ * guards, so the guards are not part of the cache key.
  */
-TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
+TASK_IMPL_5(BDD, go_rec, BDD, s, BDD, r, const bdd_guards_t*, guards, BDDSET, vars, bool, par)
 {
     /* Terminal cases */
     if (s == sylvan_false) return sylvan_false; // empty.R* = empty
@@ -87,6 +207,10 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
     if (s == sylvan_true || r == sylvan_true) return sylvan_true;
     // all.r* = all, s.all* = all (if s is not empty)
 
+    /* Another call already found a deadlock */
+    const int check = guards != NULL;
+    if (check && reach_deadlock_found) return s;
+
     /* Consult cache */
     int cachenow = 1;
     if (cachenow) {
@@ -102,9 +226,10 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
 
     BDDVAR vs = ns ? bddnode_getvariable(ns) : 0xffffffff;
     BDDVAR vr = nr ? bddnode_getvariable(nr) : 0xffffffff;
-    BDDVAR level = vs < vr ? vs : vr;
+    BDDVAR level = guards_level(guards, vs < vr ? vs : vr);
+    level &= ~1; // r may skip the unprimed variable of the top pair
 
-    /* Relations, states, and vars for next level of recursion */
+    /* Relations, states, guards, and vars for next level of recursion */
     BDD r00, r01, r10, r11, s0, s1;
     BDDSET next_vars = sylvan_set_next(vars);
     bdd_refs_pushptr(&next_vars);
@@ -112,6 +237,11 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
     partition_rel(r, level, &r00, &r01, &r10, &r11);
     partition_state(s, level, &s0, &s1);
 
+    BDD *gbuf = check ? arena_alloc(2*guards->n) : NULL;
+    bdd_guards_t g0, g1;
+    const bdd_guards_t *e0 = cofactor_guards(guards, level, 0, gbuf, &g0);
+    const bdd_guards_t *e1 = cofactor_guards(guards, level, 1, gbuf + (check ? guards->n : 0), &g1);
+
     bdd_refs_pushptr(&s0);
     bdd_refs_pushptr(&s1);
     bdd_refs_pushptr(&r00);
@@ -130,16 +260,23 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
 
         if (!par) {
             // sequential calls (in specific order)
-            s0 = CALL(go_rec, s0, r00, next_vars, par);
+            s0 = CALL(go_rec, s0, r00, e0, next_vars, par);
+            if (check && has_deadlock(s0, e0)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
             s1 = sylvan_or(s1, sylvan_relnext(s0, r01, next_vars));
-            s1 = CALL(go_rec, s1, r11, next_vars, par);
+            s1 = CALL(go_rec, s1, r11, e1, next_vars, par);
+            if (check && has_deadlock(s1, e1)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
             s0 = sylvan_or(s0, sylvan_relnext(s1, r10, next_vars));
         }
         else { // par
             // 2 recursive REACH calls in parallel
-            bdd_refs_spawn(SPAWN(go_rec, s0, r00, next_vars, par));
-            s1 = CALL(go_rec, s1, r11, next_vars, par);
+            bdd_refs_spawn(SPAWN(go_rec, s0, r00, e0, next_vars, par));
+            s1 = CALL(go_rec, s1, r11, e1, next_vars, par);
             s0 = bdd_refs_sync(SYNC(go_rec)); // syncs s0 = s0.r00*
+            if (check && (has_deadlock(s0, e0) || has_deadlock(s1, e1)))
+                reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
 
             // 2 relnext calls in parallel
             bdd_refs_spawn(SPAWN(sylvan_relnext, s0, r01, next_vars, 0));
@@ -158,11 +295,13 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
     }
 
     bdd_refs_popptr(9);
+    if (gbuf) arena_release(gbuf);
 
     /* res = ((!level) ^ s0)  v  ((level) ^ s1) */
     BDD res = sylvan_makenode(level, s0, s1);
 
-    /* Put in cache */
+    /* Put in cache (unless the search was cut short) */
+    if (check && reach_deadlock_found) cachenow = 0;
     if (cachenow)
         cache_put3(CACHE_BDD_REACH, s, r, 0, res);
 
@@ -170,6 +309,18 @@ TASK_IMPL_4(BDD, go_rec, BDD, s, BDD, r, BDDSET, vars, bool, par)
 }
 
 
+BDD
+bdd_reach_deadlocks(BDD s, BDD r, const BDD *g, int n, BDDSET vars, bool par, bool *found)
+{
+    const bdd_guards_t guards = {g, n};
+    reach_deadlock_found = 0;
+    BDD res = RUN(go_rec, s, r, &guards, vars, par);
+    *found = reach_deadlock_found || has_deadlock(res, &guards);
+    reach_deadlock_found = 0;
+    return res;
+}
+
+
 /**
  * Implementation of recursive reachability algorithm for a partial relation
  * over given vars.
@@ -230,6 +381,8 @@ TASK_IMPL_3(BDD, go_rec_partial, BDD, s, BDD, r, BDDSET, vars)
     BDD res;
 
     if (is_s_or_t) {
+        level &= ~1; // r may skip the unprimed variable of the top pair
+
         /* Relations, states, and vars for next level of recursion */
         BDD r00, r01, r10, r11, s0, s1;
         //BDDSET next_vars = sylvan_set_next(vars);
@@ -345,6 +498,471 @@ TASK_IMPL_3(BDD, go_rec_partial, BDD, s, BDD, r, BDDSET, vars)
     return res;
 }
 
+/**
+ * Partition a relation in the implicit identity encoding into r00, r01, r10,
+ * and r11: a skipped pair is the identity, and an explicit identity on the
+ * pair means that the pair is unconstrained.
+ */
+static void
+partition_rel_id(BDD r, BDDVAR topvar, BDD *r00, BDD *r01, BDD *r10, BDD *r11)
+{
+    partition_rel(r, topvar, r00, r01, r10, r11);
+    if (*r00 == *r01 && *r00 == *r10 && *r00 == *r11) {
+        *r01 = *r10 = sylvan_false;
+    } else if (*r01 == sylvan_false && *r10 == sylvan_false && *r00 == *r11) {
+        *r01 = *r10 = *r00;
+    }
+}
+
+/**
+ * Inverse of partition_rel_id: build the relation for the pair (level,
+ * level+1) from its four cofactors, which the caller keeps referenced.
+ */
+static BDD
+make_rel_id(BDDVAR level, BDD r00, BDD r01, BDD r10, BDD r11)
+{
+    if (r01 == sylvan_false && r10 == sylvan_false && r00 == r11) return r00;
+    if (r00 == r01 && r00 == r10 && r00 == r11) r01 = r10 = sylvan_false;
+
+    BDD low = bdd_refs_push(sylvan_makenode(level+1, r00, r01));
+    BDD high = sylvan_makenode(level+1, r10, r11);
+    bdd_refs_push(high);
+    BDD res = sylvan_makenode(level, low, high);
+    bdd_refs_pop(2);
+    return res;
+}
+
+
+TASK_IMPL_2(BDD, bdd_rel_identity, BDD, r, BDDSET, vars)
+{
+    /* Terminal cases */
+    if (r == sylvan_false) return sylvan_false;
+    if (sylvan_set_isempty(vars)) return sylvan_true; // quantify the rest
+
+    /* Consult cache */
+    BDD res;
+    if (cache_get3(CACHE_BDD_REL_IDENTITY, r, vars, 0, &res)) {
+        return res;
+    }
+
+    /* The next pair in vars */
+    BDDVAR level = sylvan_set_first(vars) & ~1;
+    BDDSET next_vars = vars;
+    while (!sylvan_set_isempty(next_vars) && sylvan_set_first(next_vars) <= level+1) {
+        next_vars = sylvan_set_next(next_vars);
+    }
+
+    /* Quantify variables above the pair that are not in vars */
+    BDD q = r;
+    bdd_refs_pushptr(&q);
+    while (!sylvan_isconst(q) && sylvan_var(q) < level) {
+        q = sylvan_or(sylvan_low(q), sylvan_high(q));
+    }
+
+    BDD r00, r01, r10, r11;
+    partition_rel(q, level, &r00, &r01, &r10, &r11);
+
+    bdd_refs_spawn(SPAWN(bdd_rel_identity, r00, next_vars));
+    bdd_refs_spawn(SPAWN(bdd_rel_identity, r01, next_vars));
+    bdd_refs_spawn(SPAWN(bdd_rel_identity, r10, next_vars));
+    BDD e11 = bdd_refs_push(CALL(bdd_rel_identity, r11, next_vars));
+    BDD e10 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_identity)));
+    BDD e01 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_identity)));
+    BDD e00 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_identity)));
+
+    res = make_rel_id(level, e00, e01, e10, e11);
+    bdd_refs_pop(4);
+    bdd_refs_popptr(1);
+
+    /* Put in cache */
+    cache_put3(CACHE_BDD_REL_IDENTITY, r, vars, 0, res);
+
+    return res;
+}
+
+
+TASK_IMPL_2(BDD, bdd_rel_union_id, BDD, a, BDD, b)
+{
+    /* Terminal cases */
+    if (a == sylvan_false || a == b) return b;
+    if (b == sylvan_false) return a;
+
+    /* Consult cache (union is commutative) */
+    if (a > b) {
+        BDD t = a;
+        a = b;
+        b = t;
+    }
+    BDD res;
+    if (cache_get3(CACHE_BDD_REL_UNION_ID, a, b, 0, &res)) {
+        return res;
+    }
+
+    /* Determine top level (sylvan_true is the identity on all pairs) */
+    BDDVAR va = sylvan_isconst(a) ? 0xffffffff : sylvan_var(a);
+    BDDVAR vb = sylvan_isconst(b) ? 0xffffffff : sylvan_var(b);
+    BDDVAR level = (va < vb ? va : vb) & ~1;
+
+    BDD a00, a01, a10, a11, b00, b01, b10, b11;
+    partition_rel_id(a, level, &a00, &a01, &a10, &a11);
+    partition_rel_id(b, level, &b00, &b01, &b10, &b11);
+
+    bdd_refs_spawn(SPAWN(bdd_rel_union_id, a00, b00));
+    bdd_refs_spawn(SPAWN(bdd_rel_union_id, a01, b01));
+    bdd_refs_spawn(SPAWN(bdd_rel_union_id, a10, b10));
+    BDD u11 = bdd_refs_push(CALL(bdd_rel_union_id, a11, b11));
+    BDD u10 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_union_id)));
+    BDD u01 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_union_id)));
+    BDD u00 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_rel_union_id)));
+
+    res = make_rel_id(level, u00, u01, u10, u11);
+    bdd_refs_pop(4);
+
+    /* Put in cache */
+    cache_put3(CACHE_BDD_REL_UNION_ID, a, b, 0, res);
+
+    return res;
+}
+
+
+TASK_IMPL_2(BDD, bdd_relnext_id, BDD, s, BDD, r)
+{
+    /* Terminal cases */
+    if (s == sylvan_false || r == sylvan_false) return sylvan_false;
+    if (r == sylvan_true) return s; // identity on all remaining pairs
+
+    /* Consult cache */
+    BDD res;
+    if (cache_get3(CACHE_BDD_RELNEXT_ID, s, r, 0, &res)) {
+        return res;
+    }
+
+    /* Determine top level */
+    BDDVAR vs = sylvan_isconst(s) ? 0xffffffff : sylvan_var(s);
+    BDDVAR vr = sylvan_var(r);
+    BDDVAR level = (vs < vr ? vs : vr) & ~1;
+
+    BDD r00, r01, r10, r11, s0, s1;
+    partition_rel_id(r, level, &r00, &r01, &r10, &r11);
+    partition_state(s, level, &s0, &s1);
+
+    bdd_refs_spawn(SPAWN(bdd_relnext_id, s0, r00));
+    bdd_refs_spawn(SPAWN(bdd_relnext_id, s1, r10));
+    bdd_refs_spawn(SPAWN(bdd_relnext_id, s0, r01));
+    BDD t11 = bdd_refs_push(CALL(bdd_relnext_id, s1, r11));
+    BDD t01 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_relnext_id)));
+    BDD t10 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_relnext_id)));
+    BDD t00 = bdd_refs_push(bdd_refs_sync(SYNC(bdd_relnext_id)));
+
+    /* Successors with level = 0 and with level = 1 */
+    BDD t0 = bdd_refs_push(sylvan_or(t00, t10));
+    BDD t1 = bdd_refs_push(sylvan_or(t01, t11));
+    res = sylvan_makenode(level, t0, t1);
+    bdd_refs_pop(6);
+
+    /* Put in cache */
+    cache_put3(CACHE_BDD_RELNEXT_ID, s, r, 0, res);
+
+    return res;
+}
+
+
+/**
+ * ReachBDD for a full-domain relation in the implicit identity encoding, e.g.
+ * the union of partial relations converted with bdd_rel_identity.
+ */
+TASK_IMPL_4(BDD, go_rec_id, BDD, s, BDD, r, const bdd_guards_t*, guards, bool, par)
+{
+    /* Terminal cases */
+    if (s == sylvan_false) return sylvan_false; // empty.R* = empty
+    if (r == sylvan_false || r == sylvan_true) return s; // s.I* = s
+    if (s == sylvan_true) return sylvan_true; // all.r* = all
+
+    /* Another call already found a deadlock */
+    const int check = guards != NULL;
+    if (check && reach_deadlock_found) return s;
+
+    /* Consult cache */
+    int cachenow = 1;
+    if (cachenow) {
+        BDD res;
+        if (cache_get3(CACHE_BDD_REACH_ID, s, r, 0, &res)) {
+            return res;
+        }
+    }
+
+    /* Determine top level */
+    BDDVAR level = sylvan_var(s);
+    BDDVAR vr = sylvan_var(r);
+    if (vr < level) level = vr;
+    level = guards_level(guards, level);
+    level &= ~1;
+
+    /* Relations, states, and guards for next level of recursion */
+    BDD r00, r01, r10, r11, s0, s1;
+    partition_rel_id(r, level, &r00, &r01, &r10, &r11);
+    partition_state(s, level, &s0, &s1);
+
+    BDD *gbuf = check ? arena_alloc(2*guards->n) : NULL;
+    bdd_guards_t g0, g1;
+    const bdd_guards_t *e0 = cofactor_guards(guards, level, 0, gbuf, &g0);
+    const bdd_guards_t *e1 = cofactor_guards(guards, level, 1, gbuf + (check ? guards->n : 0), &g1);
+
+    bdd_refs_pushptr(&s0);
+    bdd_refs_pushptr(&s1);
+
+    BDD prev0 = sylvan_false;
+    BDD prev1 = sylvan_false;
+    bdd_refs_pushptr(&prev0);
+    bdd_refs_pushptr(&prev1);
+
+    while (s0 != prev0 || s1 != prev1) {
+        prev0 = s0;
+        prev1 = s1;
+
+        if (!par) {
+            // sequential calls (in specific order)
+            s0 = CALL(go_rec_id, s0, r00, e0, par);
+            if (check && has_deadlock(s0, e0)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+            s1 = sylvan_or(s1, CALL(bdd_relnext_id, s0, r01));
+            s1 = CALL(go_rec_id, s1, r11, e1, par);
+            if (check && has_deadlock(s1, e1)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+            s0 = sylvan_or(s0, CALL(bdd_relnext_id, s1, r10));
+        }
+        else { // par
+            // 2 recursive REACH calls in parallel
+            bdd_refs_spawn(SPAWN(go_rec_id, s0, r00, e0, par));
+            s1 = CALL(go_rec_id, s1, r11, e1, par);
+            s0 = bdd_refs_sync(SYNC(go_rec_id));
+            if (check && (has_deadlock(s0, e0) || has_deadlock(s1, e1)))
+                reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+
+            // 2 relnext calls in parallel
+            bdd_refs_spawn(SPAWN(bdd_relnext_id, s0, r01));
+            BDD t0 = CALL(bdd_relnext_id, s1, r10);
+            bdd_refs_push(t0);
+            BDD t1 = bdd_refs_sync(SYNC(bdd_relnext_id));
+            bdd_refs_push(t1);
+
+            // 2 or's in parallel ( or is implemented via !(!A ^ !B) )
+            bdd_refs_spawn(SPAWN(sylvan_and, sylvan_not(s0), sylvan_not(t0), 0));
+            s1 = sylvan_not(CALL(sylvan_and, sylvan_not(s1), sylvan_not(t1), 0));
+            s0 = sylvan_not(bdd_refs_sync(SYNC(sylvan_and)));
+
+            bdd_refs_pop(2); // pops t0, t1
+        }
+    }
+
+    bdd_refs_popptr(4);
+    if (gbuf) arena_release(gbuf);
+
+    /* res = ((!level) ^ s0)  v  ((level) ^ s1) */
+    BDD res = sylvan_makenode(level, s0, s1);
+
+    /* Put in cache (unless the search was cut short) */
+    if (check && reach_deadlock_found) cachenow = 0;
+    if (cachenow)
+        cache_put3(CACHE_BDD_REACH_ID, s, r, 0, res);
+
+    return res;
+}
+
+
+BDD
+bdd_reach_id_deadlocks(BDD s, BDD r, const BDD *g, int n, bool par, bool *found)
+{
+    const bdd_guards_t guards = {g, n};
+    reach_deadlock_found = 0;
+    BDD res = RUN(go_rec_id, s, r, &guards, par);
+    *found = reach_deadlock_found || has_deadlock(res, &guards);
+    reach_deadlock_found = 0;
+    return res;
+}
+
+/**
+ * Successors of s under the union of the n partial relations r[i] over
+ * vars[i], computed as a parallel union of images.
+ */
+TASK_4(BDD, relnext_multi, BDD, s, const BDD*, r, const BDDSET*, vars, int, n)
+{
+    if (n == 0 || s == sylvan_false) return sylvan_false;
+    if (n == 1) return sylvan_relnext(s, r[0], vars[0]);
+
+    bdd_refs_spawn(SPAWN(relnext_multi, s, r, vars, n/2));
+    BDD right = bdd_refs_push(CALL(relnext_multi, s, r+n/2, vars+n/2, n-n/2));
+    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(relnext_multi)));
+    BDD res = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return res;
+}
+
+/**
+ * Hash of the relations r[0..n-1] with their variable sets (with two
+ * different seeds) to identify a relation set in the cache. As in go_rec, the
+ * guards are not part of the key.
+ */
+static inline uint64_t
+multi_rel_hash(const BDD *r, const BDDSET *vars, int n, uint64_t seed)
+{
+    uint64_t h = seed * 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < n; i++) {
+        h = (h ^ r[i]) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+        h = (h ^ vars[i]) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/* The variables of a relation below the pair (level, level+1) */
+static inline BDDSET
+vars_after(BDDSET vars, BDDVAR level)
+{
+    while (!sylvan_set_isempty(vars) && sylvan_set_first(vars) <= level+1) {
+        vars = sylvan_set_next(vars);
+    }
+    return vars;
+}
+
+TASK_IMPL_6(BDD, go_rec_multi, BDD, s, const BDD*, r, const BDDSET*, vars, int, n, const bdd_guards_t*, guards, bool, par)
+{
+    /* Terminal cases */
+    if (s == sylvan_false) return sylvan_false; // empty.R* = empty
+    if (n == 0) return s; // s.I* = s
+    if (s == sylvan_true) return sylvan_true; // all.R* = all
+
+    /* Another call already found a deadlock */
+    const int check = guards != NULL;
+    if (check && reach_deadlock_found) return s;
+
+    /* Consult cache */
+    uint64_t h1 = multi_rel_hash(r, vars, n, 0x2545F4914F6CDD1DULL);
+    uint64_t h2 = multi_rel_hash(r, vars, n, 0x9E3779B97F4A7C15ULL);
+    BDD res;
+    if (cache_get3(CACHE_BDD_REACH_MULTI, s, h1, h2, &res)) {
+        return res;
+    }
+
+    /* Determine top level: the first pair of s, the guards, or any relation */
+    BDDVAR level = guards_level(guards, sylvan_var(s));
+    for (int i = 0; i < n; i++) {
+        if (sylvan_set_isempty(vars[i])) continue;
+        BDDVAR v = sylvan_set_first(vars[i]);
+        if (v < level) level = v;
+    }
+    level &= ~1;
+
+    /**
+     * Relations for next level of recursion. Relations that do not touch
+     * this pair are the identity on it, relations that end are the identity
+     * on all remaining pairs and are dropped from the diagonal blocks.
+     */
+    BDD *r00 = arena_alloc(8*n), *r01 = r00 + n, *r10 = r01 + n, *r11 = r10 + n;
+    BDDSET *v00 = r11 + n, *v01 = v00 + n, *v10 = v01 + n, *v11 = v10 + n;
+    int n00 = 0, n01 = 0, n10 = 0, n11 = 0;
+    for (int i = 0; i < n; i++) {
+        if (r[i] == sylvan_false || sylvan_set_isempty(vars[i])) continue;
+        if ((sylvan_set_first(vars[i]) & ~1) != level) {
+            r00[n00] = r11[n11] = r[i];
+            v00[n00++] = v11[n11++] = vars[i];
+            continue;
+        }
+        BDD q00, q01, q10, q11;
+        partition_rel(r[i], level, &q00, &q01, &q10, &q11);
+        BDDSET next_vars = vars_after(vars[i], level);
+        if (!sylvan_set_isempty(next_vars)) {
+            if (q00 != sylvan_false) { r00[n00] = q00; v00[n00++] = next_vars; }
+            if (q11 != sylvan_false) { r11[n11] = q11; v11[n11++] = next_vars; }
+        }
+        if (q01 != sylvan_false) { r01[n01] = q01; v01[n01++] = next_vars; }
+        if (q10 != sylvan_false) { r10[n10] = q10; v10[n10++] = next_vars; }
+    }
+
+    BDD s0, s1;
+    partition_state(s, level, &s0, &s1);
+
+    BDD *gbuf = check ? arena_alloc(2*guards->n) : NULL;
+    bdd_guards_t g0, g1;
+    const bdd_guards_t *e0 = cofactor_guards(guards, level, 0, gbuf, &g0);
+    const bdd_guards_t *e1 = cofactor_guards(guards, level, 1, gbuf + (check ? guards->n : 0), &g1);
+
+    bdd_refs_pushptr(&s0);
+    bdd_refs_pushptr(&s1);
+
+    BDD prev0 = sylvan_false;
+    BDD prev1 = sylvan_false;
+    bdd_refs_pushptr(&prev0);
+    bdd_refs_pushptr(&prev1);
+
+    while (s0 != prev0 || s1 != prev1) {
+        prev0 = s0;
+        prev1 = s1;
+
+        if (!par) {
+            // sequential calls (in specific order)
+            s0 = CALL(go_rec_multi, s0, r00, v00, n00, e0, par);
+            if (check && has_deadlock(s0, e0)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+            s1 = sylvan_or(s1, CALL(relnext_multi, s0, r01, v01, n01));
+            s1 = CALL(go_rec_multi, s1, r11, v11, n11, e1, par);
+            if (check && has_deadlock(s1, e1)) reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+            s0 = sylvan_or(s0, CALL(relnext_multi, s1, r10, v10, n10));
+        }
+        else { // par
+            // 2 recursive REACH calls in parallel
+            bdd_refs_spawn(SPAWN(go_rec_multi, s0, r00, v00, n00, e0, par));
+            s1 = CALL(go_rec_multi, s1, r11, v11, n11, e1, par);
+            s0 = bdd_refs_sync(SYNC(go_rec_multi));
+            if (check && (has_deadlock(s0, e0) || has_deadlock(s1, e1)))
+                reach_deadlock_found = 1;
+            if (check && reach_deadlock_found) break;
+
+            // 2 image calls in parallel
+            bdd_refs_spawn(SPAWN(relnext_multi, s0, r01, v01, n01));
+            BDD t0 = CALL(relnext_multi, s1, r10, v10, n10);
+            bdd_refs_push(t0);
+            BDD t1 = bdd_refs_sync(SYNC(relnext_multi));
+            bdd_refs_push(t1);
+
+            // 2 or's in parallel ( or is implemented via !(!A ^ !B) )
+            bdd_refs_spawn(SPAWN(sylvan_and, sylvan_not(s0), sylvan_not(t0), 0));
+            s1 = sylvan_not(CALL(sylvan_and, sylvan_not(s1), sylvan_not(t1), 0));
+            s0 = sylvan_not(bdd_refs_sync(SYNC(sylvan_and)));
+
+            bdd_refs_pop(2); // pops t0, t1
+        }
+    }
+
+    bdd_refs_popptr(4);
+    if (gbuf) arena_release(gbuf);
+    arena_release(r00);
+
+    /* res = ((!level) ^ s0)  v  ((level) ^ s1) */
+    res = sylvan_makenode(level, s0, s1);
+
+    /* Put in cache (unless the search was cut short) */
+    if (!(check && reach_deadlock_found))
+        cache_put3(CACHE_BDD_REACH_MULTI, s, h1, h2, res);
+
+    return res;
+}
+
+
+BDD
+bdd_reach_multi_deadlocks(BDD s, const BDD *r, const BDDSET *vars, int n, const BDD *g, int n_guards, bool par, bool *found)
+{
+    const bdd_guards_t guards = {g, n_guards};
+    reach_deadlock_found = 0;
+    BDD res = RUN(go_rec_multi, s, r, vars, n, &guards, par);
+    *found = reach_deadlock_found || has_deadlock(res, &guards);
+    reach_deadlock_found = 0;
+    return res;
+}
+
 TASK_IMPL_5(BDD, go_bfs_plain, BDD, s, BDD, r, BDD, t, BDDSET, vars, int*, steps) 
 {
     BDD reachable = s;
@@ -374,3 +992,238 @@ TASK_IMPL_5(BDD, go_bfs_plain, BDD, s, BDD, r, BDD, t, BDDSET, vars, int*, steps
 
     return reachable;
 }
+
+
+void bdd_conj_rel_init(bdd_conj_rel_t *rel, const BDD *r, int n, BDDSET vars)
+{
+    rel->n = n;
+    rel->r = malloc(sizeof(BDD) * (n > 0 ? n : 1));
+    rel->quant = malloc(sizeof(BDDSET) * (n > 0 ? n : 1));
+    rel->prime_map = sylvan_map_empty();
+    sylvan_protect(&rel->prime_map);
+    for (int i = 0; i < n; i++) {
+        rel->r[i] = r[i];
+        rel->quant[i] = sylvan_set_empty();
+        sylvan_protect(&rel->r[i]);
+        sylvan_protect(&rel->quant[i]);
+    }
+
+    size_t nstate = sylvan_set_count(vars);
+    uint32_t state_vars[nstate];
+    sylvan_set_toarray(vars, state_vars);
+
+    // supports of all partitions
+    BDDSET supp[n > 0 ? n : 1];
+    uint32_t max_var = nstate ? state_vars[nstate-1] + 1 : 0;
+    for (int i = 0; i < n; i++) {
+        supp[i] = sylvan_support(rel->r[i]);
+        bdd_refs_push(supp[i]);
+        size_t count = sylvan_set_count(supp[i]);
+        if (count) {
+            uint32_t supp_vars[count];
+            sylvan_set_toarray(supp[i], supp_vars);
+            if (supp_vars[count-1] > max_var) max_var = supp_vars[count-1];
+        }
+    }
+
+    // for every variable, the last partition that mentions it
+    int last[max_var + 1];
+    for (uint32_t v = 0; v <= max_var; v++) last[v] = -1;
+    for (int i = 0; i < n; i++) {
+        size_t count = sylvan_set_count(supp[i]);
+        uint32_t supp_vars[count > 0 ? count : 1];
+        sylvan_set_toarray(supp[i], supp_vars);
+        for (size_t k = 0; k < count; k++) last[supp_vars[k]] = i;
+    }
+    bdd_refs_pop(n);
+
+    // primed state variables are renamed, all others are quantified
+    for (size_t k = 0; k < nstate; k++) {
+        uint32_t v = state_vars[k];
+        if (n > 0 && last[v] == -1) {
+            rel->quant[0] = sylvan_set_add(rel->quant[0], v);
+        }
+        last[v+1] = -1;
+        BDD unprimed = bdd_refs_push(sylvan_ithvar(v));
+        rel->prime_map = sylvan_map_add(rel->prime_map, v+1, unprimed);
+        bdd_refs_pop(1);
+    }
+    for (uint32_t v = 0; v <= max_var; v++) {
+        if (last[v] != -1) {
+            rel->quant[last[v]] = sylvan_set_add(rel->quant[last[v]], v);
+        }
+    }
+}
+
+
+void bdd_conj_rel_free(bdd_conj_rel_t *rel)
+{
+    for (int i = 0; i < rel->n; i++) {
+        sylvan_unprotect(&rel->r[i]);
+        sylvan_unprotect(&rel->quant[i]);
+    }
+    sylvan_unprotect(&rel->prime_map);
+    free(rel->r);
+    free(rel->quant);
+    rel->n = 0;
+}
+
+
+TASK_IMPL_3(BDD, bdd_conj_image, BDD, s, const BDD*, r, const bdd_conj_rel_t*, rel)
+{
+    if (s == sylvan_false) return sylvan_false;
+    if (rel->n == 0) return sylvan_true; // the empty conjunction relates all states
+
+    BDD res = s;
+    bdd_refs_pushptr(&res);
+    for (int i = 0; i < rel->n && res != sylvan_false; i++) {
+        res = CALL(sylvan_and_exists, res, r[i], rel->quant[i], 0);
+    }
+    res = CALL(sylvan_compose, res, rel->prime_map, 0);
+    bdd_refs_popptr(1);
+    return res;
+}
+
+
+/**
+ * Hash of the BDDs in r[0..n-1] (with two different seeds) to identify a
+ * set of partitions in the operation cache.
+ */
+static inline uint64_t
+conj_rel_hash(const BDD *r, int n, uint64_t seed)
+{
+    uint64_t h = seed;
+    for (int i = 0; i < n; i++) {
+        h = (h ^ r[i]) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/**
+ * Like go_rec, but for a relation given as conjunctive partitions: all
+ * partitions are cofactored per level, and the monolithic relation is never
+ * built.
+ */
+TASK_IMPL_4(BDD, go_rec_conj, BDD, s, const BDD*, r, const bdd_conj_rel_t*, rel, bool, par)
+{
+    int n = rel->n;
+
+    /* Terminal cases */
+    if (s == sylvan_false) return sylvan_false;
+    int all_true = 1;
+    for (int i = 0; i < n; i++) {
+        if (r[i] == sylvan_false) return s;
+        if (r[i] != sylvan_true) all_true = 0;
+    }
+    if (s == sylvan_true || all_true) return sylvan_true;
+
+    /* Consult cache */
+    uint64_t h1 = conj_rel_hash(r, n, 0x2545F4914F6CDD1DULL);
+    uint64_t h2 = conj_rel_hash(r, n, 0x9E3779B97F4A7C15ULL);
+    BDD res;
+    if (cache_get3(CACHE_BDD_REACH_CONJ, s, h1, h2, &res)) {
+        return res;
+    }
+
+    /* Determine top level (an unprimed variable) */
+    BDDVAR level = sylvan_var(s);
+    for (int i = 0; i < n; i++) {
+        if (!sylvan_isconst(r[i])) {
+            BDDVAR v = sylvan_var(r[i]);
+            if (v < level) level = v;
+        }
+    }
+    level &= ~1;
+
+    /* Relations and states for next level of recursion */
+    BDD *r00 = arena_alloc(4*n), *r01 = r00 + n, *r10 = r01 + n, *r11 = r10 + n;
+    for (int i = 0; i < n; i++) {
+        partition_rel(r[i], level, &r00[i], &r01[i], &r10[i], &r11[i]);
+    }
+    BDD s0, s1;
+    partition_state(s, level, &s0, &s1);
+
+    bdd_refs_pushptr(&s0);
+    bdd_refs_pushptr(&s1);
+
+    BDD prev0 = sylvan_false;
+    BDD prev1 = sylvan_false;
+    bdd_refs_pushptr(&prev0);
+    bdd_refs_pushptr(&prev1);
+
+    while (s0 != prev0 || s1 != prev1) {
+        prev0 = s0;
+        prev1 = s1;
+
+        if (!par) {
+            // sequential calls (in specific order)
+            s0 = CALL(go_rec_conj, s0, r00, rel, par);
+            s1 = sylvan_or(s1, CALL(bdd_conj_image, s0, r01, rel));
+            s1 = CALL(go_rec_conj, s1, r11, rel, par);
+            s0 = sylvan_or(s0, CALL(bdd_conj_image, s1, r10, rel));
+        }
+        else { // par
+            // 2 recursive REACH calls in parallel
+            bdd_refs_spawn(SPAWN(go_rec_conj, s0, r00, rel, par));
+            s1 = CALL(go_rec_conj, s1, r11, rel, par);
+            s0 = bdd_refs_sync(SYNC(go_rec_conj));
+
+            // 2 image calls in parallel
+            bdd_refs_spawn(SPAWN(bdd_conj_image, s0, r01, rel));
+            BDD t0 = CALL(bdd_conj_image, s1, r10, rel);
+            bdd_refs_push(t0);
+            BDD t1 = bdd_refs_sync(SYNC(bdd_conj_image));
+            bdd_refs_push(t1);
+
+            // 2 or's in parallel ( or is implemented via !(!A ^ !B) )
+            bdd_refs_spawn(SPAWN(sylvan_and, sylvan_not(s0), sylvan_not(t0), 0));
+            s1 = sylvan_not(CALL(sylvan_and, sylvan_not(s1), sylvan_not(t1), 0));
+            s0 = sylvan_not(bdd_refs_sync(SYNC(sylvan_and)));
+
+            bdd_refs_pop(2); // pops t0, t1
+        }
+    }
+
+    bdd_refs_popptr(4);
+    arena_release(r00);
+
+    /* res = ((!level) ^ s0)  v  ((level) ^ s1) */
+    res = sylvan_makenode(level, s0, s1);
+
+    /* Put in cache */
+    cache_put3(CACHE_BDD_REACH_CONJ, s, h1, h2, res);
+
+    return res;
+}
+
+
+TASK_IMPL_4(BDD, go_bfs_conj, BDD, s, const bdd_conj_rel_t*, rel, BDD, t, int*, steps)
+{
+    BDD reachable = s;
+    BDD prev = sylvan_false;
+    BDD successors = sylvan_false;
+
+    sylvan_protect(&reachable);
+    sylvan_protect(&prev);
+    sylvan_protect(&successors);
+
+    int k = 0;
+    while (prev != reachable) {
+        k++;
+        prev = reachable;
+        successors = CALL(bdd_conj_image, reachable, rel->r, rel);
+        reachable = sylvan_or(reachable, successors);
+
+        if (sylvan_and(t, reachable)) {
+            *steps = k;
+            break;
+        }
+    }
+
+    sylvan_unprotect(&reachable);
+    sylvan_unprotect(&prev);
+    sylvan_unprotect(&successors);
+
+    return reachable;
+}
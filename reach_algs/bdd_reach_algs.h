@@ -7,14 +7,121 @@ namespace sylvan {
 extern "C" {
 #endif /* __cplusplus */
 
-TASK_DECL_4(BDD, go_rec, BDD, BDD, BDDSET, bool);
-#define bdd_reach(S, R, vars) RUN(go_rec, S, R, vars, 0)
+/**
+ * Guards for deadlock detection: g[i] is the set of states (over the unprimed
+ * variables) that have a successor in group i, e.g. the projection of that
+ * group on the unprimed variables. A state is a deadlock if it is in none of
+ * them. The guards are checked one at a time and never combined into one set,
+ * which can be far larger than all guards together.
+ */
+typedef struct bdd_guards {
+    const BDD *g;
+    int n;
+} bdd_guards_t;
+
+/* The states in s that are in none of the guards g[0..n-1] */
+TASK_DECL_3(BDD, bdd_guard_deadlocks, BDD, const BDD*, int);
+#define bdd_guard_deadlocks(s, g, n) RUN(bdd_guard_deadlocks, s, g, n)
+
+/* REACH of S under R; guards is NULL unless deadlocks are checked */
+TASK_DECL_5(BDD, go_rec, BDD, BDD, const bdd_guards_t*, BDDSET, bool);
+#define bdd_reach(S, R, vars) RUN(go_rec, S, R, NULL, vars, 0)
+
+/**
+ * REACH with on-the-fly deadlock detection against the guards g[0..n-1] of
+ * the groups of r. Stops as soon as a reachable state outside of all guards
+ * is found and sets *found; the result then contains that state. Otherwise
+ * the result is the full reachable set.
+ */
+BDD bdd_reach_deadlocks(BDD s, BDD r, const BDD *g, int n, BDDSET vars, bool par, bool *found);
 
 TASK_DECL_3(BDD, go_rec_partial, BDD, BDD, BDDSET);
 
+/**
+ * Relations with implicit identity ("copy") semantics, the BDD analogue of
+ * copy nodes in LDDs. Such a relation is read per pair of unprimed/primed
+ * state variables: a skipped pair is the identity on that pair, and a pair
+ * with cofactors (X, false, false, X) leaves both variables unconstrained.
+ * All other pairs have their usual meaning. A partial relation thus needs no
+ * s=s' chain for the variables it does not touch, and the relations of
+ * different groups can be merged without extending them to the full domain.
+ *
+ * bdd_rel_identity converts a relation over `vars` (interleaved unprimed and
+ * primed variables, as used by sylvan_relnext) to this encoding; variables
+ * of r outside of vars are quantified. Variable pairs outside of vars become
+ * identity, as they are for sylvan_relnext.
+ */
+TASK_DECL_2(BDD, bdd_rel_identity, BDD, BDDSET);
+#define bdd_rel_identity(r, vars) RUN(bdd_rel_identity, r, vars)
+
+/* Union of two relations in the implicit identity encoding */
+TASK_DECL_2(BDD, bdd_rel_union_id, BDD, BDD);
+#define bdd_rel_union_id(a, b) RUN(bdd_rel_union_id, a, b)
+
+/* Successors of s under a relation in the implicit identity encoding */
+TASK_DECL_2(BDD, bdd_relnext_id, BDD, BDD);
+#define bdd_relnext_id(s, r) RUN(bdd_relnext_id, s, r)
+
+/* Like go_rec, for a full-domain relation in the implicit identity encoding */
+TASK_DECL_4(BDD, go_rec_id, BDD, BDD, const bdd_guards_t*, bool);
+#define bdd_reach_id(S, R) RUN(go_rec_id, S, R, NULL, 0)
+
+/* Like bdd_reach_deadlocks, for a relation in the implicit identity encoding */
+BDD bdd_reach_id_deadlocks(BDD s, BDD r, const BDD *g, int n, bool par, bool *found);
+
+/**
+ * REACH for the union of n partial relations r[i] over variables vars[i]
+ * (interleaved unprimed and primed, identity elsewhere), without building the
+ * union. At every level each relation is split into its 2x2 blocks, and the
+ * relations that are empty in a block are dropped from that block. The arrays
+ * must stay alive during the call. As in go_rec, the search stops at the
+ * first reachable state outside of the guards unless guards is NULL.
+ */
+TASK_DECL_6(BDD, go_rec_multi, BDD, const BDD*, const BDDSET*, int, const bdd_guards_t*, bool);
+#define bdd_reach_multi(S, R, vars, n) RUN(go_rec_multi, S, R, vars, n, NULL, 0)
+
+/* Like bdd_reach_deadlocks, for the union of n partial relations */
+BDD bdd_reach_multi_deadlocks(BDD s, const BDD *r, const BDDSET *vars, int n, const BDD *g, int n_guards, bool par, bool *found);
+
 TASK_DECL_5(BDD, go_bfs_plain, BDD, BDD, BDD, BDDSET, int*);
 #define simple_bfs(S, R, T, vars, steps) RUN(go_bfs_plain, S, R, T, vars, steps)
 
+/**
+ * Transition relation given as a conjunction r[0] ^ ... ^ r[n-1] of
+ * partitions over interleaved unprimed/primed state variables (plus
+ * auxiliary variables below them). Images are computed with an
+ * and-exists schedule: after conjoining r[i], the variables in quant[i]
+ * (those that no later partition mentions) are quantified, and finally
+ * prime_map renames the primed variables to unprimed ones.
+ */
+typedef struct bdd_conj_rel {
+    int n;
+    BDD *r;
+    BDDSET *quant;
+    BDDMAP prime_map;
+} bdd_conj_rel_t;
+
+/**
+ * Copy the n partitions in r (which the caller keeps alive during this call)
+ * and compute the quantification schedule for state variables `vars`.
+ * All BDDs in `rel` are protected until bdd_conj_rel_free.
+ */
+void bdd_conj_rel_init(bdd_conj_rel_t *rel, const BDD *r, int n, BDDSET vars);
+void bdd_conj_rel_free(bdd_conj_rel_t *rel);
+
+/**
+ * Successors of s under the conjunction of the partitions r[0..n-1], which
+ * are either rel->r or cofactors thereof.
+ */
+TASK_DECL_3(BDD, bdd_conj_image, BDD, const BDD*, const bdd_conj_rel_t*);
+#define bdd_image_conj(s, rel) RUN(bdd_conj_image, s, (rel)->r, rel)
+
+TASK_DECL_4(BDD, go_rec_conj, BDD, const BDD*, const bdd_conj_rel_t*, bool);
+#define bdd_reach_conj(S, rel) RUN(go_rec_conj, S, (rel)->r, rel, 0)
+
+TASK_DECL_4(BDD, go_bfs_conj, BDD, const bdd_conj_rel_t*, BDD, int*);
+#define simple_bfs_conj(S, rel, T, steps) RUN(go_bfs_conj, S, rel, T, steps)
+
 #ifdef __cplusplus
 }
 }
@@ -17,6 +17,9 @@
 
 #include "getrss.h"
 #include "cache_op_ids.h"
+#include "exact_count.h"
+#include "group_deps.h"
+#include "stats_file.h"
 
 /* Configuration (via argp) */
 static int report_levels = 0; // report states at end of every level
@@ -24,13 +27,19 @@ static int report_table = 0; // report table size at end of every level
 static int report_nodes = 0; // report number of nodes of BDDs
 static int strategy = 0; // 0 = BFS, 1 = PAR, 2 = SAT, 3 = CHAINING, 4 = REC
 static int loop_order = 0; // 0 = sequential, 10 = parallel
-static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly (only bfs/par)
+static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly (bfs/par/rec)
 static int merge_relations = 0; // merge relations to 1 relation
+static int implicit_identity = 0; // merge relations without extending them (skipped pairs are identity)
 static int print_transition_matrix = 0; // print transition relation matrix
 static int workers = 0; // autodetect
 static char* model_filename = NULL; // filename of model
 static char* stats_filename = NULL; // filename of csv stats output file
 static char* matrix_filename = NULL; // no reach, just log TS relation matrix
+static size_t size_hint = 0; // expected peak number of nodes (0 = peaknodes from the stats file, if any)
+static int resize_policy = 0; // 0 = build default, 1 = aggressive, 2 = normal
+static char* gc_log_filename = NULL; // filename of csv log with a row per garbage collection
+static int compact_gc = 0; // compacting garbage collection after loading and between levels
+static int cache_priority = 0; // protect REACH results in the operation cache
 #ifdef HAVE_PROFILER
 static char* profile_filename = NULL; // filename for profiling
 #endif
@@ -66,9 +75,15 @@ static struct argp_option options[] =
     {"count-states", 1, 0, 0, "Report #states at each level", 1},
     {"count-table", 2, 0, 0, "Report table usage at each level", 1},
     {"merge-relations", 6, 0, 0, "Merge transition relations into one transition relation", 1},
+    {"implicit-identity", 9, 0, 0, "Merge relations without extending them, skipped variables are copied (rec, bfs-plain)", 1},
     {"print-matrix", 4, 0, 0, "Print transition matrix", 1},
     {"write-matrix", 8, "FILENAME", 0, "Write transition matrix to given file", 0},
     {"statsfile", 7, "FILENAME", 0, "Write stats to given filename (or append if exists)", 0},
+    {"size-hint", 10, "<nodes>", 0, "Expected peak number of nodes, grows the initial table sizes (default: peaknodes of previous runs in the stats file)", 0},
+    {"resize", 11, "<aggressive|normal>", 0, "Growth policy of the nodes table and cache (default: build setting)", 0},
+    {"gc-log", 12, "FILENAME", 0, "Write a row per garbage collection to given filename (or append if exists)", 0},
+    {"compact", 13, 0, 0, "Renumber the nodes in depth-first order after loading the relations and, when garbage was collected, after a level (bfs, par)", 1},
+    {"cache-priority", 14, 0, 0, "Put REACH results in the operation cache with priority, so cheaper results do not evict them (rec)", 1},
     {0, 0, 0, 0, 0, 0}
 };
 static error_t
@@ -111,9 +126,30 @@ parse_opt(int key, char *arg, struct argp_state *state)
     case 6:
         merge_relations = 1;
         break;
+    case 9:
+        merge_relations = 1;
+        implicit_identity = 1;
+        break;
     case 7:
         stats_filename = arg;
         break;
+    case 10:
+        size_hint = strtoull(arg, NULL, 10);
+        break;
+    case 11:
+        if (strcmp(arg, "aggressive")==0) resize_policy = 1;
+        else if (strcmp(arg, "normal")==0) resize_policy = 2;
+        else argp_usage(state);
+        break;
+    case 12:
+        gc_log_filename = arg;
+        break;
+    case 13:
+        compact_gc = 1;
+        break;
+    case 14:
+        cache_priority = 1;
+        break;
     case 8:
         print_transition_matrix = 1;
         matrix_filename = arg;
@@ -159,15 +195,22 @@ static int actionbits; // number of bits for action label
 static int totalbits; // total number of bits
 static int next_count; // number of partitions of the transition relation
 static rel_t *next; // each partition of the transition relation
+static int guard_count; // number of groups with a guard (next_count before merging)
+static BDD *guards; // states with a successor per group, only computed when checking for deadlocks
 
 typedef struct stats {
     double reach_time;
     double merge_rel_time;
     double total_time;
-    double final_states;
+    char *final_states; // exact count, as a decimal string
     int found_deadlock; // is set to 1 if found
     size_t final_nodecount;
-    size_t peaknodes;
+    size_t peaknodes; // largest table fill before garbage collection (if counted) or at the end
+    size_t gcs; // number of garbage collections
+    size_t compactions; // number of compacting garbage collections
+    double gc_time; // total pause time of garbage collections
+    double gc_max_pause;
+    double gc_clear_cache_time, gc_mark_time, gc_compact_time, gc_resize_time, gc_rehash_time;
 } stats_t;
 stats_t stats = {0};
 
@@ -205,6 +248,9 @@ print_memory_usage(void)
     INFO("Memory usage: %s\n", buf);
 }
 
+/* Columns of the stats file; rows are only appended to files with the same header */
+static const char *stats_header = "benchmark, strategy, merg_rels, workers, reach_time, merge_time, total_time, final_states, deadlocks, final_nodecount, peaknodes, gcs, gc_time, gc_max_pause";
+
 static void
 write_stats()
 {
@@ -213,10 +259,10 @@ write_stats()
     fseek (fp, 0, SEEK_END);
         long size = ftell(fp);
         if (size == 0)
-            fprintf(fp, "%s\n", "benchmark, strategy, merg_rels, workers, reach_time, merge_time, total_time, final_states, deadlocks, final_nodecount, peaknodes");
+            fprintf(fp, "%s\n", stats_header);
     // append stats of this run
     char* benchname = basename((char*)model_filename);
-    fprintf(fp, "%s, %d, %d, %d, %f, %f, %f, %0.0f, %d, %ld, %ld\n",
+    fprintf(fp, "%s, %d, %d, %d, %f, %f, %f, %s, %d, %ld, %ld, %ld, %f, %f\n",
             benchname,
             strategy+loop_order,
             merge_relations,
@@ -227,10 +273,48 @@ write_stats()
             stats.final_states,
             stats.found_deadlock,
             stats.final_nodecount,
-            stats.peaknodes);
+            stats.peaknodes,
+            stats.gcs,
+            stats.gc_time,
+            stats.gc_max_pause);
     fclose(fp);
 }
 
+static FILE *gc_log = NULL;
+static const char *gc_trigger_names[] = {"explicit", "table-full", "compact"};
+
+static const char *gc_log_header = "benchmark, gc, trigger, timestamp, time, clear_cache_time, mark_time, resize_time, rehash_time, nodes_before, nodes_after, table_before, table_after, compact_time";
+
+/**
+ * Open the per-GC log for appending, and write the header if it is empty
+ */
+static void
+open_gc_log()
+{
+    if (!stats_header_matches(gc_log_filename, gc_log_header))
+        Abort("The columns of '%s' differ from this version, use a new file!\n", gc_log_filename);
+    gc_log = fopen(gc_log_filename, "a");
+    if (gc_log == NULL) Abort("Cannot open file '%s'!\n", gc_log_filename);
+    fseek(gc_log, 0, SEEK_END);
+    if (ftell(gc_log) == 0)
+        fprintf(gc_log, "%s\n", gc_log_header);
+}
+
+/**
+ * With --compact, renumber the live nodes in depth-first order (sylvan_gc_compact).
+ * Only called where all BDDs in use are protected. Skipped if there was no garbage
+ * collection since the previous compaction, since the new nodes are then still
+ * stored in the order in which they were created.
+ */
+static size_t compact_gc_number = (size_t)-1;
+
+VOID_TASK_0(compact_nodes)
+{
+    if (!compact_gc || sylvan_gc_last_info()->number == compact_gc_number) return;
+    CALL(sylvan_gc_compact);
+    compact_gc_number = sylvan_gc_last_info()->number;
+}
+
 /**
  * Load a set from file
  * The expected binary format:
@@ -384,6 +468,38 @@ VOID_TASK_2(print_example, BDD, example, BDDSET, variables)
     }
 }
 
+/* Dependencies between transition groups, see group_deps.h */
+static char *group_deps = NULL; // group_deps[k*next_count+j]: j depends on k (or j == k)
+
+static void
+init_group_deps(void)
+{
+    group_proj_t proj[next_count];
+    for (int i=0; i<next_count; i++) {
+        proj[i] = (group_proj_t){next[i]->r_k, next[i]->w_k, next[i]->r_proj, next[i]->w_proj};
+    }
+    group_deps = compute_group_deps(proj, next_count);
+}
+
+/**
+ * The set extended with its successors under the groups first, ...,
+ * first+count-1, computed in parallel and combined with a parallel union
+ */
+TASK_3(BDD, relnext_batch, BDD, set, int, first, int, count)
+{
+    if (count == 1) return sylvan_relnext_union(set, next[first]->bdd, next[first]->variables, set);
+
+    bdd_refs_spawn(SPAWN(relnext_batch, set, first, count/2));
+    BDD right = bdd_refs_push(CALL(relnext_batch, set, first+count/2, count-count/2));
+    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(relnext_batch)));
+    BDD result = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return result;
+}
+
+/* Number of intermediate sets of a fixpoint that are stored in the cache */
+#define SAT_CACHE_STEPS 16
+
 /**
  * Implementation of (parallel) saturation
  * (assumes relations are ordered on first variable)
@@ -400,11 +516,6 @@ TASK_2(BDD, go_sat, BDD, set, int, idx)
     if (cache_get3(CACHE_BDD_SAT, _set, idx, 0, &result)) return result;
     mtbdd_refs_pushptr(&_set);
 
-    /**
-     * Possible improvement: cache more things (like intermediate results?)
-     *   and chain-apply more of the current level before going deeper?
-     */
-
     /* Check if the relation should be applied */
     const uint32_t var = sylvan_var(next[idx]->variables);
     if (set == sylvan_true || var <= sylvan_var(set)) {
@@ -415,26 +526,36 @@ TASK_2(BDD, go_sat, BDD, set, int, idx)
         /*
          * Compute until fixpoint:
          * - SAT deeper
-         * - chain-apply all current level once
+         * - chain-apply all current level once, to the states found in the last round
+         * - SAT deeper only the new states
+         * The intermediate sets all saturate to the same result, so they are cached as well.
          */
-        BDD prev = sylvan_false;
-        BDD step = sylvan_false;
+        BDD steps[SAT_CACHE_STEPS];
+        int n_steps = 0;
+        BDD front = sylvan_false;
         mtbdd_refs_pushptr(&set);
-        mtbdd_refs_pushptr(&prev);
-        mtbdd_refs_pushptr(&step);
-        while (prev != set) {
-            prev = set;
-            // SAT deeper
-            set = CALL(go_sat, set, idx+count);
-            // chain-apply all current level once
-            for (int i=0;i<count;i++) {
-                step = sylvan_relnext(set, next[idx+i]->bdd, next[idx+i]->variables);
-                set = sylvan_or(set, step);
-                step = sylvan_false; // unset, for gc
+        mtbdd_refs_pushptr(&front);
+        set = CALL(go_sat, set, idx+count);
+        front = set;
+        for (;;) {
+            if (set != _set && n_steps < SAT_CACHE_STEPS) steps[n_steps++] = mtbdd_refs_push(set);
+            // chain-apply all current level once, independent groups in parallel
+            for (int i=0;i<count;) {
+                int n = independent_run(group_deps, next_count, idx+i, idx+count);
+                front = CALL(relnext_batch, front, idx+i, n);
+                i += n;
             }
+            front = sylvan_diff(front, set);
+            if (front == sylvan_false) break;
+            // SAT deeper, only the new states
+            front = CALL(go_sat, front, idx+count);
+            front = sylvan_diff(front, set);
+            set = sylvan_or(set, front);
         }
-        mtbdd_refs_popptr(3);
         result = set;
+        for (int i=0; i<n_steps; i++) cache_put3(CACHE_BDD_SAT, steps[i], idx, 0, result);
+        mtbdd_refs_pop(n_steps);
+        mtbdd_refs_popptr(2);
     } else {
         /* Recursive computation */
         mtbdd_refs_spawn(SPAWN(go_sat, sylvan_low(set), idx));
@@ -462,49 +583,21 @@ VOID_TASK_1(sat, set_t, set)
  * Implement parallel strategy (that performs the relnext operations in parallel)
  * This function does one level...
  */
-TASK_5(BDD, go_par, BDD, cur, BDD, visited, size_t, from, size_t, len, BDD*, deadlocks)
+TASK_4(BDD, go_par, BDD, cur, BDD, visited, size_t, from, size_t, len)
 {
     if (len == 1) {
         // Calculate NEW successors (not in visited)
-        BDD succ = sylvan_relnext(cur, next[from]->bdd, next[from]->variables);
-        bdd_refs_push(succ);
-        if (deadlocks) {
-            // check which BDDs in deadlocks do not have a successor in this relation
-            BDD anc = sylvan_relprev(next[from]->bdd, succ, next[from]->variables);
-            bdd_refs_push(anc);
-            *deadlocks = sylvan_diff(*deadlocks, anc);
-            bdd_refs_pop(1);
-        }
-        BDD result = sylvan_diff(succ, visited);
-        bdd_refs_pop(1);
-        return result;
+        return sylvan_relnext_minus(cur, next[from]->bdd, next[from]->variables, visited);
     } else {
-        BDD deadlocks_left;
-        BDD deadlocks_right;
-        if (deadlocks) {
-            deadlocks_left = *deadlocks;
-            deadlocks_right = *deadlocks;
-            sylvan_protect(&deadlocks_left);
-            sylvan_protect(&deadlocks_right);
-        }
-
         // Recursively calculate left+right
-        bdd_refs_spawn(SPAWN(go_par, cur, visited, from, (len+1)/2, deadlocks ? &deadlocks_left: NULL));
-        BDD right = bdd_refs_push(CALL(go_par, cur, visited, from+(len+1)/2, len/2, deadlocks ? &deadlocks_right : NULL));
+        bdd_refs_spawn(SPAWN(go_par, cur, visited, from, (len+1)/2));
+        BDD right = bdd_refs_push(CALL(go_par, cur, visited, from+(len+1)/2, len/2));
         BDD left = bdd_refs_push(bdd_refs_sync(SYNC(go_par)));
 
         // Merge results of left+right
         BDD result = sylvan_or(left, right);
         bdd_refs_pop(2);
 
-        if (deadlocks) {
-            bdd_refs_push(result);
-            *deadlocks = sylvan_and(deadlocks_left, deadlocks_right);
-            sylvan_unprotect(&deadlocks_left);
-            sylvan_unprotect(&deadlocks_right);
-            bdd_refs_pop(1);
-        }
-
         return result;
     }
 }
@@ -528,30 +621,34 @@ VOID_TASK_1(par, set_t, set)
     do {
         // calculate successors in parallel
         cur_level = next_level;
-        deadlocks = cur_level;
-
-        next_level = CALL(go_par, cur_level, visited, 0, next_count, check_deadlocks ? &deadlocks : NULL);
 
-        if (check_deadlocks && deadlocks != sylvan_false) {
-            INFO("Found %'0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
+        if (check_deadlocks) {
+            // states in the current level without a successor
+            deadlocks = bdd_guard_deadlocks(cur_level, guards, guard_count);
             if (deadlocks != sylvan_false) {
+                INFO("Found %'0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
                 printf("example: ");
                 print_example(deadlocks, set->variables);
                 check_deadlocks = 0;
                 stats.found_deadlock = 1;
+                printf("\n");
             }
-            printf("\n");
         }
 
+        next_level = CALL(go_par, cur_level, visited, 0, next_count);
+
         // visited = visited + new
         visited = sylvan_or(visited, next_level);
+        CALL(compact_nodes);
 
         if (report_table && report_levels) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %'0.0f states explored, table: %0.1f%% full (%'zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored, table: %0.1f%% full (%'zu nodes)\n",
+                iteration, count,
                 100.0*(double)filled/total, filled);
+            free(count);
         } else if (report_table) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
@@ -559,7 +656,9 @@ VOID_TASK_1(par, set_t, set)
                 iteration,
                 100.0*(double)filled/total, filled);
         } else if (report_levels) {
-            INFO("Level %d done, %'0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored\n", iteration, count);
+            free(count);
         } else {
             INFO("Level %d done\n", iteration);
         }
@@ -578,50 +677,22 @@ VOID_TASK_1(par, set_t, set)
  * Implement sequential strategy (that performs the relnext operations one by one)
  * This function does one level...
  */
-TASK_5(BDD, go_bfs, BDD, cur, BDD, visited, size_t, from, size_t, len, BDD*, deadlocks)
+TASK_4(BDD, go_bfs, BDD, cur, BDD, visited, size_t, from, size_t, len)
 {
     if (len == 1) {
         // Calculate NEW successors (not in visited)
-        BDD succ = sylvan_relnext(cur, next[from]->bdd, next[from]->variables);
-        bdd_refs_push(succ);
-        if (deadlocks) {
-            // check which BDDs in deadlocks do not have a successor in this relation
-            BDD anc = sylvan_relprev(next[from]->bdd, succ, next[from]->variables);
-            bdd_refs_push(anc);
-            *deadlocks = sylvan_diff(*deadlocks, anc);
-            bdd_refs_pop(1);
-        }
-        BDD result = sylvan_diff(succ, visited);
-        bdd_refs_pop(1);
-        return result;
+        return sylvan_relnext_minus(cur, next[from]->bdd, next[from]->variables, visited);
     } else {
-        BDD deadlocks_left;
-        BDD deadlocks_right;
-        if (deadlocks) {
-            deadlocks_left = *deadlocks;
-            deadlocks_right = *deadlocks;
-            sylvan_protect(&deadlocks_left);
-            sylvan_protect(&deadlocks_right);
-        }
-
         // Recursively calculate left+right
-        BDD left = CALL(go_bfs, cur, visited, from, (len+1)/2, deadlocks ? &deadlocks_left : NULL);
+        BDD left = CALL(go_bfs, cur, visited, from, (len+1)/2);
         bdd_refs_push(left);
-        BDD right = CALL(go_bfs, cur, visited, from+(len+1)/2, len/2, deadlocks ? &deadlocks_right : NULL);
+        BDD right = CALL(go_bfs, cur, visited, from+(len+1)/2, len/2);
         bdd_refs_push(right);
 
         // Merge results of left+right
         BDD result = sylvan_or(left, right);
         bdd_refs_pop(2);
 
-        if (deadlocks) {
-            bdd_refs_push(result);
-            *deadlocks = sylvan_and(deadlocks_left, deadlocks_right);
-            sylvan_unprotect(&deadlocks_left);
-            sylvan_unprotect(&deadlocks_right);
-            bdd_refs_pop(1);
-        }
-
         return result;
     }
 }
@@ -645,30 +716,34 @@ VOID_TASK_1(bfs, set_t, set)
     do {
         // calculate successors in parallel
         cur_level = next_level;
-        deadlocks = cur_level;
-
-        next_level = CALL(go_bfs, cur_level, visited, 0, next_count, check_deadlocks ? &deadlocks : NULL);
 
-        if (check_deadlocks && deadlocks != sylvan_false) {
-            INFO("Found %'0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
+        if (check_deadlocks) {
+            // states in the current level without a successor
+            deadlocks = bdd_guard_deadlocks(cur_level, guards, guard_count);
             if (deadlocks != sylvan_false) {
+                INFO("Found %'0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
                 printf("example: ");
                 print_example(deadlocks, set->variables);
                 check_deadlocks = 0;
                 stats.found_deadlock = 1;
+                printf("\n");
             }
-            printf("\n");
         }
 
+        next_level = CALL(go_bfs, cur_level, visited, 0, next_count);
+
         // visited = visited + new
         visited = sylvan_or(visited, next_level);
+        CALL(compact_nodes);
 
         if (report_table && report_levels) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %'0.0f states explored, table: %0.1f%% full (%'zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored, table: %0.1f%% full (%'zu nodes)\n",
+                iteration, count,
                 100.0*(double)filled/total, filled);
+            free(count);
         } else if (report_table) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
@@ -676,7 +751,9 @@ VOID_TASK_1(bfs, set_t, set)
                 iteration,
                 100.0*(double)filled/total, filled);
         } else if (report_levels) {
-            INFO("Level %d done, %'0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored\n", iteration, count);
+            free(count);
         } else {
             INFO("Level %d done\n", iteration);
         }
@@ -691,39 +768,81 @@ VOID_TASK_1(bfs, set_t, set)
     sylvan_unprotect(&deadlocks);
 }
 
+/**
+ * Apply the pairwise independent groups batch[0..n-1] in parallel, each to
+ * the states it has not seen yet. The new states of group k are stored in
+ * succ[k]; returns their union.
+ */
+TASK_5(BDD, chain_batch, const int*, batch, int, n, BDD, visited, BDD*, seen, BDD*, succ)
+{
+    if (n == 1) {
+        const int k = batch[0];
+        BDD todo = bdd_refs_push(sylvan_diff(visited, seen[k]));
+        seen[k] = visited;
+        succ[k] = sylvan_relnext_minus(todo, next[k]->bdd, next[k]->variables, visited);
+        bdd_refs_pop(1);
+        return succ[k];
+    }
+
+    bdd_refs_spawn(SPAWN(chain_batch, batch, n/2, visited, seen, succ));
+    BDD right = bdd_refs_push(CALL(chain_batch, batch+n/2, n-n/2, visited, seen, succ));
+    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(chain_batch)));
+    BDD result = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return result;
+}
+
 /**
  * Implementation of the Chaining strategy (does not support deadlock detection)
+ * Every pass applies each scheduled group once to the states it has not seen
+ * yet; a group that produces new states schedules its dependent groups (see
+ * group_sched_t). Consecutive independent groups are applied in parallel.
  */
 VOID_TASK_1(chaining, set_t, set)
 {
     BDD visited = set->bdd;
-    BDD next_level = visited;
     BDD succ = sylvan_false;
 
     bdd_refs_pushptr(&visited);
-    bdd_refs_pushptr(&next_level);
     bdd_refs_pushptr(&succ);
 
+    // seen[k] is the set of visited states when group k was last applied
+    BDD seen[next_count], new_states[next_count];
+    for (int k=0; k<next_count; k++) {
+        seen[k] = new_states[k] = sylvan_false;
+        bdd_refs_pushptr(&seen[k]);
+        bdd_refs_pushptr(&new_states[k]);
+    }
+
+    group_sched_t sched;
+    sched_init(&sched, group_deps, next_count);
+    const int *batch = sched.batch;
+
     int iteration = 1;
     do {
-        // calculate successors in parallel
-        for (int i=0; i<next_count; i++) {
-            succ = sylvan_relnext(next_level, next[i]->bdd, next[i]->variables);
-            next_level = sylvan_or(next_level, succ);
+        for (int k=0; k<next_count; k++) {
+            if (!sched.cur[k]) continue;
+            int n = sched_take_batch(&sched, k);
+
+            succ = CALL(chain_batch, batch, n, visited, seen, new_states);
+            if (succ != sylvan_false) {
+                visited = sylvan_or(visited, succ);
+            }
+            for (int b=0; b<n; b++) {
+                if (new_states[batch[b]] != sylvan_false) sched_dependents(&sched, batch[b], 1);
+                new_states[batch[b]] = sylvan_false; // reset, for gc
+            }
             succ = sylvan_false; // reset, for gc
         }
 
-        // new = new - visited
-        // visited = visited + new
-        next_level = sylvan_diff(next_level, visited);
-        visited = sylvan_or(visited, next_level);
-
         if (report_table && report_levels) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %'0.0f states explored, table: %0.1f%% full (%'zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored, table: %0.1f%% full (%'zu nodes)\n",
+                iteration, count,
                 100.0*(double)filled/total, filled);
+            free(count);
         } else if (report_table) {
             size_t filled, total;
             sylvan_table_usage(&filled, &total);
@@ -731,15 +850,19 @@ VOID_TASK_1(chaining, set_t, set)
                 iteration,
                 100.0*(double)filled/total, filled);
         } else if (report_levels) {
-            INFO("Level %d done, %'0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
+            char *count = bdd_exact_satcount_str(visited, set->variables);
+            INFO("Level %d done, %s states explored\n", iteration, count);
+            free(count);
         } else {
             INFO("Level %d done\n", iteration);
         }
         iteration++;
-    } while (next_level != sylvan_false);
+    } while (sched_next_pass(&sched));
+
+    sched_free(&sched);
 
     set->bdd = visited;
-    bdd_refs_popptr(3);
+    bdd_refs_popptr(2 + 2*next_count);
 }
 
 /**
@@ -831,7 +954,8 @@ VOID_TASK_1(bfs_plain, set_t, set)
 
     while (prev != visited) {
         prev = visited;
-        successors = sylvan_relnext(visited,  next[0]->bdd, set->variables);
+        if (implicit_identity) successors = bdd_relnext_id(visited, next[0]->bdd);
+        else successors = sylvan_relnext(visited,  next[0]->bdd, set->variables);
         visited = sylvan_or(visited, successors);
     }
 
@@ -854,54 +978,116 @@ prime_variables(BDD a)
     return sylvan_makenode(new_var, l, h);
 }
 
+/**
+ * Recursive reachability: on the merged relation with --merge-relations, and
+ * otherwise directly on the partial relations (go_rec_multi)
+ */
 VOID_TASK_1(rec, set_t, set)
 {
-    if (next_count != 1) Abort("Strategy rec requires merge-relations");
     bool par = false;
     if (loop_order == loop_par) par = true;
-    set->bdd = CALL(go_rec, set->bdd, next[0]->bdd, next[0]->variables, par);
-    if (check_deadlocks) {
-        BDD primed_vars = prime_variables(set->variables);
-        sylvan_protect(&primed_vars);
-        BDD rel = sylvan_project(next[0]->bdd, next[0]->variables);
-        BDD all_deadlocks = sylvan_forall(sylvan_not(rel), primed_vars);
-        BDD reach_deadlocks = sylvan_and(set->bdd, all_deadlocks);
-        double num_deadlocks = sylvan_satcount(reach_deadlocks, set->variables);
-        INFO("Found %'0.0f deadlock states... ", num_deadlocks);
-        if (num_deadlocks > 0) {
-            printf("example: ");
-            print_example(reach_deadlocks, set->variables);
-            stats.found_deadlock = 1;
-        }
+
+    // the relations and their variables are protected in next[]
+    BDD rels[next_count];
+    BDDSET rel_vars[next_count];
+    for (int i=0; i<next_count; i++) {
+        rels[i] = next[i]->bdd;
+        rel_vars[i] = next[i]->variables;
+    }
+
+    if (!check_deadlocks) {
+        if (!merge_relations) set->bdd = CALL(go_rec_multi, set->bdd, rels, rel_vars, next_count, NULL, par);
+        else if (implicit_identity) set->bdd = CALL(go_rec_id, set->bdd, next[0]->bdd, NULL, par);
+        else set->bdd = CALL(go_rec, set->bdd, next[0]->bdd, NULL, next[0]->variables, par);
+        return;
+    }
+
+    // go_rec stops at the first reachable state outside of the group guards
+    bool found;
+    if (!merge_relations) {
+        set->bdd = bdd_reach_multi_deadlocks(set->bdd, rels, rel_vars, next_count, guards, guard_count, par, &found);
+    } else if (implicit_identity) {
+        set->bdd = bdd_reach_id_deadlocks(set->bdd, next[0]->bdd, guards, guard_count, par, &found);
+    } else {
+        set->bdd = bdd_reach_deadlocks(set->bdd, next[0]->bdd, guards, guard_count, next[0]->variables, par, &found);
+    }
+    if (found) {
+        BDD reach_deadlocks = bdd_guard_deadlocks(set->bdd, guards, guard_count);
+        sylvan_protect(&reach_deadlocks);
+        INFO("Found %'0.0f deadlock states... ", sylvan_satcount(reach_deadlocks, set->variables));
+        printf("example: ");
+        print_example(reach_deadlocks, set->variables);
         printf("\n");
-        sylvan_unprotect(&primed_vars);
+        INFO("Stopped exploration at first deadlock, reachable states are incomplete\n");
+        stats.found_deadlock = 1;
+        sylvan_unprotect(&reach_deadlocks);
+    }
+}
+
+/**
+ * Apply REACH for the pairwise independent groups batch[0..n-1] to visited
+ * in parallel. The result of group k is stored in reach[k]; returns their
+ * union.
+ */
+TASK_4(BDD, rec_batch, const int*, batch, int, n, BDD, visited, BDD*, reach)
+{
+    if (n == 1) {
+        const int k = batch[0];
+        reach[k] = CALL(go_rec_partial, visited, next[k]->bdd, next[k]->variables);
+        return reach[k];
     }
+
+    bdd_refs_spawn(SPAWN(rec_batch, batch, n/2, visited, reach));
+    BDD right = bdd_refs_push(CALL(rec_batch, batch+n/2, n-n/2, visited, reach));
+    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(rec_batch)));
+    BDD result = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return result;
 }
 
 /**
  * Chain loop around recursive algorithm, where rec is applied to partial
- * relations. If next_count == 1 then this loop should converge in a single 
- * iteration, since rec already computes all reachable states.
+ * relations. Since rec closes the states under a group, a group is only
+ * applied again after a group it depends on found new states. Consecutive
+ * independent groups are applied in parallel. If next_count == 1 then this
+ * converges after a single call.
  */
 VOID_TASK_1(chain_rec, set_t, set)
 {
     BDD visited = set->bdd;
-    BDD prev = sylvan_false;
     BDD successors = sylvan_false;
 
     sylvan_protect(&visited);
-    sylvan_protect(&prev);
     sylvan_protect(&successors);
 
-    while (prev != visited) {
-        prev = visited;
+    BDD reach[next_count];
+    for (int k=0; k<next_count; k++) {
+        reach[k] = sylvan_false;
+        bdd_refs_pushptr(&reach[k]);
+    }
+
+    group_sched_t sched;
+    sched_init(&sched, group_deps, next_count);
+    const int *batch = sched.batch;
+
+    do {
         for (int k = 0; k < next_count; k++) {
-            visited = RUN(go_rec_partial, visited, next[k]->bdd, next[k]->variables);
+            if (!sched.cur[k]) continue;
+            int n = sched_take_batch(&sched, k);
+
+            successors = CALL(rec_batch, batch, n, visited, reach);
+            for (int b = 0; b < n; b++) {
+                if (reach[batch[b]] != visited) sched_dependents(&sched, batch[b], 0);
+                reach[batch[b]] = sylvan_false; // reset, for gc
+            }
+            visited = successors;
         }
-    }
+    } while (sched_next_pass(&sched));
+
+    sched_free(&sched);
+    bdd_refs_popptr(next_count);
 
     sylvan_unprotect(&visited);
-    sylvan_unprotect(&prev);
     sylvan_unprotect(&successors);
 
     set->bdd = visited;
@@ -943,7 +1129,8 @@ TASK_2(BDD, extend_relation, MTBDD, relation, MTBDD, variables)
 }
 
 /**
- * Compute \BigUnion ( sets[i] )
+ * Compute \BigUnion ( sets[i] ), of relations in the implicit identity
+ * encoding if implicit_identity is set
  */
 #define big_union(first, count) RUN(big_union, first, count)
 TASK_2(BDD, big_union, int, first, int, count)
@@ -953,7 +1140,9 @@ TASK_2(BDD, big_union, int, first, int, count)
     bdd_refs_spawn(SPAWN(big_union, first, count/2));
     BDD right = bdd_refs_push(CALL(big_union, first+count/2, count-count/2));
     BDD left = bdd_refs_push(bdd_refs_sync(SYNC(big_union)));
-    BDD result = sylvan_or(left, right);
+    BDD result;
+    if (implicit_identity) result = CALL(bdd_rel_union_id, left, right);
+    else result = sylvan_or(left, right);
     bdd_refs_pop(2);
     return result;
 }
@@ -991,9 +1180,32 @@ VOID_TASK_0(gc_start)
 
 VOID_TASK_0(gc_end)
 {
+    const sylvan_gc_info_t *gc = sylvan_gc_last_info();
+    if (gc->nodes_before > stats.peaknodes) stats.peaknodes = gc->nodes_before;
+    stats.gcs++;
+    stats.gc_time += gc->time;
+    if (gc->time > stats.gc_max_pause) stats.gc_max_pause = gc->time;
+    stats.gc_clear_cache_time += gc->clear_cache_time;
+    stats.gc_mark_time += gc->mark_time;
+    stats.gc_compact_time += gc->compact_time;
+    if (gc->trigger == SYLVAN_GC_COMPACT) stats.compactions++;
+    stats.gc_resize_time += gc->resize_time;
+    stats.gc_rehash_time += gc->rehash_time;
+
     char buf[32];
     to_h(getCurrentRSS(), buf);
     INFO("(GC) Garbage collection done.       (rss: %s)\n", buf);
+    INFO("(GC) #%zu (%s): %f sec (cache %f, mark %f, compact %f, resize %f, rehash %f), table %'zu -> %'zu\n",
+         gc->number, gc_trigger_names[gc->trigger], gc->time, gc->clear_cache_time, gc->mark_time, gc->compact_time,
+         gc->resize_time, gc->rehash_time, gc->table_before, gc->table_after);
+    if (gc->nodes_before != 0) INFO("(GC) nodes %'zu -> %'zu\n", gc->nodes_before, gc->nodes_after);
+
+    if (gc_log != NULL) {
+        fprintf(gc_log, "%s, %zu, %s, %f, %f, %f, %f, %f, %f, %zu, %zu, %zu, %zu, %f\n",
+                basename((char*)model_filename), gc->number, gc_trigger_names[gc->trigger], gc->timestamp,
+                gc->time, gc->clear_cache_time, gc->mark_time, gc->resize_time, gc->rehash_time,
+                gc->nodes_before, gc->nodes_after, gc->table_before, gc->table_after, gc->compact_time);
+    }
 }
 
 void
@@ -1015,6 +1227,10 @@ main(int argc, char **argv)
     setlocale(LC_NUMERIC, "en_US.utf-8");
     t_start = wctime();
 
+    if (implicit_identity && strategy != strat_rec && strategy != strat_bfs_plain) {
+        Abort("Option --implicit-identity requires strategy rec or bfs-plain\n");
+    }
+
     /**
      * Initialize Lace.
      *
@@ -1030,8 +1246,10 @@ main(int argc, char **argv)
      * First: set memory limits
      * - 2 GB memory, nodes table twice as big as cache, initial size halved 6x
      *   (that means it takes 6 garbage collections to get to the maximum nodes&cache size)
+     * - with a size hint (given, or the peak of a previous run), the initial nodes table
+     *   holds twice the hinted number of nodes, so it does not have to grow
      * Second: initialize package and subpackages
-     * Third: add hooks to report garbage collection
+     * Third: add hooks to report garbage collection and set the resize policy
      */
     size_t max = 16LL<<30;
     if (max > getMaxMemory()) max = getMaxMemory()/10*9;
@@ -1040,12 +1258,33 @@ main(int argc, char **argv)
     printf(" max.\n");
 
     sylvan_set_limits(max, 1, 6);
+    if (stats_filename != NULL && !stats_header_matches(stats_filename, stats_header))
+        Abort("The columns of '%s' differ from this version, use a new file!\n", stats_filename);
+    if (size_hint == 0 && stats_filename != NULL) {
+        size_hint = read_peaknodes(stats_filename, basename((char*)model_filename));
+        if (size_hint != 0) INFO("Size hint from %s: %'zu nodes\n", stats_filename, size_hint);
+    }
+    if (size_hint != 0) sylvan_set_initial_nodes(2*size_hint);
     //sylvan_set_limits(max, 1, 1);
     //sylvan_gc_disable();
     sylvan_init_package();
     sylvan_init_bdd();
+    if (cache_priority) {
+        cache_set_priority(CACHE_BDD_REACH, 1);
+        cache_set_priority(CACHE_BDD_REACH_PARTIAL, 1);
+        cache_set_priority(CACHE_BDD_REACH_ID, 1);
+        cache_set_priority(CACHE_BDD_REACH_MULTI, 1);
+        cache_set_priority(CACHE_BDD_REACH_CONJ, 1);
+    }
+    exact_count_init(1LL<<16);
     sylvan_gc_hook_pregc(TASK(gc_start));
     sylvan_gc_hook_postgc(TASK(gc_end));
+    if (gc_log_filename != NULL) open_gc_log();
+    // the nodes are only counted at every garbage collection for peaknodes and the gc log
+    if (stats_filename != NULL || gc_log_filename != NULL) sylvan_gc_count_nodes(1);
+    if (resize_policy == 1) sylvan_gc_hook_main(TASK(sylvan_gc_aggressive_resize));
+    else if (resize_policy == 2) sylvan_gc_hook_main(TASK(sylvan_gc_normal_resize));
+    INFO("Initial nodes table: %'zu nodes, operation cache: %'zu entries\n", llmsset_get_size(nodes), cache_getsize());
 
     /**
      * Read the model from file
@@ -1123,6 +1362,22 @@ main(int argc, char **argv)
         exit(0);
     }
 
+    /* compute the states with a successor of every group once, for deadlock
+       checking; the guards stay separate, their union can be much larger */
+    if (check_deadlocks) {
+        uint32_t vars[totalbits];
+        for (int i=0; i<totalbits; i++) vars[i] = 2*i;
+        BDDSET state_vars = sylvan_set_fromarray(vars, totalbits);
+        bdd_refs_pushptr(&state_vars);
+        guard_count = next_count;
+        guards = (BDD*)malloc(sizeof(BDD[guard_count]));
+        for (int i=0; i<guard_count; i++) {
+            guards[i] = sylvan_project(next[i]->bdd, state_vars);
+            sylvan_protect(&guards[i]);
+        }
+        bdd_refs_popptr(1);
+    }
+
     /* merge all relations to one big transition relation if requested */
     if (merge_relations) {
         double t1 = wctime();
@@ -1133,9 +1388,17 @@ main(int argc, char **argv)
             newvars = sylvan_set_add(newvars, i*2);
         }
 
-        INFO("Extending transition relations to full domain.\n");
+        if (implicit_identity) {
+            INFO("Converting transition relations to implicit identity.\n");
+        } else {
+            INFO("Extending transition relations to full domain.\n");
+        }
         for (int i=0; i<next_count; i++) {
-            next[i]->bdd = extend_relation(next[i]->bdd, next[i]->variables);
+            if (implicit_identity) {
+                next[i]->bdd = bdd_rel_identity(next[i]->bdd, next[i]->variables);
+            } else {
+                next[i]->bdd = extend_relation(next[i]->bdd, next[i]->variables);
+            }
             next[i]->variables = newvars;
         }
 
@@ -1153,6 +1416,11 @@ main(int argc, char **argv)
         stats.merge_rel_time = t2-t1;
     }
 
+    /* dependencies between groups, for saturation and chaining */
+    if (strategy == strat_sat || strategy == strat_chaining || strategy == strat_chain_rec) {
+        init_group_deps();
+    }
+
     if (report_nodes) {
         INFO("BDD nodes:\n");
         INFO("Initial states: %zu BDD nodes\n", sylvan_nodecount(states->bdd));
@@ -1161,6 +1429,8 @@ main(int argc, char **argv)
         }
     }
 
+    RUN(compact_nodes);
+
     print_memory_usage();
 
 #ifdef HAVE_PROFILER
@@ -1233,13 +1503,24 @@ main(int argc, char **argv)
 #endif
 
     // Now we just have states
-    stats.final_states = sylvan_satcount(states->bdd, states->variables);
-    INFO("Final states: %'0.0f states\n", stats.final_states);
+    stats.final_states = bdd_exact_satcount_str(states->bdd, states->variables);
+    INFO("Final states: %s states\n", stats.final_states);
     if (report_nodes) {
         stats.final_nodecount = sylvan_nodecount(states->bdd);
         INFO("Final states: %'zu BDD nodes\n", stats.final_nodecount);
     }
 
+    size_t filled;
+    sylvan_table_usage(&filled, NULL);
+    if (filled > stats.peaknodes) stats.peaknodes = filled;
+    INFO("Garbage collections: %zu (%zu compacting), peak nodes: %'zu\n", stats.gcs, stats.compactions, stats.peaknodes);
+    if (stats.gcs > 0) {
+        INFO("GC time: %f sec, max pause: %f sec (cache %f, mark %f, compact %f, resize %f, rehash %f)\n",
+             stats.gc_time, stats.gc_max_pause, stats.gc_clear_cache_time, stats.gc_mark_time,
+             stats.gc_compact_time, stats.gc_resize_time, stats.gc_rehash_time);
+    }
+    if (gc_log != NULL) fclose(gc_log);
+
     print_memory_usage();
 
     sylvan_stats_report(stdout);
@@ -1253,6 +1534,7 @@ main(int argc, char **argv)
         INFO("Writing stats to %s\n", stats_filename);
         write_stats();
     }
+    free(stats.final_states);
 
     return 0;
 }
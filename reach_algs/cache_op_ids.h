@@ -15,5 +15,15 @@ static const uint64_t CACHE_LDD_REACH           = (302LL<<40);
 static const uint64_t CACHE_LDD_IMAGE           = (303LL<<40);
 static const uint64_t CACHE_LDD_EXTEND_REL      = (304LL<<40);
 static const uint64_t CACHE_LDD_REL_UNION       = (305LL<<40);
+static const uint64_t CACHE_LDD_IDENTITY_REL    = (306LL<<40);
+static const uint64_t CACHE_BDD_REACH_CONJ      = (307LL<<40);
+static const uint64_t CACHE_LDD_GUARD           = (308LL<<40);
+static const uint64_t CACHE_LDD_DEADLOCKS       = (309LL<<40);
+static const uint64_t CACHE_LDD_ENABLED         = (310LL<<40);
+static const uint64_t CACHE_BDD_REACH_ID        = (311LL<<40);
+static const uint64_t CACHE_BDD_RELNEXT_ID      = (312LL<<40);
+static const uint64_t CACHE_BDD_REL_UNION_ID    = (313LL<<40);
+static const uint64_t CACHE_BDD_REL_IDENTITY    = (314LL<<40);
+static const uint64_t CACHE_BDD_REACH_MULTI     = (315LL<<40);
 
 #endif
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "exact_count.h"
+
+/**
+ * One memoised count. The key is a node (without complement mark) and, for
+ * BDDs, the variable set below it; LDD counts use vars = 0, which is never a
+ * valid variable set. Entries are only accessed while holding `lock`; a busy
+ * entry is simply skipped.
+ */
+typedef struct count_entry {
+    uint64_t node;
+    uint64_t vars;
+    uint32_t gen;
+    volatile uint32_t lock;
+    mpz_t value;
+} count_entry_t;
+
+static count_entry_t *count_table = NULL;
+static size_t count_mask = 0;
+static volatile uint32_t count_gen = 1;
+static int count_hook_registered = 0;
+
+
+/* Node ids are only reused after garbage collection, so bumping the
+   generation is enough to invalidate all entries */
+VOID_TASK_0(exact_count_gc)
+{
+    count_gen++;
+}
+
+
+void exact_count_init(size_t size)
+{
+    if (count_table != NULL) {
+        for (size_t i = 0; i <= count_mask; i++) mpz_clear(count_table[i].value);
+        free(count_table);
+        count_table = NULL;
+    }
+    if (size == 0) return;
+
+    size_t entries = 1;
+    while (entries * 2 <= size) entries *= 2;
+    count_mask = entries - 1;
+
+    count_table = malloc(entries * sizeof(count_entry_t));
+    for (size_t i = 0; i < entries; i++) {
+        count_table[i].node = 0;
+        count_table[i].vars = 0;
+        count_table[i].gen = 0;
+        count_table[i].lock = 0;
+        mpz_init(count_table[i].value);
+    }
+
+    if (!count_hook_registered) {
+        sylvan_gc_hook_pregc(TASK(exact_count_gc));
+        count_hook_registered = 1;
+    }
+}
+
+
+static inline count_entry_t *
+count_slot(uint64_t node, uint64_t vars)
+{
+    uint64_t h = (node ^ (vars * 0xC2B2AE3D27D4EB4FULL)) * 0x9E3779B97F4A7C15ULL;
+    return &count_table[(h >> 32) & count_mask];
+}
+
+static inline int
+count_trylock(count_entry_t *e)
+{
+    return __sync_lock_test_and_set(&e->lock, 1) == 0;
+}
+
+static inline void
+count_unlock(count_entry_t *e)
+{
+    __sync_lock_release(&e->lock);
+}
+
+static int
+count_get(uint64_t node, uint64_t vars, mpz_ptr res)
+{
+    if (count_table == NULL) return 0;
+    count_entry_t *e = count_slot(node, vars);
+    if (e->node != node || e->vars != vars || e->gen != count_gen) return 0;
+    if (!count_trylock(e)) return 0;
+    int hit = e->node == node && e->vars == vars && e->gen == count_gen;
+    if (hit) mpz_set(res, e->value);
+    count_unlock(e);
+    return hit;
+}
+
+static void
+count_put(uint64_t node, uint64_t vars, mpz_srcptr value)
+{
+    if (count_table == NULL) return;
+    count_entry_t *e = count_slot(node, vars);
+    if (!count_trylock(e)) return;
+    e->node = node;
+    e->vars = vars;
+    e->gen = count_gen;
+    mpz_set(e->value, value);
+    count_unlock(e);
+}
+
+
+/* res = number of assignments to the nvars variables in vars satisfying dd */
+VOID_TASK_4(bdd_exact_satcount_rec, mpz_ptr, res, BDD, dd, BDDSET, vars, size_t, nvars)
+{
+    if (dd == sylvan_false) {
+        mpz_set_ui(res, 0);
+        return;
+    }
+    if (dd == sylvan_true) {
+        mpz_set_ui(res, 0);
+        mpz_setbit(res, nvars);
+        return;
+    }
+
+    /* Variables above the top of dd double the count */
+    BDDVAR top = sylvan_var(dd);
+    size_t skipped = 0;
+    while (!sylvan_set_isempty(vars) && sylvan_set_first(vars) < top) {
+        vars = sylvan_set_next(vars);
+        skipped++;
+    }
+    assert(!sylvan_set_isempty(vars) && sylvan_set_first(vars) == top);
+    nvars -= skipped;
+
+    /* Count the node without complement mark */
+    BDD node = BDD_STRIPMARK(dd);
+    if (!count_get(node, vars, res)) {
+        BDDSET next = sylvan_set_next(vars);
+        mpz_t high;
+        mpz_init(high);
+        SPAWN(bdd_exact_satcount_rec, high, sylvan_high(node), next, nvars-1);
+        CALL(bdd_exact_satcount_rec, res, sylvan_low(node), next, nvars-1);
+        SYNC(bdd_exact_satcount_rec);
+        mpz_add(res, res, high);
+        mpz_clear(high);
+        count_put(node, vars, res);
+    }
+
+    if (BDD_HASMARK(dd)) {
+        /* res = 2^nvars - res */
+        mpz_t all;
+        mpz_init(all);
+        mpz_setbit(all, nvars);
+        mpz_sub(res, all, res);
+        mpz_clear(all);
+    }
+    mpz_mul_2exp(res, res, skipped);
+}
+
+
+VOID_TASK_IMPL_3(bdd_exact_satcount, mpz_ptr, res, BDD, dd, BDDSET, vars)
+{
+    CALL(bdd_exact_satcount_rec, res, dd, vars, sylvan_set_count(vars));
+}
+
+
+VOID_TASK_IMPL_2(lddmc_exact_satcount, mpz_ptr, res, MDD, dd)
+{
+    if (dd == lddmc_false) {
+        mpz_set_ui(res, 0);
+        return;
+    }
+    if (dd == lddmc_true) {
+        mpz_set_ui(res, 1);
+        return;
+    }
+    if (count_get(dd, 0, res)) return;
+
+    mddnode_t n = LDD_GETNODE(dd);
+    mpz_t right;
+    mpz_init(right);
+    SPAWN(lddmc_exact_satcount, right, mddnode_getright(n));
+    CALL(lddmc_exact_satcount, res, mddnode_getdown(n));
+    SYNC(lddmc_exact_satcount);
+    mpz_add(res, res, right);
+    mpz_clear(right);
+
+    count_put(dd, 0, res);
+}
+
+
+char *bdd_exact_satcount_str(BDD dd, BDDSET vars)
+{
+    mpz_t count;
+    mpz_init(count);
+    bdd_exact_satcount(count, dd, vars);
+    char *str = mpz_get_str(NULL, 10, count);
+    mpz_clear(count);
+    return str;
+}
+
+
+char *lddmc_exact_satcount_str(MDD dd)
+{
+    mpz_t count;
+    mpz_init(count);
+    lddmc_exact_satcount(count, dd);
+    char *str = mpz_get_str(NULL, 10, count);
+    mpz_clear(count);
+    return str;
+}
@@ -0,0 +1,38 @@
+#ifndef EXACT_COUNT_H
+#define EXACT_COUNT_H
+
+#include <gmp.h>
+
+#include "sylvan_int.h"
+
+/**
+ * Exact (arbitrary precision) state counting for BDDs and LDDs.
+ *
+ * Counts are computed in parallel and memoised per node in a lossy table of
+ * GMP integers. Unlike Sylvan's operation cache, the table only holds counts,
+ * so results for shared subgraphs survive across calls (e.g. when counting
+ * the visited set at every BFS level). Node ids are only reused after garbage
+ * collection, so the table is invalidated at every garbage collection.
+ */
+
+/**
+ * Allocate the memo table with `size` entries (rounded down to a power of 2)
+ * and register its garbage collection hook. Without a table (or with size 0)
+ * counts are still exact, but nothing is reused across calls.
+ * Call after sylvan_init_package().
+ */
+void exact_count_init(size_t size);
+
+/* Number of assignments to `vars` that satisfy dd */
+VOID_TASK_DECL_3(bdd_exact_satcount, mpz_ptr, BDD, BDDSET);
+#define bdd_exact_satcount(res, dd, vars) RUN(bdd_exact_satcount, res, dd, vars)
+
+/* Number of vectors in dd */
+VOID_TASK_DECL_2(lddmc_exact_satcount, mpz_ptr, MDD);
+#define lddmc_exact_satcount(res, dd) RUN(lddmc_exact_satcount, res, dd)
+
+/* The counts above as a decimal string, to be freed by the caller */
+char *bdd_exact_satcount_str(BDD dd, BDDSET vars);
+char *lddmc_exact_satcount_str(MDD dd);
+
+#endif
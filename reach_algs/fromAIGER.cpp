@@ -0,0 +1,490 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <argp.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sylvan_obj.hpp>
+
+#include "bdd_reach_algs.h"
+
+
+/**
+ * And-inverter graph as read from an AIGER file. All signals are literals
+ * (2*variable, +1 if negated).
+ */
+struct Aiger {
+    unsigned maxvar = 0;
+    std::vector<unsigned> inputs;
+    std::vector<unsigned> latches, next, reset;
+    std::vector<unsigned> outputs, bad, constraints;
+    std::vector<unsigned> and_lhs, and_rhs0, and_rhs1;
+};
+
+static int strategy = 0;
+static int workers = 1;
+static size_t partition_size = 0; // 0 = one partition per latch
+static int merge_relations = 0;
+
+typedef enum strats {
+    strat_bfs,
+    strat_reach
+} strategy_t;
+
+using namespace sylvan;
+
+std::string aig_file;
+BDD S = sylvan::sylvan_false; // initial states
+BDD R = sylvan::sylvan_false; // merged relation (with --merge-relations)
+BDD T = sylvan::sylvan_false; // bad states
+BDDSET vars = sylvan::sylvan_false; // state vars (even vars starting at 0)
+bdd_conj_rel_t R_conj = {}; // per-latch partial relations
+
+std::string stats_filename; // filename of csv stats output file
+
+/* argp configuration */
+static struct argp_option options[] =
+{
+    {"workers", 'w', "<workers>", 0, "Number of workers (default=1)", 0},
+    {"strategy", 's', "<bfs|reach>", 0, "Strategy for reachability (default=bfs)", 0},
+    {"statsfile", 7, "FILENAME", 0, "Write stats to given filename (or append if exists)", 0},
+    {"partition", 8, "<nodes>", 0, "Cluster the latch relations into partitions of at most <nodes> nodes each (default=0: one partition per latch)", 0},
+    {"merge-relations", 6, 0, 0, "Merge the latch relations into one transition relation", 1},
+    {0, 0, 0, 0, 0, 0}
+};
+
+static error_t
+parse_opt(int key, char *arg, struct argp_state *state)
+{
+    switch (key) {
+    case 'w':
+        workers = atoi(arg);
+        break;
+    case 's':
+        if (strcmp(arg, "bfs")==0) strategy = strat_bfs;
+        else if (strcmp(arg, "reach")==0) strategy = strat_reach;
+        else argp_usage(state);
+        break;
+    case 6:
+        merge_relations = 1;
+        break;
+    case 7:
+        stats_filename = arg;
+        break;
+    case 8:
+        partition_size = strtoull(arg, NULL, 10);
+        break;
+    case ARGP_KEY_ARG:
+        if (state->arg_num == 0) aig_file = arg;
+        else argp_usage(state);
+        break;
+    case ARGP_KEY_END:
+        if (state->arg_num < 1) argp_usage(state);
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+static struct argp argp = { options, parse_opt, "<model.aag|model.aig>", 0, 0, 0, 0 };
+
+
+typedef struct stats {
+    double reach_time;
+    double parse_time;
+    double build_time;
+    int reachable;
+    int nsteps;
+} stats_t;
+stats_t stats = {};
+
+/**
+ * Obtain current wallclock time
+ */
+static double
+wctime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + 1E-6 * tv.tv_usec);
+}
+
+static double t_start;
+#define INFO(s, ...) fprintf(stdout, "[% 8.2f] " s, wctime()-t_start, ##__VA_ARGS__)
+#define Abort(...) { fprintf(stderr, __VA_ARGS__); fprintf(stderr, "Abort at line %d!\n", __LINE__); exit(-1); }
+
+
+/* Reads the unsigned integers on the current line (at most max) */
+static int
+read_line(const char *&p, const char *end, unsigned *out, int max)
+{
+    int n = 0;
+    while (p < end && *p != '\n') {
+        if (*p >= '0' && *p <= '9') {
+            unsigned v = 0;
+            while (p < end && *p >= '0' && *p <= '9') v = v*10 + (*p++ - '0');
+            if (n < max) out[n] = v;
+            n++;
+        } else {
+            p++;
+        }
+    }
+    if (p < end) p++; // skip '\n'
+    return n;
+}
+
+/* Reads one delta of a binary AND gate (7 bits per byte, little endian) */
+static unsigned
+read_delta(const char *&p, const char *end)
+{
+    unsigned x = 0, shift = 0;
+    for (;;) {
+        if (p >= end) Abort("Unexpected end of binary AIGER file\n");
+        unsigned char c = *p++;
+        x |= (c & 0x7f) << shift;
+        if (!(c & 0x80)) return x;
+        shift += 7;
+    }
+}
+
+
+/**
+ * Loads an and-inverter graph from an AIGER file, in ascii (aag) or binary
+ * (aig) format. The file is mapped into memory and parsed in place.
+ */
+Aiger aiger_from_file(const std::string &filepath)
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) Abort("Unable to open %s\n", filepath.c_str());
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) Abort("Unable to read %s\n", filepath.c_str());
+    size_t len = st.st_size;
+    const char *data = (const char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) Abort("Unable to mmap %s\n", filepath.c_str());
+
+    const char *p = data, *end = data + len;
+    bool binary;
+    if (len > 4 && strncmp(p, "aag ", 4) == 0) binary = false;
+    else if (len > 4 && strncmp(p, "aig ", 4) == 0) binary = true;
+    else Abort("%s is not an AIGER file\n", filepath.c_str());
+
+    // header: M I L O A [B C J F]
+    unsigned h[9] = {0};
+    int n = read_line(p, end, h, 9);
+    if (n < 5) Abort("Invalid AIGER header in %s\n", filepath.c_str());
+    if (h[7] != 0 || h[8] != 0) Abort("Justice and fairness properties are not supported\n");
+
+    Aiger aig;
+    aig.maxvar = h[0];
+    unsigned ninputs = h[1], nlatches = h[2], noutputs = h[3], nands = h[4];
+    unsigned line[3];
+
+    for (unsigned i = 0; i < ninputs; i++) {
+        if (binary) {
+            aig.inputs.push_back(2*(i+1));
+        } else {
+            if (read_line(p, end, line, 1) != 1) Abort("Invalid input line\n");
+            aig.inputs.push_back(line[0]);
+        }
+    }
+    for (unsigned i = 0; i < nlatches; i++) {
+        unsigned lit = 2*(ninputs+i+1);
+        if (binary) {
+            n = read_line(p, end, line, 2);
+            if (n < 1) Abort("Invalid latch line\n");
+            line[2] = n == 2 ? line[1] : 0;
+            line[1] = line[0];
+            n++;
+        } else {
+            n = read_line(p, end, line, 3);
+            if (n < 2) Abort("Invalid latch line\n");
+            lit = line[0];
+            if (n == 2) line[2] = 0;
+        }
+        aig.latches.push_back(lit);
+        aig.next.push_back(line[1]);
+        aig.reset.push_back(line[2]);
+    }
+    for (unsigned i = 0; i < noutputs; i++) {
+        if (read_line(p, end, line, 1) != 1) Abort("Invalid output line\n");
+        aig.outputs.push_back(line[0]);
+    }
+    for (unsigned i = 0; i < h[5]; i++) {
+        if (read_line(p, end, line, 1) != 1) Abort("Invalid bad state line\n");
+        aig.bad.push_back(line[0]);
+    }
+    for (unsigned i = 0; i < h[6]; i++) {
+        if (read_line(p, end, line, 1) != 1) Abort("Invalid constraint line\n");
+        aig.constraints.push_back(line[0]);
+    }
+    for (unsigned i = 0; i < nands; i++) {
+        if (binary) {
+            unsigned lhs = 2*(ninputs+nlatches+i+1);
+            unsigned rhs0 = lhs - read_delta(p, end);
+            unsigned rhs1 = rhs0 - read_delta(p, end);
+            line[0] = lhs; line[1] = rhs0; line[2] = rhs1;
+        } else if (read_line(p, end, line, 3) != 3) {
+            Abort("Invalid AND gate line\n");
+        }
+        aig.and_lhs.push_back(line[0]);
+        aig.and_rhs0.push_back(line[1]);
+        aig.and_rhs1.push_back(line[2]);
+    }
+    // the symbol table and comments are ignored
+
+    munmap((void*)data, len);
+    close(fd);
+    return aig;
+}
+
+
+/**
+ * BDDs for the signals of an AIG. Latch i is BDD variable 2*i (and 2*i+1 in
+ * the next state), inputs are the variables after all (primed) latches.
+ */
+class AigBdds {
+public:
+    AigBdds(const Aiger &aig) : aig(aig), gates(aig.maxvar+1), done(aig.maxvar+1, false),
+                                and_index(aig.maxvar+1, -1)
+    {
+        gates[0] = Bdd::bddZero();
+        done[0] = true;
+        for (size_t i = 0; i < aig.latches.size(); i++) {
+            gates[aig.latches[i]/2] = Bdd::bddVar(2*i);
+            done[aig.latches[i]/2] = true;
+        }
+        for (size_t j = 0; j < aig.inputs.size(); j++) {
+            gates[aig.inputs[j]/2] = Bdd::bddVar(2*aig.latches.size() + j);
+            done[aig.inputs[j]/2] = true;
+        }
+        for (size_t k = 0; k < aig.and_lhs.size(); k++) {
+            and_index[aig.and_lhs[k]/2] = k;
+        }
+    }
+
+    /* BDD of a literal; AND gates are built (once) in depth-first order */
+    Bdd literal(unsigned lit)
+    {
+        unsigned var = lit/2;
+        if (!done[var]) build(var);
+        return (lit & 1) ? !gates[var] : gates[var];
+    }
+
+private:
+    void build(unsigned root)
+    {
+        std::vector<unsigned> stack = {root};
+        while (!stack.empty()) {
+            unsigned var = stack.back();
+            if (done[var]) {
+                stack.pop_back();
+                continue;
+            }
+            if (and_index[var] < 0) Abort("Undefined AIGER literal %u\n", 2*var);
+            unsigned a = aig.and_rhs0[and_index[var]];
+            unsigned b = aig.and_rhs1[and_index[var]];
+            bool ready = true;
+            if (!done[a/2]) { stack.push_back(a/2); ready = false; }
+            if (!done[b/2]) { stack.push_back(b/2); ready = false; }
+            if (ready) {
+                gates[var] = literal(a) & literal(b);
+                done[var] = true;
+                stack.pop_back();
+            }
+        }
+    }
+
+    const Aiger &aig;
+    std::vector<Bdd> gates;
+    std::vector<bool> done;
+    std::vector<long> and_index;
+};
+
+
+/**
+ * Builds the initial states, the bad states, and one partial relation
+ * x'_i <-> next_i(x, inputs) per latch. Latch relations are clustered into
+ * partitions of at most partition_size nodes (if partition_size > 0), and
+ * invariant constraints are added as an extra partition.
+ */
+void load_aiger_to_bdds()
+{
+    double t1 = wctime();
+
+    INFO("Loading AIGER from file\n");
+    Aiger aig = aiger_from_file(aig_file);
+    INFO("AIG has %zu input(s), %zu latch(es), %zu AND gate(s)\n",
+         aig.inputs.size(), aig.latches.size(), aig.and_lhs.size());
+    if (aig.latches.empty()) Abort("AIG has no latches\n");
+
+    double t2 = wctime();
+    stats.parse_time = t2-t1;
+    INFO("Parse time: %f\n", stats.parse_time);
+
+    INFO("Converting AIG to BDDs\n");
+    size_t nlatches = aig.latches.size();
+    uint32_t vars_arr[nlatches];
+    for (size_t i = 0; i < nlatches; i++) {
+        vars_arr[i] = 2*i;
+    }
+    vars = sylvan_set_fromarray(vars_arr, nlatches);
+
+    uint32_t input_arr[aig.inputs.size() + 1];
+    for (size_t j = 0; j < aig.inputs.size(); j++) {
+        input_arr[j] = 2*nlatches + j;
+    }
+    BddSet inputs = BddSet::fromArray(input_arr, aig.inputs.size());
+
+    AigBdds bdds(aig);
+
+    // invariant constraints must hold in every state of a trace
+    Bdd constraint = Bdd::bddOne();
+    for (unsigned lit : aig.constraints) {
+        constraint &= bdds.literal(lit);
+    }
+
+    // initial states (a latch with itself as reset value is uninitialized)
+    Bdd init = constraint.ExistAbstract(inputs);
+    for (size_t i = 0; i < nlatches; i++) {
+        if (aig.reset[i] == 0) init &= !Bdd::bddVar(2*i);
+        else if (aig.reset[i] == 1) init &= Bdd::bddVar(2*i);
+    }
+    S = init.GetBDD();
+
+    // bad states (the outputs, if there are no bad state properties)
+    const std::vector<unsigned> &props = aig.bad.empty() ? aig.outputs : aig.bad;
+    Bdd bad = Bdd::bddZero();
+    for (unsigned lit : props) {
+        bad |= bdds.literal(lit);
+    }
+    T = (bad & constraint).ExistAbstract(inputs).GetBDD();
+
+    // partial relation per latch, clustered under the node budget
+    std::vector<Bdd> parts;
+    Bdd cluster = Bdd::bddOne();
+    for (size_t i = 0; i < nlatches; i++) {
+        Bdd latch_rel = Bdd::bddVar(2*i+1).Xnor(bdds.literal(aig.next[i]));
+        Bdd merged = cluster & latch_rel;
+        if (cluster != Bdd::bddOne() && (partition_size == 0 || merged.NodeCount() > partition_size)) {
+            parts.push_back(cluster);
+            cluster = latch_rel;
+        } else {
+            cluster = merged;
+        }
+    }
+    parts.push_back(cluster);
+    if (constraint != Bdd::bddOne()) parts.push_back(constraint);
+
+    if (merge_relations) {
+        Bdd rel = Bdd::bddOne();
+        for (const Bdd &part : parts) rel &= part;
+        R = rel.GetBDD();
+        INFO("Relation has %zu BDD nodes\n", rel.NodeCount());
+    } else {
+        std::vector<BDD> raw;
+        size_t max_nodes = 0;
+        for (const Bdd &part : parts) {
+            raw.push_back(part.GetBDD());
+            max_nodes = std::max(max_nodes, part.NodeCount());
+        }
+        bdd_conj_rel_init(&R_conj, raw.data(), raw.size(), vars);
+        INFO("Relation has %zu partition(s) of at most %zu node(s)\n", parts.size(), max_nodes);
+    }
+
+    double t3 = wctime();
+    stats.build_time = t3-t2;
+    INFO("Build time: %f\n", stats.build_time);
+
+    INFO("counting states...\n");
+    INFO("Initial set has %'0.0f state(s)\n", sylvan_satcount(S, vars));
+    INFO("Bad set has %'0.0f state(s)\n", sylvan_satcount(T, vars));
+}
+
+
+int main(int argc, char** argv)
+{
+    /* Parse CL args */
+    argp_parse(&argp, argc, argv, 0, 0, 0);
+    t_start = wctime();
+
+    // Init Lace
+    lace_start(workers, 1000000);
+    INFO("Lace workers: %d\n", lace_workers());
+
+    // Init Sylvan
+    sylvan_set_limits(8LL<<30, 1, 6);
+    sylvan_init_package();
+    sylvan_init_bdd();
+
+    sylvan::sylvan_protect(&S);
+    sylvan::sylvan_protect(&T);
+    sylvan::sylvan_protect(&R);
+    sylvan::sylvan_protect(&vars);
+    load_aiger_to_bdds();
+
+    INFO("Computing reachability...\n");
+    stats.reachable = 0;
+    stats.nsteps = 0;
+    BDD reachable = sylvan::sylvan_false;
+    sylvan::sylvan_protect(&reachable);
+    double t1 = wctime();
+    if (strategy == strat_reach) {
+        if (merge_relations) {
+            reachable = bdd_reach(S, R, vars);
+        } else {
+            reachable = bdd_reach_conj(S, &R_conj);
+        }
+    } else if (strategy == strat_bfs) {
+        if (merge_relations) {
+            reachable = simple_bfs(S, R, T, vars, &(stats.nsteps));
+        } else {
+            reachable = simple_bfs_conj(S, &R_conj, T, &(stats.nsteps));
+        }
+    } else {
+        Abort("Invalid strategy set?!\n");
+    }
+    double t2 = wctime();
+    stats.reach_time = t2-t1;
+    INFO("%s Time: %f\n", strategy == strat_reach ? "REACH" : "BFS", stats.reach_time);
+
+    double nstates = sylvan_satcount(reachable, vars);
+    INFO("Explored states: %'0.0f state(s)\n", nstates);
+    if (stats.nsteps >= 1) {
+        INFO("Bad state is reachable in %d step(s)\n", stats.nsteps);
+        stats.reachable = 1;
+    } else if (sylvan_and(reachable, T) != sylvan::sylvan_false) {
+        INFO("Bad state is reachable\n");
+        stats.reachable = 1;
+    } else {
+        INFO("Bad state is not reachable\n");
+    }
+
+    if (!stats_filename.empty()) {
+        INFO("Writing stats to %s\n", stats_filename.c_str());
+        std::ofstream statsfile;
+        statsfile.open(stats_filename, std::ios_base::app);
+        statsfile << aig_file << ", "
+                  << stats.parse_time << ", "
+                  << stats.build_time << ", "
+                  << stats.reach_time << ", "
+                  << stats.reachable << ", "
+                  << stats.nsteps << std::endl;
+    }
+
+    sylvan::sylvan_unprotect(&S);
+    sylvan::sylvan_unprotect(&T);
+    sylvan::sylvan_unprotect(&R);
+    sylvan::sylvan_unprotect(&vars);
+    sylvan::sylvan_unprotect(&reachable);
+    if (!merge_relations) bdd_conj_rel_free(&R_conj);
+
+    sylvan_quit();
+    lace_stop();
+
+    return 0;
+}
@@ -1,20 +1,34 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
-#include <set>
+#include <vector>
+#include <algorithm>
 #include <argp.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sylvan_obj.hpp>
 
 #include "bdd_reach_algs.h"
 
 
-typedef std::set<int> Clause;
-typedef std::set<Clause> Cnf;
+/**
+ * CNF formula stored as flat arrays: the literals of clause i are
+ * lits[start[i]], ..., lits[start[i+1]-1].
+ */
+struct Cnf {
+    int nvars = 0;              // number of variables from the "p cnf" header
+    std::vector<int> lits;
+    std::vector<size_t> start;  // nclauses()+1 offsets into lits
+
+    size_t nclauses() const { return start.empty() ? 0 : start.size() - 1; }
+};
 
 static int strategy = 0;
 static int workers = 1;
+static size_t partition_size = 0; // 0 = monolithic relation
 
 typedef enum strats {
     strat_bfs,
@@ -27,6 +41,7 @@ std::string s_file, r_file, t_file;
 BDD S = sylvan::sylvan_false; // initial states
 BDD R = sylvan::sylvan_false; // relation, 
 BDD T = sylvan::sylvan_false; // target states
+bdd_conj_rel_t R_conj = {}; // relation as conjunctive partitions (if partition_size > 0)
 BDDSET vars = sylvan::sylvan_false;; // state vars (i.e. vars of S) (even vars starting at 0)
 
 std::string stats_filename; // filename of csv stats output file
@@ -37,6 +52,7 @@ static struct argp_option options[] =
     {"workers", 'w', "<workers>", 0, "Number of workers (default=1)", 0},
     {"strategy", 's', "<bfs|reach>", 0, "Strategy for reachability (default=bfs)", 0},
     {"statsfile", 7, "FILENAME", 0, "Write stats to given filename (or append if exists)", 0},
+    {"partition", 8, "<nodes>", 0, "Cluster the relation into conjunctive partitions of at most <nodes> nodes each (default=0: monolithic relation)", 0},
     {0, 0, 0, 0, 0, 0}
 };
 
@@ -55,6 +71,9 @@ parse_opt(int key, char *arg, struct argp_state *state)
     case 7:
         stats_filename = arg;
         break;
+    case 8:
+        partition_size = strtoull(arg, NULL, 10);
+        break;
     case ARGP_KEY_ARG:
         if (state->arg_num == 0) s_file = arg;
         else if (state->arg_num == 1) r_file = arg;
@@ -74,7 +93,8 @@ static struct argp argp = { options, parse_opt, "<s.cnf> <r.cnf> <t.cnf>", 0, 0,
 
 typedef struct stats {
     double reach_time;
-    double load_time;
+    double parse_time;
+    double build_time;
     int reachable;
     int nsteps;
 } stats_t;
@@ -107,126 +127,242 @@ void print_lit(int lit)
     }
 }
 
-void print_clause(Clause clause)
+void print_clause(const Cnf &cnf, size_t i)
 {
-    int lit_prev = INT32_MAX;
     std::cout << "(";
-    for (int lit : clause) {
-        if (lit_prev != INT32_MAX) {
-            print_lit(lit_prev);
-            std::cout << " v ";
-        }
-        lit_prev = lit;
+    for (size_t k = cnf.start[i]; k < cnf.start[i+1]; k++) {
+        if (k != cnf.start[i]) std::cout << " v ";
+        print_lit(cnf.lits[k]);
     }
-    // print last lit
-    print_lit(lit_prev);
     std::cout << ")";
 }
 
-void print_cnf(Cnf cnf)
+void print_cnf(const Cnf &cnf)
 {
-    Clause clause_prev;
-    for (Clause clause : cnf) {
-        if (clause_prev.size() != 0) {
-            print_clause(clause_prev);
-            std::cout << " ^ ";
-        }
-        clause_prev = clause;
+    for (size_t i = 0; i < cnf.nclauses(); i++) {
+        if (i != 0) std::cout << " ^ ";
+        print_clause(cnf, i);
     }
-    print_clause(clause_prev);
     std::cout << std::endl;
 }
 
 
+static inline bool
+is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* Parses a (possibly negative) integer at p and advances p past it */
+static inline long
+parse_int(const char *&p, const char *end)
+{
+    bool neg = false;
+    if (p < end && *p == '-') {
+        neg = true;
+        p++;
+    }
+    long v = 0;
+    while (p < end && is_digit(*p)) v = v*10 + (*p++ - '0');
+    return neg ? -v : v;
+}
+
+static inline void
+skip_line(const char *&p, const char *end)
+{
+    const char *nl = (const char*)memchr(p, '\n', end - p);
+    p = nl == NULL ? end : nl + 1;
+}
+
+
 /**
- * Loads a CNF fromula from a DIMACS (.cnf) file.
+ * Loads a CNF fromula from a DIMACS (.cnf) file. The file is mapped into
+ * memory and parsed in place. Every line holds one clause; the terminating
+ * 0 is optional.
  */
-Cnf cnf_from_file(std::string filepath)
+Cnf cnf_from_file(const std::string &filepath)
 {
     Cnf res;
+    res.start.push_back(0);
 
-    std::string line;
-    std::string token;
-    std::ifstream inFile(filepath);
-    if (inFile.is_open()) {
-        while (getline(inFile, line)) {
-            Clause clause;
-            std::istringstream ss(line);
-            while (ss >> token) {
-                if (token == "c" || token == "p") {
-                    break;
-                }
-                int lit = std::stoi(token);
-                if (lit != 0) {
-                    clause.insert(lit);
-                }
-            }
-            if (clause.size() > 0) {
-                res.insert(clause);
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "unable to open " << filepath << std::endl;
+        return res;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return res;
+    }
+    size_t len = st.st_size;
+    const char *data = (const char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        Abort("Unable to mmap %s\n", filepath.c_str());
+    }
+    madvise((void*)data, len, MADV_SEQUENTIAL);
+
+    const char *p = data, *end = data + len;
+    while (p < end) {
+        char c = *p;
+        if (c == '-' || is_digit(c)) {
+            long lit = parse_int(p, end);
+            if (lit != 0) res.lits.push_back((int)lit);
+        } else if (c == '\n') {
+            if (res.lits.size() > res.start.back()) {
+                res.start.push_back(res.lits.size());
             }
+            p++;
+        } else if (c == 'p') {
+            // p cnf <nvars> <nclauses>
+            p++;
+            while (p < end && !is_digit(*p) && *p != '\n') p++;
+            res.nvars = (int)parse_int(p, end);
+            while (p < end && *p == ' ') p++;
+            long nclauses = parse_int(p, end);
+            res.start.reserve(nclauses + 1);
+            res.lits.reserve(nclauses * 3);
+            skip_line(p, end);
+        } else if (c == 'c') {
+            skip_line(p, end);
+        } else if (c == '%') {
+            break; // end marker used by some benchmark sets
+        } else {
+            p++;
         }
-        inFile.close();
-    } else {
-        std::cerr << "unable to open " << filepath << std::endl;
+    }
+    if (res.lits.size() > res.start.back()) {
+        res.start.push_back(res.lits.size()); // last line without newline
     }
 
+    munmap((void*)data, len);
+    close(fd);
     return res;
 }
 
 
 /**
- * Gets the number of variables from a DIMACS (.cnf) file.
+ * Builds the BDD of a single clause directly as a chain of nodes.
  */
-int nvars_from_file(std::string filepath)
+static BDD
+clause_to_bdd(const Cnf &f, size_t i)
 {
-    std::string line;
-    std::string token;
-    std::ifstream inFile(filepath);
-    if (inFile.is_open()) {
-        while (getline(inFile, line)) {
-            std::istringstream ss(line);
-            while (ss >> token) {
-                if (token == "p") {
-                    ss >> token;
-                    if (token == "cnf") {
-                        ss >> token; // should be number of vars
-                        int nvars = std::stoi(token);
-                        inFile.close();
-                        return nvars;
-                    }
-                } else {
-                    break;
-                }
-            }
+    std::vector<int> lits(f.lits.begin() + f.start[i], f.lits.begin() + f.start[i+1]);
+    // bottom-up, so highest variable first
+    std::sort(lits.begin(), lits.end(), [](int a, int b) {
+        return abs(a) != abs(b) ? abs(a) > abs(b) : a < b;
+    });
+    BDD res = sylvan_false;
+    for (size_t k = 0; k < lits.size(); k++) {
+        int lit = lits[k];
+        if (k > 0 && abs(lits[k-1]) == abs(lit)) {
+            if (lits[k-1] != lit) return sylvan_true; // x v ~x
+            continue;
         }
-        inFile.close();
+        BDDVAR var = abs(lit)-1; // -1 to start vars at 0
+        if (lit > 0) res = sylvan_makenode(var, res, sylvan_true);
+        else res = sylvan_makenode(var, sylvan_true, res);
     }
-    return 0;
+    return res;
+}
+
+
+/**
+ * Conjunction of the clauses order[0], ..., order[count-1] as a balanced
+ * tree, with both halves computed in parallel. The halves are LocalBdds, on
+ * the refs stack of the worker.
+ */
+TASK_3(BDD, cnf_and_tree, const Cnf*, f, const uint32_t*, order, size_t, count)
+{
+    if (count == 0) return sylvan_true;
+    if (count == 1) return clause_to_bdd(*f, order[0]);
+
+    size_t half = count / 2;
+    bdd_refs_spawn(SPAWN(cnf_and_tree, f, order, half));
+    LocalBdd right = CALL(cnf_and_tree, f, order + half, count - half);
+    LocalBdd left = bdd_refs_sync(SYNC(cnf_and_tree));
+    return (left & right).GetBDD();
 }
 
 
 /**
- * Converts a CNF object (set of sets) into a BDD (with vars starting at 0).
+ * Returns the clauses of f sorted by their lowest variable, so that
+ * neighbouring clauses mostly share the top of their BDDs.
  */
-Bdd cnf_to_bdd(Cnf f, bool is_state)
+static std::vector<uint32_t>
+clause_order(const Cnf &f, bool is_state)
 {
-    Bdd res = Bdd::bddOne();
-    for (Clause clause : f){
-        Bdd c = Bdd::bddZero();
-        for (int lit : clause) {
-            if (lit != 0) {
-                int var = abs(lit);
-                if (is_state && (var % 2 == 0)) {
-                    Abort("Found state var %d; all state vars should be odd\n", var)
-                }
-                Bdd l = Bdd::bddVar(abs(lit)-1); // -1 to start vars at 0
-                if (lit < 0) l = !l;
-                c = c | l;
+    size_t n = f.nclauses();
+    std::vector<int> lowest(n);
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        int low = INT32_MAX;
+        for (size_t k = f.start[i]; k < f.start[i+1]; k++) {
+            int var = abs(f.lits[k]);
+            if (is_state && (var % 2 == 0)) {
+                Abort("Found state var %d; all state vars should be odd\n", var)
             }
+            low = std::min(low, var);
         }
-        res = res & c;
+        lowest[i] = low;
+        order[i] = i;
     }
-    return res;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return lowest[a] != lowest[b] ? lowest[a] < lowest[b] : a < b;
+    });
+    return order;
+}
+
+
+/**
+ * Converts a CNF formula into a BDD (with vars starting at 0), conjoining
+ * the clauses in a balanced tree.
+ */
+Bdd cnf_to_bdd(const Cnf &f, bool is_state)
+{
+    std::vector<uint32_t> order = clause_order(f, is_state);
+    return Bdd(RUN(cnf_and_tree, &f, order.data(), order.size()));
+}
+
+
+/**
+ * Clusters the clauses of f (in order of their lowest variable) into
+ * conjunctive partitions. Clauses are added to the current partition as
+ * long as its BDD stays within max_nodes nodes.
+ *
+ * The nodes of the conjunction of a BDD of n nodes with a clause of k
+ * literals are nodes of that BDD or pairs of a (possibly complemented) node
+ * and a suffix of the clause, so there are at most (2k+1)*n+k of them. The
+ * nodes of a partition are only counted when this bound exceeds max_nodes.
+ */
+std::vector<Bdd> cnf_to_partitions(const Cnf &f, size_t max_nodes)
+{
+    std::vector<uint32_t> order = clause_order(f, false);
+    std::vector<Bdd> parts;
+    LocalBdd cluster = sylvan_true;
+    size_t cluster_nodes = 0; // upper bound on the nodes of cluster
+    for (uint32_t i : order) {
+        const size_t k = f.start[i+1] - f.start[i];
+        LocalBdd clause = clause_to_bdd(f, i);
+        LocalBdd merged = cluster & clause;
+        if (merged == cluster) continue;
+        size_t merged_nodes = (2*k+1)*cluster_nodes + k;
+        if (cluster != sylvan_true && merged_nodes > max_nodes) {
+            merged_nodes = sylvan_nodecount(merged.GetBDD());
+        }
+        if (cluster != sylvan_true && merged_nodes > max_nodes) {
+            parts.push_back(cluster.toBdd());
+            cluster = clause;
+            cluster_nodes = k;
+        } else {
+            cluster = merged;
+            cluster_nodes = merged_nodes;
+        }
+    }
+    if (cluster != sylvan_true || parts.empty()) {
+        parts.push_back(cluster.toBdd());
+    }
+    return parts;
 }
 
 
@@ -240,14 +376,12 @@ void load_cnfs_to_bdds()
     Cnf cnf_targ = cnf_from_file(t_file);
     Cnf cnf_r = cnf_from_file(r_file);
 
-    // Convert CNFs to BDDs
-    INFO("Converting CNFs to BDDs\n");
-    S = cnf_to_bdd(cnf_s, true).GetBDD();
-    R = cnf_to_bdd(cnf_r, false).GetBDD();
-    T = cnf_to_bdd(cnf_targ, true).GetBDD();
+    double t2 = wctime();
+    stats.parse_time = t2-t1;
+    INFO("Parse time: %f\n", stats.parse_time);
 
     // Get state vars (assumes state vars = [0, 2, 4, ...,2*(n-1)])
-    int nvars = nvars_from_file(s_file);
+    int nvars = cnf_s.nvars;
     if (nvars == 0) {
         Abort("Something went wrong parsing nvars from %s\n", s_file.c_str());
     }
@@ -257,8 +391,27 @@ void load_cnfs_to_bdds()
     }
     vars = sylvan_set_fromarray(vars_arr, nvars);
 
-    double t2 = wctime();
-    stats.load_time = t2-t1;
+    // Convert CNFs to BDDs
+    INFO("Converting CNFs to BDDs\n");
+    S = cnf_to_bdd(cnf_s, true).GetBDD();
+    T = cnf_to_bdd(cnf_targ, true).GetBDD();
+    if (partition_size == 0) {
+        R = cnf_to_bdd(cnf_r, false).GetBDD();
+    } else {
+        std::vector<Bdd> parts = cnf_to_partitions(cnf_r, partition_size);
+        std::vector<BDD> raw;
+        size_t max_nodes = 0;
+        for (const Bdd &p : parts) {
+            raw.push_back(p.GetBDD());
+            max_nodes = std::max(max_nodes, p.NodeCount());
+        }
+        bdd_conj_rel_init(&R_conj, raw.data(), raw.size(), vars);
+        INFO("Relation has %zu partition(s) of at most %zu node(s)\n", parts.size(), max_nodes);
+    }
+
+    double t3 = wctime();
+    stats.build_time = t3-t2;
+    INFO("Build time: %f\n", stats.build_time);
 
     INFO("counting states...\n");
     INFO("Source set has %'0.0f state(s)\n", sylvan_satcount(S, vars));
@@ -285,6 +438,7 @@ int main(int argc, char** argv)
     sylvan::sylvan_protect(&S);
     sylvan::sylvan_protect(&T);
     sylvan::sylvan_protect(&R);
+    sylvan::sylvan_protect(&vars);
     load_cnfs_to_bdds();
 
     INFO("Computing reachability...\n");
@@ -295,13 +449,21 @@ int main(int argc, char** argv)
         double t1 = wctime();
         // TODO: not sure if this works in all cases, since R has vars (a) which
         // aren't in the state space (but they are at the bottom of the DD)
-        reachable = bdd_reach(S, R, vars);
+        if (partition_size == 0) {
+            reachable = bdd_reach(S, R, vars);
+        } else {
+            reachable = bdd_reach_conj(S, &R_conj);
+        }
         double t2 = wctime();
         stats.reach_time = t2-t1;
         INFO("REACH Time: %f\n", stats.reach_time);
     } else if (strategy == strat_bfs) {
         double t1 = wctime();
-        reachable = simple_bfs(S, R, T, vars, &(stats.nsteps));
+        if (partition_size == 0) {
+            reachable = simple_bfs(S, R, T, vars, &(stats.nsteps));
+        } else {
+            reachable = simple_bfs_conj(S, &R_conj, T, &(stats.nsteps));
+        }
         double t2 = wctime();
         stats.reach_time = t2-t1;
         INFO("BFS Time: %f\n", stats.reach_time);
@@ -331,15 +493,20 @@ int main(int argc, char** argv)
     INFO("Writing stats to %s\n", stats_filename.c_str());
     std::ofstream statsfile;
     statsfile.open(stats_filename, std::ios_base::app);
+    // the load time (parse and build) keeps its column, the split is appended
     statsfile << s_file << ", " 
-              << stats.load_time << ", " 
+              << stats.parse_time + stats.build_time << ", "
               << stats.reach_time << ", "
               << stats.reachable << ", "
-              << stats.nsteps << std::endl;
+              << stats.nsteps << ", "
+              << stats.parse_time << ", "
+              << stats.build_time << std::endl;
     
     sylvan::sylvan_unprotect(&S);
     sylvan::sylvan_unprotect(&T);
     sylvan::sylvan_unprotect(&R);
+    sylvan::sylvan_unprotect(&vars);
+    if (partition_size != 0) bdd_conj_rel_free(&R_conj);
 
     sylvan_quit();
     lace_stop();
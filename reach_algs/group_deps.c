@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "group_deps.h"
+
+/* Do the sorted arrays a and b have an element in common? */
+static int
+proj_intersect(const int *a, int a_k, const int *b, int b_k)
+{
+    int i = 0, j = 0;
+    while (i < a_k && j < b_k) {
+        if (a[i] == b[j]) return 1;
+        if (a[i] < b[j]) i++;
+        else j++;
+    }
+    return 0;
+}
+
+int
+groups_dependent(const group_proj_t *a, const group_proj_t *b)
+{
+    return proj_intersect(a->w_proj, a->w_k, b->r_proj, b->r_k) ||
+           proj_intersect(a->w_proj, a->w_k, b->w_proj, b->w_k) ||
+           proj_intersect(b->w_proj, b->w_k, a->r_proj, a->r_k);
+}
+
+char *
+compute_group_deps(const group_proj_t *g, int count)
+{
+    char *deps = (char*)malloc(count * count);
+    for (int k=0; k<count; k++) {
+        for (int j=0; j<count; j++) {
+            deps[k*count+j] = j == k || groups_dependent(&g[k], &g[j]);
+        }
+    }
+    return deps;
+}
+
+int
+independent_run(const char *deps, int count, int first, int last)
+{
+    int end = first + 1;
+    for (; end < last; end++) {
+        for (int i=first; i<end; i++) {
+            if (deps[i*count+end]) return end - first;
+        }
+    }
+    return end - first;
+}
+
+void
+sched_init(group_sched_t *sched, const char *deps, int count)
+{
+    sched->deps = deps;
+    sched->count = count;
+    sched->cur = (char*)malloc(count);
+    sched->nxt = (char*)calloc(count, 1);
+    sched->batch = (int*)malloc(sizeof(int[count]));
+    memset(sched->cur, 1, count);
+}
+
+void
+sched_free(group_sched_t *sched)
+{
+    free(sched->cur);
+    free(sched->nxt);
+    free(sched->batch);
+}
+
+int
+sched_take_batch(group_sched_t *sched, int k)
+{
+    const int count = sched->count;
+    int n = 0;
+    for (int j=k; j<count; j++) {
+        if (!sched->cur[j]) continue;
+        for (int b=0; b<n; b++) {
+            if (sched->deps[sched->batch[b]*count+j]) return n;
+        }
+        sched->batch[n++] = j;
+        sched->cur[j] = 0;
+    }
+    return n;
+}
+
+void
+sched_dependents(group_sched_t *sched, int k, int self)
+{
+    const int count = sched->count;
+    for (int j=0; j<count; j++) {
+        if (!sched->deps[k*count+j] || (j == k && !self)) continue;
+        if (j > k) sched->cur[j] = 1;
+        else sched->nxt[j] = 1;
+    }
+}
+
+int
+sched_next_pass(group_sched_t *sched)
+{
+    char *t = sched->cur;
+    sched->cur = sched->nxt;
+    sched->nxt = t;
+    for (int k=0; k<sched->count; k++) if (sched->cur[k]) return 1;
+    return 0;
+}
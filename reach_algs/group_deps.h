@@ -0,0 +1,62 @@
+#ifndef GROUP_DEPS_H
+#define GROUP_DEPS_H
+
+/**
+ * Dependencies between transition groups, for scheduling in saturation,
+ * chaining and chain_rec (bddmc and lddmc). Groups j and k are dependent if
+ * one of them writes a variable that the other reads or writes. Independent
+ * groups commute: if all states were closed under j before k produced new
+ * states, they still are afterwards. So they can be applied to the same set
+ * in parallel. That can give fewer states in one step than applying them one
+ * after another, where the second group also sees the successors of the
+ * first, but the fixpoint is the same.
+ */
+
+/* The state variables that a group reads and writes, in increasing order */
+typedef struct group_proj {
+    int r_k, w_k;
+    const int *r_proj, *w_proj;
+} group_proj_t;
+
+/* Are groups a and b dependent? */
+int groups_dependent(const group_proj_t *a, const group_proj_t *b);
+
+/**
+ * Dependency matrix of the groups g[0..count-1], allocated with malloc:
+ * deps[k*count+j] is set if j depends on k (or j == k)
+ */
+char *compute_group_deps(const group_proj_t *g, int count);
+
+/* Number of pairwise independent groups first, first+1, ... (before last) */
+int independent_run(const char *deps, int count, int first, int last);
+
+/**
+ * Worklist of the chaining strategies. Every pass visits the scheduled groups
+ * in order and takes consecutive groups that are pairwise independent as one
+ * batch. A group that produces new states schedules its dependent groups, in
+ * the current pass if they come after it, otherwise in the next pass.
+ */
+typedef struct group_sched {
+    const char *deps;
+    int count;
+    char *cur, *nxt; // scheduled in the current and in the next pass
+    int *batch;
+} group_sched_t;
+
+/* Worklist over the groups of deps, with all groups in the first pass */
+void sched_init(group_sched_t *sched, const char *deps, int count);
+void sched_free(group_sched_t *sched);
+
+/**
+ * Take the scheduled groups from k on, as long as they are pairwise
+ * independent, into sched->batch and unschedule them; returns the batch size
+ */
+int sched_take_batch(group_sched_t *sched, int k);
+
+/* Schedule the groups that depend on group k (and k itself if self is set) */
+void sched_dependents(group_sched_t *sched, int k, int self);
+
+/* Start the next pass, returns 0 if no group is scheduled for it */
+int sched_next_pass(group_sched_t *sched);
+
+#endif
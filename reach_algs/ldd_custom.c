@@ -1,4 +1,5 @@
 #include "ldd_custom.h"
+#include "ldd_wide.h"
 #include "cache_op_ids.h"
 
 #define Abort(...) { fprintf(stderr, __VA_ARGS__); fprintf(stderr, "Abort at line %d!\n", __LINE__); exit(-1); }
@@ -54,45 +55,66 @@ get_next_meta(MDD meta)
 }
 
 
+/**
+ * Move iterator over MDD chain to the right until value is reached (or passed)
+ */
 static int
-match_ldds(MDD *one, MDD *two)
+match_ldd(lddmc_wide_itr_t *itr, uint32_t value)
 {
-    MDD m1 = *one, m2 = *two;
-    if (m1 == lddmc_false || m2 == lddmc_false) return 0;
-    mddnode_t n1 = LDD_GETNODE(m1), n2 = LDD_GETNODE(m2);
-    uint32_t v1 = mddnode_getvalue(n1), v2 = mddnode_getvalue(n2);
-    while (v1 != v2) {
-        if (v1 < v2) {
-            m1 = mddnode_getright(n1);
-            if (m1 == lddmc_false) return 0;
-            n1 = LDD_GETNODE(m1);
-            v1 = mddnode_getvalue(n1);
-        } else if (v1 > v2) {
-            m2 = mddnode_getright(n2);
-            if (m2 == lddmc_false) return 0;
-            n2 = LDD_GETNODE(m2);
-            v2 = mddnode_getvalue(n2);
-        }
-    }
-    *one = m1;
-    *two = m2;
-    return 1;
+    assert(itr->node != lddmc_true);
+    if (itr->node == lddmc_false) return 0;
+    return lddmc_wide_seek(itr, value);
+}
+
+/**
+ * Homomorphism reads are sorted after all normal reads (flag 0x80000000), so
+ * the homomorphism part of a chain can be found with a single seek.
+ */
+static inline void
+seek_hmorph_reads(lddmc_wide_itr_t *itr)
+{
+    lddmc_wide_seek(itr, 0x80000000);
 }
 
 /**
- * Move MDD one to the right until value is reached (or passed)
+ * Move set and rel (both not copy nodes) to the right, skipping the values of
+ * set which no read of rel can match and the normal reads of rel which match
+ * no value of set. A homomorphism read i matches every value >= i.
+ * Returns 0 if no read of rel matches any value of set.
  */
 static int
-match_ldd(MDD *one, uint32_t value)
+match_reads(MDD *set, MDD *rel)
 {
-    assert(*one != lddmc_true);
-    if (*one == lddmc_false) return 0;
+    lddmc_wide_itr_t itr_s, itr_r, itr_h;
+    lddmc_wide_start(&itr_s, *set);
+    lddmc_wide_start(&itr_r, *rel);
+    lddmc_wide_start(&itr_h, *rel);
+
+    // smallest value matched by some homomorphism read
+    uint32_t h_min = UINT32_MAX;
+    seek_hmorph_reads(&itr_h);
+    if (itr_h.node != lddmc_false) {
+        h_min = lddmc_wide_value(&itr_h);
+        lddmc_is_homomorphism(&h_min);
+    }
 
-    while (lddmc_getvalue(*one) < value) {
-        *one = lddmc_getright(*one);
-        if (*one == lddmc_false) return 0;
+    for (;;) {
+        uint32_t v = lddmc_wide_value(&itr_s);
+        if (v >= h_min) break;
+        if (lddmc_wide_seek(&itr_r, v)) break;
+
+        // no read of rel matches the values of set below i
+        uint32_t i = h_min;
+        if (itr_r.node != lddmc_false) {
+            uint32_t r = lddmc_wide_value(&itr_r);
+            if (!(r & 0x80000000) && r < h_min) i = r;
+        }
+        if (lddmc_wide_seek(&itr_s, i)) continue;
+        if (itr_s.node == lddmc_false) return 0;
     }
-    if (lddmc_getvalue(*one) != value) return 0;
+
+    *set = itr_s.node;
+    *rel = itr_r.node;
     return 1;
 }
 
@@ -154,10 +176,9 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
     }
 
     /* Skip nodes if possible */
-    // NOTE: we cannot sync because of possible hmorph nodes
-    //if (!lddmc_iscopy(rel)) {
-    //    if (!match_ldds(&set, &rel)) return lddmc_false;
-    //}
+    if (!lddmc_iscopy(rel)) {
+        if (!match_reads(&set, &rel)) return lddmc_false;
+    }
 
     /* Consult cache */
     MDD res = lddmc_false;
@@ -168,9 +189,11 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
     // TODO: rename itr_r, itr_w to itr_i, itr_j ?
     // TODO: maybe we could do with fewer helper MDDs in this function
     MDD _rel     = rel;           lddmc_refs_pushptr(&_rel);
-    MDD itr_r    = lddmc_false;   lddmc_refs_pushptr(&itr_r);
+    lddmc_wide_itr_t itr_r;       lddmc_wide_start(&itr_r, lddmc_false);
+    lddmc_refs_pushptr(&itr_r.node);
     MDD itr_w    = lddmc_false;   lddmc_refs_pushptr(&itr_w);
-    MDD itr_set  = lddmc_false;   lddmc_refs_pushptr(&itr_set);
+    lddmc_wide_itr_t itr_set;     lddmc_wide_start(&itr_set, lddmc_false);
+    lddmc_refs_pushptr(&itr_set.node);
     MDD rel_ij   = lddmc_false;   lddmc_refs_pushptr(&rel_ij);
     MDD set_i    = lddmc_false;   lddmc_refs_pushptr(&set_i);
     MDD rel_i    = lddmc_false;   lddmc_refs_pushptr(&rel_i); // might be possible to only use itr_w
@@ -189,10 +212,10 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
             rel_ij = lddmc_getdown(rel_i); // j = i
 
             // Iterate over all reads of 'set'
-            for (itr_r = set; itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
+            for (lddmc_wide_start(&itr_r, set); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
                 
-                uint32_t i = lddmc_getvalue(itr_r);
-                set_i = lddmc_getdown(itr_r);
+                uint32_t i = lddmc_wide_value(&itr_r);
+                set_i = lddmc_wide_down(&itr_r);
 
                 // Compute successors T_i = S_i.R_ii
                 tmp = CALL(lddmc_image, set_i, rel_ij, next_meta);
@@ -209,10 +232,10 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
 
         // Iterate over all reads of 'set'
         // TODO: we only need to iterate over homomorphism nodes (although they are currently at the back)
-        for (itr_r = set; itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
+        for (lddmc_wide_start(&itr_r, set); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
             
-            uint32_t i = lddmc_getvalue(itr_r);
-            set_i = lddmc_getdown(itr_r);
+            uint32_t i = lddmc_wide_value(&itr_r);
+            set_i = lddmc_wide_down(&itr_r);
 
             // Iterate over all writes (j) of rel
             for (itr_w = rel_i; itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
@@ -231,54 +254,64 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
         _rel = lddmc_getright(_rel);
     }
 
-    // Iterate over all reads (i) of 'rel'
-    itr_set = set;
-    for (itr_r = _rel; itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
+    // Iterate over all normal reads (i) of 'rel', merge-joined with 'set'
+    lddmc_wide_start(&itr_r, _rel);
+    lddmc_wide_start(&itr_set, set);
+    while (itr_r.node != lddmc_false && itr_set.node != lddmc_false) {
 
-        uint32_t i = lddmc_getvalue(itr_r);
-    
-        // hmorph on read level is interpreted as "can sync on all reads >= i"
-        if (lddmc_is_homomorphism(&i)) {
+        uint32_t i = lddmc_wide_value(&itr_r);
+        if (i & 0x80000000) break; // only homomorphisms left
 
-            // Iterate over all writes (j) corresponding to this read
-            for (itr_w = lddmc_getdown(itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+        if (!match_ldd(&itr_set, i)) {
+            // skip reads of rel up to the next read of set
+            if (itr_set.node != lddmc_false)
+                lddmc_wide_seek(&itr_r, lddmc_wide_value(&itr_set));
+            continue;
+        }
+        set_i = lddmc_wide_down(&itr_set);
 
-                uint32_t j = lddmc_getvalue(itr_w);
+        // Iterate over all writes (j) corresponding to this read
+        for (itr_w = lddmc_wide_down(&itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
 
-                // Iterate over all reads (v) of set
-                for (itr_set = set; itr_set != lddmc_false; itr_set = lddmc_getright(itr_set)) {
-                    uint32_t v = lddmc_getvalue(itr_set);
-                    if (v >= i) {
-                        // Compute successors T_j = S_i.R_ij
-                        rel_ij = lddmc_getdown(itr_w);
-                        set_i = lddmc_getdown(itr_set);
-                        tmp = CALL(lddmc_image, set_i, rel_ij, next_meta);
-
-                        // Write (hmorph) j and add to successors
-                        tmp = apply_write(v, j, tmp);
-                        res = CALL(lddmc_union, res, tmp);
-                    }
-                }
-            }
+            uint32_t j = lddmc_getvalue(itr_w);
+            rel_ij = lddmc_getdown(itr_w); // equiv to following i then j
 
+            // Compute successors T_j = S_i.R_ij
+            tmp = CALL(lddmc_image, set_i, rel_ij, next_meta);
+
+            // Extend succ_j and add to successors
+            tmp = lddmc_make_normalnode(j, tmp, lddmc_false);
+            res = lddmc_union(res, tmp);
         }
-        else { // THIS IS THE ACTUAL NORMAL "READ i, WRITE j"
-            if (match_ldd(&itr_set, i)) { // match the read (i) in rel with set
-                set_i = lddmc_getdown(itr_set);         
+        lddmc_wide_next(&itr_r);
+    }
 
-                // Iterate over all writes (j) corresponding to this read
-                for (itr_w = lddmc_getdown(itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+    // Iterate over all homomorphism reads (i) of 'rel'
+    // hmorph on read level is interpreted as "can sync on all reads >= i"
+    lddmc_wide_start(&itr_r, _rel);
+    for (seek_hmorph_reads(&itr_r); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
 
-                    uint32_t j = lddmc_getvalue(itr_w);
-                    rel_ij = lddmc_getdown(itr_w); // equiv to following i then j
+        uint32_t i = lddmc_wide_value(&itr_r);
+        lddmc_is_homomorphism(&i);
 
-                    // Compute successors T_j = S_i.R_ij
-                    tmp = CALL(lddmc_image, set_i, rel_ij, next_meta);
-                
-                    // Extend succ_j and add to successors
-                    tmp = lddmc_make_normalnode(j, tmp, lddmc_false);
-                    res = lddmc_union(res, tmp);
-                }
+        // Iterate over all writes (j) corresponding to this read
+        for (itr_w = lddmc_wide_down(&itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+
+            uint32_t j = lddmc_getvalue(itr_w);
+
+            // Iterate over all reads (v >= i) of set
+            lddmc_wide_start(&itr_set, set);
+            for (lddmc_wide_seek(&itr_set, i); itr_set.node != lddmc_false; lddmc_wide_next(&itr_set)) {
+                uint32_t v = lddmc_wide_value(&itr_set);
+
+                // Compute successors T_j = S_i.R_ij
+                rel_ij = lddmc_getdown(itr_w);
+                set_i = lddmc_wide_down(&itr_set);
+                tmp = CALL(lddmc_image, set_i, rel_ij, next_meta);
+
+                // Write (hmorph) j and add to successors
+                tmp = apply_write(v, j, tmp);
+                res = CALL(lddmc_union, res, tmp);
             }
         }
     }
@@ -291,6 +324,25 @@ TASK_IMPL_3(MDD, lddmc_image, MDD, set, MDD, rel, MDD, meta)
     return res;
 }
 
+/**
+ * Helper for lddmc_image2 on a read of multiple values (copy or homomorphism):
+ * union of the images of rel for every read of set, in parallel
+ */
+TASK_3(MDD, image2_all_reads, MDD, set, MDD, rel, MDD, next_meta)
+{
+    if (set == lddmc_false) return lddmc_false;
+
+    lddmc_refs_spawn(SPAWN(image2_all_reads, lddmc_getright(set), rel, next_meta));
+    MDD down = CALL(lddmc_image2, set, rel, next_meta);
+    lddmc_refs_push(down);
+    MDD right = lddmc_refs_sync(SYNC(image2_all_reads));
+    lddmc_refs_push(right);
+    MDD res = lddmc_union(down, right);
+    lddmc_refs_pop(2);
+    return res;
+}
+
+
 TASK_IMPL_3(MDD, lddmc_image2, MDD, set, MDD, rel, MDD, meta)
 {
     if (set == lddmc_false) return lddmc_false; // empty.R = empty
@@ -315,75 +367,95 @@ TASK_IMPL_3(MDD, lddmc_image2, MDD, set, MDD, rel, MDD, meta)
 
     /* Skip nodes if possible */
     if (m_val == 1 && !lddmc_iscopy(rel)) {
-        if (!match_ldds(&set, &rel)) return lddmc_false;
+        if (!match_reads(&set, &rel)) return lddmc_false;
     }
 
     /* Consult cache */
     MDD res = lddmc_false;
     if (cache_get3(CACHE_LDD_IMAGE, set, rel, meta, &res)) return res;
-    lddmc_refs_pushptr(&res);
-
-
-    //mddnode_t n_set = LDD_GETNODE(set);
-    //mddnode_t n_rel = LDD_GETNODE(rel);
-    MDD _set = set, _rel = rel, tmp = lddmc_false;
-    lddmc_refs_pushptr(&_set);
-    lddmc_refs_pushptr(&_rel);
-    lddmc_refs_pushptr(&tmp);
 
     /* Recursive operations */
-    if (m_val == 1) { // read
-
-        tmp = CALL(lddmc_image2, _set, lddmc_getright(_rel), meta);
-        res = lddmc_union(res, tmp);
+    // Other reads / writes of rel (right) in parallel with this one (down)
+    lddmc_refs_spawn(SPAWN(lddmc_image2, set, lddmc_getright(rel), meta));
 
-        // for this read, either it is copy ('for all') or it is normal match
-        if (lddmc_iscopy(_rel)) {
+    MDD down = lddmc_false;
+    mddnode_t n_rel = LDD_GETNODE(rel);
+    if (m_val == 1) { // read
 
-            // call for every read value of set
-            for (; _set != lddmc_false; _set = lddmc_getright(_set)) {
-                // stay at same level of set (for write)
-                tmp = CALL(lddmc_image2, _set, lddmc_getdown(_rel), next_meta);
-                res = CALL(lddmc_union, res, tmp);
-            }
+        uint32_t i = mddnode_getvalue(n_rel);
+        if (mddnode_getcopy(n_rel)) {
+            // copy reads every value of set
+            // stay at same level of set (for write)
+            down = CALL(image2_all_reads, set, mddnode_getdown(n_rel), next_meta);
+        }
+        else if (lddmc_is_homomorphism(&i)) {
+            // hmorph on read level is interpreted as "can sync on all reads >= i"
+            lddmc_wide_itr_t itr_set;
+            lddmc_wide_start(&itr_set, set);
+            lddmc_wide_seek(&itr_set, i);
+            down = CALL(image2_all_reads, itr_set.node, mddnode_getdown(n_rel), next_meta);
         }
         else {
-            // if not copy, then set&rel are already matched
-            // stay at the same level of set (for write)
-            tmp = CALL(lddmc_image2, _set, lddmc_getdown(_rel), next_meta);
-            res = CALL(lddmc_union, res, tmp);
+            // normal read: set was matched above, unless only (lower)
+            // homomorphism reads prevented skipping ahead
+            lddmc_wide_itr_t itr_set;
+            lddmc_wide_start(&itr_set, set);
+            if (match_ldd(&itr_set, i)) {
+                // stay at the same level of set (for write)
+                down = CALL(lddmc_image2, itr_set.node, mddnode_getdown(n_rel), next_meta);
+            }
         }
     }
     else if (m_val == 2) { // write
 
-        // call for every value to write (rel)
-        for (;;) {
-            uint32_t j;
-            if (lddmc_iscopy(_rel)) j = lddmc_getvalue(_set);
-            else j = lddmc_getvalue(_rel);
+        // copy writes the value that was read (i.e. the value of set)
+        uint32_t v = lddmc_getvalue(set);
+        uint32_t j = mddnode_getcopy(n_rel) ? v : mddnode_getvalue(n_rel);
 
-            // down recursive call
-            tmp = CALL(lddmc_image2, lddmc_getdown(_set), lddmc_getdown(_rel), next_meta);
-            
-            // Write j (or some hmorph) and add to successors
-            tmp = apply_write(lddmc_getvalue(_set), j, tmp);
-            res = CALL(lddmc_union, res, tmp);
+        // down recursive call
+        down = CALL(lddmc_image2, lddmc_getdown(set), mddnode_getdown(n_rel), next_meta);
 
-            _rel = lddmc_getright(_rel);
-            if (_rel == lddmc_false) break;
-            //n_rel = LDD_GETNODE(rel);
-        }
+        // Write j (or some hmorph) and add to successors
+        down = apply_write(v, j, down);
     }
     else {
         printf("unexpected m_val = %d\n", m_val);
         exit(1);
     }
 
+    lddmc_refs_push(down);
+    MDD right = lddmc_refs_sync(SYNC(lddmc_image2));
+    lddmc_refs_push(right);
+    res = lddmc_union(down, right);
+    lddmc_refs_pop(2);
+
     /* Put in cache */
     cache_put3(CACHE_LDD_IMAGE, set, rel, meta, res);
 
-    lddmc_refs_popptr(4);
+    return res;
+}
+
+
+/**
+ * Relation which copies the remaining `nvars` variables (i.e. nvars/2 pairs
+ * of copy nodes). These suffixes are shared by all extended transition
+ * groups, so they are built once per depth and then taken from the cache.
+ */
+TASK_1(MDD, identity_rel, uint32_t, nvars)
+{
+    if (nvars == 0) return lddmc_true;
+
+    MDD res = lddmc_false;
+    if (cache_get3(CACHE_LDD_IDENTITY_REL, nvars, 0, 0, &res)) return res;
+
+    assert(nvars >= 2);
+    res = CALL(identity_rel, nvars - 2);
+    lddmc_refs_pushptr(&res);
+    res = lddmc_make_copynode(res, lddmc_false);
+    res = lddmc_make_copynode(res, lddmc_false);
+    lddmc_refs_popptr(1);
 
+    cache_put3(CACHE_LDD_IDENTITY_REL, nvars, 0, 0, res);
     return res;
 }
 
@@ -402,8 +474,9 @@ TASK_3(MDD, only_read_helper, MDD, right, MDD, next_meta, MDD, next_nvars)
     
     lddmc_refs_pushptr(&next_right);
     lddmc_refs_pushptr(&down);
-    next_right = CALL(only_read_helper, next_right, next_meta, next_nvars);
+    lddmc_refs_spawn(SPAWN(only_read_helper, next_right, next_meta, next_nvars));
     down       = CALL(lddmc_extend_rel, down, next_meta, next_nvars);
+    next_right = lddmc_refs_sync(SYNC(only_read_helper));
     lddmc_refs_popptr(2);
     return lddmc_makenode(value, down, next_right);
 }
@@ -435,16 +508,8 @@ TASK_IMPL_3(MDD, lddmc_extend_rel, MDD, rel, MDD, meta, uint32_t, nvars)
     // In case of 5 or -1, we'll consider all the remaining vars as skipped and
     // insert two levels of * for them.
     if (meta_val == 5 || meta_val == (uint32_t)-1) {
-        res = lddmc_true;
         assert (nvars % 2 == 0);
-        for (uint32_t i = 0; i < (nvars/2); i++) {
-            res = lddmc_make_copynode(res, lddmc_false);
-            res = lddmc_make_copynode(res, lddmc_false);
-        }
-        /* Put in cache */
-        cache_put3(CACHE_LDD_EXTEND_REL, rel, meta, nvars, res);
-
-        return res;
+        return CALL(identity_rel, nvars);
     }
 
     /* Get right and down */
@@ -477,11 +542,23 @@ TASK_IMPL_3(MDD, lddmc_extend_rel, MDD, rel, MDD, meta, uint32_t, nvars)
     else
         next_nvars = nvars - 2; // for meta_val=0, 3, or 4 we step 2 vars
 
-    /* Call function on children */
+    /* Call function on children (right in parallel with down) */
     assert(right != lddmc_true);
-    if (right != lddmc_false && meta_val != 4)
-        right = CALL(lddmc_extend_rel, right, meta, nvars);
+    if (right != lddmc_false) {
+        // if meta = 4, use only_read_helper to avoid recursive calls to
+        // extend on right-children
+        if (meta_val == 4)
+            lddmc_refs_spawn(SPAWN(only_read_helper, right, next_meta, next_nvars));
+        else
+            lddmc_refs_spawn(SPAWN(lddmc_extend_rel, right, meta, nvars));
+    }
     down = CALL(lddmc_extend_rel, down, next_meta, next_nvars);
+    if (right != lddmc_false) {
+        if (meta_val == 4)
+            right = lddmc_refs_sync(SYNC(only_read_helper));
+        else
+            right = lddmc_refs_sync(SYNC(lddmc_extend_rel));
+    }
 
     
     // meta == 'skipped variable' : change into two levels of *
@@ -527,10 +604,7 @@ TASK_IMPL_3(MDD, lddmc_extend_rel, MDD, rel, MDD, meta, uint32_t, nvars)
         }
     }
     else if (meta_val == 4) {
-        // if meta = 4, use this helper to avoid recursive calls to extend on
-        // right-children
         //assert(!lddmc_iscopy(rel) && "meta_val == 4");
-        right = CALL(only_read_helper, right, next_meta, next_nvars);
         if (lddmc_iscopy(rel)) {
             down = lddmc_make_copynode(down, right);
             res = lddmc_make_copynode(down, lddmc_false);
@@ -561,6 +635,9 @@ TASK_IMPL_2(MDD, lddmc_rel_union, MDD, a, MDD, b)
     if (b == lddmc_false) return a;
     assert(a != lddmc_true && b != lddmc_true); // expect same lenght
 
+    /* Improve cache behavior */
+    if (a < b) { MDD tmp=b; b=a; a=tmp; }
+
     /* Consult cache */
     MDD res;
     if (cache_get3(CACHE_LDD_REL_UNION, a, b, 0, &res)) {
@@ -579,8 +656,11 @@ TASK_IMPL_2(MDD, lddmc_rel_union, MDD, a, MDD, b)
     /* Recursive calls */
     // (assume read level)
     if (na_copy && nb_copy) {
-        MDD down = CALL(lddmc_rel_union, mddnode_getdown(na), mddnode_getdown(nb));
+        lddmc_refs_spawn(SPAWN(lddmc_rel_union, mddnode_getdown(na), mddnode_getdown(nb)));
         MDD right = CALL(lddmc_rel_union, mddnode_getright(na), mddnode_getright(nb));
+        lddmc_refs_push(right);
+        MDD down = lddmc_refs_sync(SYNC(lddmc_rel_union));
+        lddmc_refs_pop(1);
         res = lddmc_make_copynode(down, right);
     }
     else if (na_copy) {
@@ -596,8 +676,11 @@ TASK_IMPL_2(MDD, lddmc_rel_union, MDD, a, MDD, b)
         res = lddmc_makenode(na_value, mddnode_getdown(na), right);
     }
     else if (na_value == nb_value) {
-        MDD down = CALL(lddmc_rel_union, mddnode_getdown(na), mddnode_getdown(nb));
+        lddmc_refs_spawn(SPAWN(lddmc_rel_union, mddnode_getdown(na), mddnode_getdown(nb)));
         MDD right = CALL(lddmc_rel_union, mddnode_getright(na), mddnode_getright(nb));
+        lddmc_refs_push(right);
+        MDD down = lddmc_refs_sync(SYNC(lddmc_rel_union));
+        lddmc_refs_pop(1);
         res = lddmc_makenode(na_value, down, right);
     }
     else /* na_value > nb_value */ {
@@ -624,11 +707,133 @@ extend_and_add(MDD set, uint32_t val, MDD ifeq)
 }
 
 
+TASK_IMPL_2(MDD, lddmc_rel_guard, MDD, rel, MDD, meta)
+{
+    /* Terminal cases */
+    if (rel == lddmc_false) return lddmc_false;
+    if (rel == lddmc_true) return lddmc_true;
+    if (meta == lddmc_true || lddmc_getvalue(meta) != 1) return lddmc_true;
+    // only (action) labels left, which don't restrict the source state
+
+    /* Consult cache */
+    MDD res;
+    if (cache_get3(CACHE_LDD_GUARD, rel, meta, 0, &res)) return res;
+
+    mddnode_t n = LDD_GETNODE(rel);
+    MDD next_meta = get_next_meta(meta);
+
+    /* Guard of the right siblings (other reads) */
+    lddmc_refs_spawn(SPAWN(lddmc_rel_guard, mddnode_getright(n), meta));
+
+    /* Collapse the writes belonging to this read */
+    MDD down = lddmc_false;
+    lddmc_refs_pushptr(&down);
+    for (MDD w = mddnode_getdown(n); w != lddmc_false; w = lddmc_getright(w)) {
+        MDD g = CALL(lddmc_rel_guard, lddmc_getdown(w), next_meta);
+        lddmc_refs_push(g);
+        down = CALL(lddmc_rel_union, down, g);
+        lddmc_refs_pop(1);
+    }
+
+    MDD right = lddmc_refs_sync(SYNC(lddmc_rel_guard));
+    if (down == lddmc_false) {
+        res = right;
+    } else {
+        lddmc_refs_push(right);
+        if (mddnode_getcopy(n)) res = lddmc_make_copynode(down, right);
+        else res = lddmc_makenode(mddnode_getvalue(n), down, right); // keeps hmorph flags
+        lddmc_refs_pop(1);
+    }
+    lddmc_refs_popptr(1);
+
+    /* Put in cache */
+    cache_put3(CACHE_LDD_GUARD, rel, meta, 0, res);
+
+    return res;
+}
+
+
+/**
+ * Cofactor of a guard for a state with value v at the top level: the union
+ * of the guards below the copy read, the read of v and the hmorph reads
+ * (which match all v >= i).
+ */
+TASK_2(MDD, guard_follow, MDD, guard, uint32_t, v)
+{
+    if (guard == lddmc_false || guard == lddmc_true) return guard;
+
+    MDD res = lddmc_false;
+    lddmc_refs_pushptr(&res);
+    for (MDD g = guard; g != lddmc_false; g = lddmc_getright(g)) {
+        mddnode_t n = LDD_GETNODE(g);
+        uint32_t i = mddnode_getvalue(n);
+        int match;
+        if (mddnode_getcopy(n)) {
+            match = 1;
+        } else if (lddmc_is_homomorphism(&i)) {
+            lddmc_hmorph_get_sign(&i);
+            match = v >= i;
+        } else {
+            match = i == v;
+        }
+        if (match) res = CALL(lddmc_rel_union, res, mddnode_getdown(n));
+    }
+    lddmc_refs_popptr(1);
+    return res;
+}
+
+
+TASK_IMPL_2(MDD, lddmc_guard_deadlocks, MDD, set, MDD, guard)
+{
+    /* Terminal cases */
+    if (set == lddmc_false) return lddmc_false;
+    if (guard == lddmc_false) return set;  // nothing enabled
+    if (guard == lddmc_true) return lddmc_false; // everything enabled
+    assert(set != lddmc_true); // expect same length
+
+    /* Consult cache */
+    MDD res;
+    if (cache_get3(CACHE_LDD_DEADLOCKS, set, guard, 0, &res)) return res;
+
+    mddnode_t n = LDD_GETNODE(set);
+    uint32_t v = mddnode_getvalue(n);
+
+    lddmc_refs_spawn(SPAWN(lddmc_guard_deadlocks, mddnode_getright(n), guard));
+    MDD guard_v = CALL(guard_follow, guard, v);
+    lddmc_refs_push(guard_v);
+    MDD down = CALL(lddmc_guard_deadlocks, mddnode_getdown(n), guard_v);
+    lddmc_refs_push(down);
+    MDD right = lddmc_refs_sync(SYNC(lddmc_guard_deadlocks));
+    res = down == lddmc_false ? right : lddmc_makenode(v, down, right);
+    lddmc_refs_pop(2);
+
+    /* Put in cache */
+    cache_put3(CACHE_LDD_DEADLOCKS, set, guard, 0, res);
+
+    return res;
+}
+
+
+/**
+ * Set by go_rec when it finds a reachable deadlock; checked by all go_rec
+ * calls that look for deadlocks so that they return as soon as possible.
+ */
+static volatile int reach_deadlock_found = 0;
+
+/* Record whether the states in set_i contain a deadlock w.r.t. guard_i */
+#define check_deadlock(set_i, guard_i) do { \
+    if (check && CALL(lddmc_guard_deadlocks, set_i, guard_i) != lddmc_false) \
+        reach_deadlock_found = 1; \
+} while (0)
+
 /**
  * ReachLDD: Implementation of recursive reachability algorithm for a single 
  * global relation.
+ *
+ * If guard is not lddmc_true, the search stops as soon as a state outside of
+ * the guard is reached (see lddmc_reach_deadlocks).
  */
-TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
+TASK_IMPL_5(MDD, go_rec, MDD, set, MDD, rel, MDD, guard, MDD, meta, int, img)
 {
     /* Terminal cases */
     if (set == lddmc_false) return lddmc_false; // empty.R* = empty
@@ -636,36 +841,46 @@ TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
     if (set == lddmc_true || rel == lddmc_true) return lddmc_true;
     // all.r* = all, s.all* = all (if s is not empty)
 
+    /* Another call already found a deadlock */
+    const int check = guard != lddmc_true;
+    if (check && reach_deadlock_found) return set;
+
     /* Assert assumptions about rel */
     assert(lddmc_getvalue(meta) == 1);
 
-    /* We can skip nodes if Rel requires a "read" which is not in S */
-    // NOTE: currently can't skip nodes because of hmorph nodes (which are at
-    // the end)
-    //if (!match_ldds(&set, &rel)) return lddmc_false;
+    /* Nothing is reachable beyond set if Rel requires a "read" which is not
+       in S (unlike in image, set itself can't be skipped because of the
+       reflexive closure) */
+    if (!lddmc_iscopy(rel)) {
+        MDD s = set, r = rel;
+        if (!match_reads(&s, &r)) return set;
+    }
 
     /* Consult cache */
     int cachenow = 1;
     if (cachenow) {
         MDD res;
-        if (cache_get3(CACHE_LDD_REACH, set, rel, 0, &res)) return res;
+        if (cache_get3(CACHE_LDD_REACH, set, rel, guard, &res)) return res;
     }
     
     /* Protect relevant MDDs */
     // TODO: maybe we could do with fewer helper MDDs in this function
     MDD next_meta = get_next_meta(meta); // Q: protect this?
     MDD prev      = lddmc_false;    lddmc_refs_pushptr(&prev);
-    MDD itr_r     = lddmc_false;    lddmc_refs_pushptr(&itr_r);
+    lddmc_wide_itr_t itr_r;         lddmc_wide_start(&itr_r, lddmc_false);
+    lddmc_refs_pushptr(&itr_r.node);
     MDD itr_w     = lddmc_false;    lddmc_refs_pushptr(&itr_w);
-    MDD itr_set   = lddmc_false;    lddmc_refs_pushptr(&itr_set);
+    lddmc_wide_itr_t itr_set;       lddmc_wide_start(&itr_set, lddmc_false);
+    lddmc_refs_pushptr(&itr_set.node);
     MDD rel_ij    = lddmc_false;    lddmc_refs_pushptr(&rel_ij);
     MDD set_i     = lddmc_false;    lddmc_refs_pushptr(&set_i);
     MDD rel_i     = lddmc_false;    lddmc_refs_pushptr(&rel_i); // might be possible to only use itr_w
     MDD _set      = set;            lddmc_refs_pushptr(&_set);
     MDD _rel      = rel;            lddmc_refs_pushptr(&_rel);
+    MDD guard_i   = guard;          lddmc_refs_pushptr(&guard_i);
 
     /* Loop until reachable set has converged */
-    while (_set != prev) {
+    while (_set != prev && !(check && reach_deadlock_found)) {
         prev = _set;
         _rel = rel;
 
@@ -682,15 +897,18 @@ TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
                 rel_ij = lddmc_getdown(rel_i); // j = i
 
                 // Iterate over all reads of 'set'
-                for (itr_r = _set; itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
-                    uint32_t i = lddmc_getvalue(itr_r);
-                    set_i = lddmc_getdown(itr_r);
+                for (lddmc_wide_start(&itr_r, _set); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
+                    uint32_t i = lddmc_wide_value(&itr_r);
+                    set_i = lddmc_wide_down(&itr_r);
 
                     // Compute REACH for S_i.R_ii* and add to set
-                    set_i = CALL(go_rec, set_i, rel_ij, next_meta, img);
+                    if (check) guard_i = CALL(guard_follow, guard, i);
+                    set_i = CALL(go_rec, set_i, rel_ij, guard_i, next_meta, img);
 
                     // Extend set_i and add to 'set'
                     _set = extend_and_add(_set, i, set_i);
+                    check_deadlock(set_i, guard_i);
+                    if (check && reach_deadlock_found) break;
                 }
 
                 // After (* -> *), there might still be (* -> j)'s
@@ -699,10 +917,10 @@ TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
             // 2b. rel = (* -> j), i.e. read anything, write j
             // Iterate over all reads (i) of 'set'
             _rel = lddmc_getright(_rel);
-            for (itr_r = _set; itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
+            for (lddmc_wide_start(&itr_r, _set); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
 
-                uint32_t i = lddmc_getvalue(itr_r);
-                set_i = lddmc_getdown(itr_r);
+                uint32_t i = lddmc_wide_value(&itr_r);
+                set_i = lddmc_wide_down(&itr_r);
 
                 // Iterate over over all writes (j) of rel
                 for (itr_w = rel_i; itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
@@ -711,7 +929,9 @@ TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
                     rel_ij = lddmc_getdown(itr_w); // equiv to following * then j
 
                     if (i == j) {
-                        set_i = CALL(go_rec, set_i, rel_ij, next_meta, img);
+                        if (check) guard_i = CALL(guard_follow, guard, i);
+                        set_i = CALL(go_rec, set_i, rel_ij, guard_i, next_meta, img);
+                        check_deadlock(set_i, guard_i);
                     }
                     else {
                         MDD succ_j;
@@ -733,88 +953,122 @@ TASK_IMPL_4(MDD, go_rec, MDD, set, MDD, rel, MDD, meta, int, img)
 
                 // Extend set_i and add to 'set'
                 _set = extend_and_add(_set, i, set_i);
+                if (check && reach_deadlock_found) break;
             }
         }
         
-        // 1b. normal reads and homomorphisms of rel
-        itr_set = _set;
-        for (itr_r = _rel;  itr_r != lddmc_false; itr_r = lddmc_getright(itr_r)) {
+        // 1b. normal reads of rel, merge-joined with the reads of set
+        lddmc_wide_start(&itr_r, _rel);
+        lddmc_wide_start(&itr_set, _set);
+        while (itr_r.node != lddmc_false && itr_set.node != lddmc_false) {
+
+            uint32_t i = lddmc_wide_value(&itr_r);
+            if (i & 0x80000000) break; // only homomorphisms left
+
+            if (!match_ldd(&itr_set, i)) {
+                // skip reads of rel up to the next read of set
+                if (itr_set.node != lddmc_false)
+                    lddmc_wide_seek(&itr_r, lddmc_wide_value(&itr_set));
+                continue;
+            }
+            set_i = lddmc_wide_down(&itr_set);
 
-            uint32_t i = lddmc_getvalue(itr_r);
+            // Iterate over all writes (j) corresponding to reading 'i'
+            for (itr_w = lddmc_wide_down(&itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
 
-            // hmorph on read level is interpreted as "can sync on all reads >= i"
-            if (lddmc_is_homomorphism(&i)) {
+                uint32_t j = lddmc_getvalue(itr_w);
+                rel_ij = lddmc_getdown(itr_w); // equiv to following i then j from rel
+                assert(!lddmc_is_homomorphism(&j)); // we shouldn't have homomorphisms after a normal read
 
-                // Iterate over all writes (j) corresponding to this read
-                for (itr_w = lddmc_getdown(itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+                if (i == j) {
+                    if (check) guard_i = CALL(guard_follow, guard, i);
+                    set_i = CALL(go_rec, set_i, rel_ij, guard_i, next_meta, img);
 
-                    uint32_t j = lddmc_getvalue(itr_w);
+                    // Extend set_i and add to 'set'
+                    _set = extend_and_add(_set, i, set_i);
+                    check_deadlock(set_i, guard_i);
+                }
+                else {
+                    // TODO: USE CALL instead of RUN?
+                    MDD succ_j;
+                    if (img == 1)
+                        succ_j = lddmc_image(set_i, rel_ij, next_meta);
+                    else if (img == 2)
+                        succ_j = lddmc_image2(set_i, rel_ij, next_meta);
+                    else
+                        succ_j = lddmc_relprod(set_i, rel_ij, next_meta);
 
-                    // Iterate over all reads (v) of set
-                    for (itr_set = _set; itr_set != lddmc_false; itr_set = lddmc_getright(itr_set)) {
-                        uint32_t v = lddmc_getvalue(itr_set);
-                        if (v >= i) {
-                            // Compute successors T_j = S_i.R_ij
-                            rel_ij = lddmc_getdown(itr_w);
-                            set_i  = lddmc_getdown(itr_set);
-                            MDD succ_j = CALL(lddmc_image, set_i, rel_ij, next_meta);
-
-                            // Write (hmorph) j and add to successors
-                            succ_j = apply_write(v, j, succ_j);
-                            lddmc_refs_push(succ_j);
-                            _set = CALL(lddmc_union, _set, succ_j);
-                            lddmc_refs_pop(1);
-                        }
-                    }
+                    // Extend succ_j and add to 'set'
+                    _set = extend_and_add(_set, j, succ_j);
                 }
-                
             }
-            else { // This is the actual normal "read i, write j"
-                if (match_ldd(&itr_set, i)) {
-                    set_i = lddmc_getdown(itr_set);
-
-                    // Iterate over all writes (j) corresponding to reading 'i'
-                    for (itr_w = lddmc_getdown(itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
-
-                        uint32_t j = lddmc_getvalue(itr_w);
-                        rel_ij = lddmc_getdown(itr_w); // equiv to following i then j from rel
-                        assert(!lddmc_is_homomorphism(&j)); // we shouldn't have homomorphisms after a normal read
-                        
-                        if (i == j) {
-                            set_i = CALL(go_rec, set_i, rel_ij, next_meta, img);
-
-                            // Extend set_i and add to 'set'
-                            _set = extend_and_add(_set, i, set_i);
-                        }
-                        else {
-                            // TODO: USE CALL instead of RUN?
-                            MDD succ_j;
-                            if (img == 1)
-                                succ_j = lddmc_image(set_i, rel_ij, next_meta);
-                            else if (img == 2)
-                                succ_j = lddmc_image2(set_i, rel_ij, next_meta);
-                            else
-                                succ_j = lddmc_relprod(set_i, rel_ij, next_meta);
-
-                            // Extend succ_j and add to 'set'
-                            _set = extend_and_add(_set, j, succ_j);
-                        }
-                    }
+            if (check && reach_deadlock_found) break;
+            lddmc_wide_next(&itr_r);
+        }
+
+        // 1c. homomorphism reads of rel
+        // hmorph on read level is interpreted as "can sync on all reads >= i"
+        lddmc_wide_start(&itr_r, _rel);
+        for (seek_hmorph_reads(&itr_r); itr_r.node != lddmc_false; lddmc_wide_next(&itr_r)) {
+
+            uint32_t i = lddmc_wide_value(&itr_r);
+            lddmc_is_homomorphism(&i);
+
+            // Iterate over all writes (j) corresponding to this read
+            for (itr_w = lddmc_wide_down(&itr_r); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+
+                uint32_t j = lddmc_getvalue(itr_w);
+
+                // Iterate over all reads (v >= i) of set
+                lddmc_wide_start(&itr_set, _set);
+                for (lddmc_wide_seek(&itr_set, i); itr_set.node != lddmc_false; lddmc_wide_next(&itr_set)) {
+                    uint32_t v = lddmc_wide_value(&itr_set);
+
+                    // Compute successors T_j = S_i.R_ij
+                    rel_ij = lddmc_getdown(itr_w);
+                    set_i  = lddmc_wide_down(&itr_set);
+                    MDD succ_j;
+                    if (img == 2)
+                        succ_j = CALL(lddmc_image2, set_i, rel_ij, next_meta);
+                    else
+                        succ_j = CALL(lddmc_image, set_i, rel_ij, next_meta);
+
+                    // Write (hmorph) j and add to successors
+                    succ_j = apply_write(v, j, succ_j);
+                    lddmc_refs_push(succ_j);
+                    _set = CALL(lddmc_union, _set, succ_j);
+                    lddmc_refs_pop(1);
                 }
             }
         }
+
+        // States only reached through writes i -> j (i != j) are not checked
+        // by the diagonal calls above
+        if (_set != prev) check_deadlock(_set, guard);
     }
 
-    lddmc_refs_popptr(9);
+    lddmc_refs_popptr(10);
 
-    /* Put in cache */
+    /* Put in cache (unless the search was cut short) */
+    if (check && reach_deadlock_found) cachenow = 0;
     if (cachenow)
-        cache_put3(CACHE_LDD_REACH, set, rel, 0, _set);
+        cache_put3(CACHE_LDD_REACH, set, rel, guard, _set);
 
     return _set;
 }
 
 
+MDD
+lddmc_reach_deadlocks(MDD set, MDD rel, MDD guard, MDD meta, int img, bool *found)
+{
+    reach_deadlock_found = 0;
+    MDD res = RUN(go_rec, set, rel, guard, meta, img);
+    *found = reach_deadlock_found || RUN(lddmc_guard_deadlocks, res, guard) != lddmc_false;
+    reach_deadlock_found = 0;
+    return res;
+}
+
+
 /**
  * REACH but now with right-recursion instead of loop over reads of rel
  */
@@ -829,6 +1083,12 @@ TASK_IMPL_4(MDD, go_rec2, MDD, set, MDD, rel, MDD, meta, int, img)
     // we'll still deal with the read and write levels in the same recursive call
     assert(lddmc_getvalue(meta) == 1);
 
+    /* Nothing is reachable beyond set if Rel requires a "read" which is not in S */
+    if (!lddmc_iscopy(rel)) {
+        MDD s = set, r = rel;
+        if (!match_reads(&s, &r)) return set;
+    }
+
     /* Consult cache */
     int cachenow = 1;
     if (cachenow) {
@@ -846,12 +1106,18 @@ TASK_IMPL_4(MDD, go_rec2, MDD, set, MDD, rel, MDD, meta, int, img)
     MDD rel_i     = lddmc_false;    lddmc_refs_pushptr(&rel_i); // might be possible to only use itr_w
     MDD _set      = set;            lddmc_refs_pushptr(&_set);
     MDD _rel      = rel;            lddmc_refs_pushptr(&_rel);
-
+    lddmc_wide_itr_t itr_set;       lddmc_wide_start(&itr_set, lddmc_false);
+    lddmc_refs_pushptr(&itr_set.node);
 
     /* Loop until reachable set has converged */
     while (_set != prev) {
         prev = _set;
 
+        // Instead of iterating over _rel to the right here, recursively call
+        // self on the other reads, in parallel with this read
+        // (note: prev protects the argument)
+        lddmc_refs_spawn(SPAWN(go_rec2, _set, lddmc_getright(_rel), meta, img));
+
         // 1. Iterate over all reads (i) of 'rel'
         // 1a. (possibly a copy node first)
         if (lddmc_iscopy(_rel)) {
@@ -929,9 +1195,43 @@ TASK_IMPL_4(MDD, go_rec2, MDD, set, MDD, rel, MDD, meta, int, img)
                 lddmc_refs_pop(1);
             }
         }
+        else if (lddmc_getvalue(_rel) & 0x80000000) {
+            uint32_t i = lddmc_getvalue(_rel);
+            lddmc_is_homomorphism(&i);
+
+            // hmorph on read level is interpreted as "can sync on all reads >= i"
+            // Iterate over all writes (j) corresponding to this read
+            for (itr_w = lddmc_getdown(_rel); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
+
+                uint32_t j = lddmc_getvalue(itr_w);
+                rel_ij = lddmc_getdown(itr_w);
+
+                // Iterate over all reads (v >= i) of set
+                lddmc_wide_start(&itr_set, _set);
+                for (lddmc_wide_seek(&itr_set, i); itr_set.node != lddmc_false; lddmc_wide_next(&itr_set)) {
+                    uint32_t v = lddmc_wide_value(&itr_set);
+                    set_i = lddmc_wide_down(&itr_set);
+
+                    // Compute successors T_j = S_i.R_ij
+                    MDD succ_j;
+                    if (img == 1)
+                        succ_j = lddmc_image(set_i, rel_ij, next_meta);
+                    else if (img == 2)
+                        succ_j = lddmc_image2(set_i, rel_ij, next_meta);
+                    else
+                        Abort("Must use custom image w/ homomorphisms in rel\n");
+
+                    // Write (hmorph) j and add to successors
+                    MDD set_j_ext = apply_write(v, j, succ_j);
+                    lddmc_refs_push(set_j_ext);
+                    _set = lddmc_union(_set, set_j_ext);
+                    lddmc_refs_pop(1);
+                }
+            }
+        }
         else { // not copy, normal read
             uint32_t i = lddmc_getvalue(_rel);
-            set_i = lddmc_follow(_set, i);
+            set_i = lddmc_wide_follow(_set, i);
 
             // Iterate over all writes (j) corresponding to reading 'i'
             for (itr_w = lddmc_getdown(_rel); itr_w != lddmc_false; itr_w = lddmc_getright(itr_w)) {
@@ -971,14 +1271,13 @@ TASK_IMPL_4(MDD, go_rec2, MDD, set, MDD, rel, MDD, meta, int, img)
             lddmc_refs_pop(1);
         }
 
-        // NEW: instead of iterating over _rel to the right here, recursively call self
-        MDD res_right = CALL(go_rec2, _set, lddmc_getright(_rel), meta, img);
+        MDD res_right = lddmc_refs_sync(SYNC(go_rec2));
         lddmc_refs_push(res_right);
         _set = lddmc_union(_set, res_right);
         lddmc_refs_pop(1);
     }
 
-    lddmc_refs_popptr(8);
+    lddmc_refs_popptr(9);
 
     /* Put in cache */
     if (cachenow)
@@ -20,9 +20,9 @@ TASK_DECL_3(MDD, lddmc_image, MDD, MDD, MDD);
 #define lddmc_image(s, r, meta) RUN(lddmc_image, s, r, meta)
 
 /**
- * Version of image which also use right recursion.
- * 
- * NOTE: currently doesn't support homomorphisms
+ * Version of image which also use right recursion, computing the down and
+ * right parts in parallel. Supports the same relations as lddmc_image
+ * (copy nodes and homomorphisms).
  */
 TASK_DECL_3(MDD, lddmc_image2, MDD, MDD, MDD);
 #define lddmc_image2(s, r, meta) RUN(lddmc_image2, s, r, meta)
@@ -32,6 +32,8 @@ TASK_DECL_3(MDD, lddmc_image2, MDD, MDD, MDD);
  *  meta = 0: skipped vars are replaced with 2 copy nodes
  *  meta = 3: only-read 'a' is replaced with read 'a', write 'a'
  *  meta = 4: only-write 'a' is replaced with read '*', write 'a'
+ * The trailing identity part (after the last read/write) is shared between
+ * all relations. Right and down children are extended in parallel.
  * 
  * NOTE: `nvars` is the number of vars in the relation (i.e. 2x state vars)
  */
@@ -46,5 +48,31 @@ TASK_DECL_3(MDD, lddmc_extend_rel, MDD, MDD, uint32_t);
 TASK_DECL_2(MDD, lddmc_rel_union, MDD, MDD);
 #define lddmc_rel_union(a, b) RUN(lddmc_rel_union, a, b)
 
-TASK_DECL_4(MDD, go_rec, MDD, MDD, MDD, int);
+/**
+ * Guard of a (full domain) relation: the states that have a successor, as an
+ * LDD over the read levels only. Reads are kept as they are (copy nodes and
+ * hmorph reads included), and the writes below each read are collapsed into
+ * the union of their guards.
+ */
+TASK_DECL_2(MDD, lddmc_rel_guard, MDD, MDD);
+#define lddmc_rel_guard(rel, meta) RUN(lddmc_rel_guard, rel, meta)
+
+/* The states in set that are not enabled according to guard */
+TASK_DECL_2(MDD, lddmc_guard_deadlocks, MDD, MDD);
+#define lddmc_guard_deadlocks(set, guard) RUN(lddmc_guard_deadlocks, set, guard)
+
+/**
+ * REACH of set under rel. With guard = lddmc_true this computes all reachable
+ * states, otherwise see lddmc_reach_deadlocks.
+ */
+TASK_DECL_5(MDD, go_rec, MDD, MDD, MDD, MDD, int);
+
+/**
+ * REACH with on-the-fly deadlock detection, where guard = lddmc_rel_guard(rel).
+ * Stops as soon as a reachable state outside of the guard is found and sets
+ * *found; the result then contains that state. Otherwise the result is the
+ * full reachable set.
+ */
+MDD lddmc_reach_deadlocks(MDD set, MDD rel, MDD guard, MDD meta, int img, bool *found);
+
 TASK_DECL_4(MDD, go_rec2, MDD, MDD, MDD, int);
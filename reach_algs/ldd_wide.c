@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "ldd_wide.h"
+
+/**
+ * One packed run of siblings. `values` comes first so that it is aligned for
+ * vector loads; unused lanes are padded with UINT32_MAX.
+ */
+typedef struct __attribute__((aligned(64))) ldd_wide_entry {
+    uint32_t values[LDD_WIDE_WIDTH];
+    MDD key;        // first node of the run
+    MDD next;       // right sibling of the last node of the run
+    uint32_t gen;   // generation in which the run was built
+    uint32_t count; // number of nodes in the run
+    MDD nodes[LDD_WIDE_WIDTH];
+    MDD downs[LDD_WIDE_WIDTH];
+} ldd_wide_entry_t;
+
+static ldd_wide_entry_t **wide_tables = NULL; // one table per worker
+static size_t wide_mask = 0;
+static volatile uint32_t wide_gen = 1;
+static int wide_hook_registered = 0;
+
+
+/* Node ids are only reused after garbage collection, so bumping the
+   generation is enough to invalidate all runs */
+VOID_TASK_0(lddmc_wide_gc)
+{
+    wide_gen++;
+}
+
+
+void lddmc_wide_init(size_t size)
+{
+    unsigned int n_workers = lace_workers();
+    if (wide_tables != NULL) {
+        for (unsigned int i = 0; i < n_workers; i++) free(wide_tables[i]);
+        free(wide_tables);
+        wide_tables = NULL;
+    }
+    if (size == 0) return;
+
+    size_t entries = 1;
+    while (entries * 2 <= size) entries *= 2;
+    wide_mask = entries - 1;
+
+    wide_tables = malloc(n_workers * sizeof(ldd_wide_entry_t*));
+    for (unsigned int i = 0; i < n_workers; i++) {
+        wide_tables[i] = aligned_alloc(64, entries * sizeof(ldd_wide_entry_t));
+        memset(wide_tables[i], 0, entries * sizeof(ldd_wide_entry_t));
+    }
+
+    if (!wide_hook_registered) {
+        sylvan_gc_hook_pregc(TASK(lddmc_wide_gc));
+        wide_hook_registered = 1;
+    }
+}
+
+
+bool lddmc_wide_enabled(void)
+{
+    return wide_tables != NULL;
+}
+
+
+/* Table of the current worker, or NULL if disabled or not on a Lace worker */
+static inline ldd_wide_entry_t *
+wide_table(void)
+{
+    if (wide_tables == NULL) return NULL;
+    WorkerP *worker = lace_get_worker();
+    return worker == NULL ? NULL : wide_tables[worker->worker];
+}
+
+
+static inline ldd_wide_entry_t *
+wide_slot(ldd_wide_entry_t *table, MDD key)
+{
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    return &table[(h >> 32) & wide_mask];
+}
+
+
+static inline int
+wide_valid(const ldd_wide_entry_t *w, MDD key)
+{
+    return w->key == key && w->gen == wide_gen;
+}
+
+
+static void
+wide_build(ldd_wide_entry_t *w, MDD start)
+{
+    uint32_t k = 0;
+    MDD cur = start;
+    for (; k < LDD_WIDE_WIDTH && cur != lddmc_false; k++) {
+        mddnode_t n = LDD_GETNODE(cur);
+        assert(!mddnode_getcopy(n));
+        w->values[k] = mddnode_getvalue(n);
+        w->nodes[k]  = cur;
+        w->downs[k]  = mddnode_getdown(n);
+        cur = mddnode_getright(n);
+    }
+    w->count = k;
+    w->next  = cur;
+    for (; k < LDD_WIDE_WIDTH; k++) w->values[k] = UINT32_MAX;
+    w->key = start;
+    w->gen = wide_gen;
+}
+
+
+/**
+ * Index of the first lane >= `from` with a value >= `value`, or a lane
+ * >= count if there is none.
+ */
+static inline uint32_t
+wide_lower_bound(const ldd_wide_entry_t *w, uint32_t from, uint32_t value)
+{
+#if defined(__AVX2__)
+    __m256i v = _mm256_load_si256((const __m256i*)w->values);
+    __m256i t = _mm256_set1_epi32((int)value);
+    __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(v, t), v);
+    uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ge));
+    mask &= ~((1u << from) - 1);
+    return mask ? (uint32_t)__builtin_ctz(mask) : LDD_WIDE_WIDTH;
+#elif defined(__SSE4_1__)
+    __m128i t = _mm_set1_epi32((int)value);
+    __m128i lo = _mm_load_si128((const __m128i*)w->values);
+    __m128i hi = _mm_load_si128((const __m128i*)(w->values + 4));
+    __m128i ge_lo = _mm_cmpeq_epi32(_mm_max_epu32(lo, t), lo);
+    __m128i ge_hi = _mm_cmpeq_epi32(_mm_max_epu32(hi, t), hi);
+    uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ge_lo)) |
+                    ((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ge_hi)) << 4);
+    mask &= ~((1u << from) - 1);
+    return mask ? (uint32_t)__builtin_ctz(mask) : LDD_WIDE_WIDTH;
+#else
+    uint32_t k = from;
+    while (k < w->count && w->values[k] < value) k++;
+    return k;
+#endif
+}
+
+
+/**
+ * Get the run containing itr->node. If no run is known and `build` is not
+ * set, NULL is returned so the caller can look at the node directly.
+ */
+static inline ldd_wide_entry_t *
+wide_locate(ldd_wide_entry_t *table, lddmc_wide_itr_t *itr, int build)
+{
+    ldd_wide_entry_t *w;
+    if (itr->block != lddmc_false) {
+        w = wide_slot(table, itr->block);
+        if (wide_valid(w, itr->block)) return w;
+    }
+    // (re)start a run at the current node, which is alive even if the old
+    // block start was garbage collected
+    w = wide_slot(table, itr->node);
+    if (!wide_valid(w, itr->node)) {
+        if (!build) return NULL;
+        wide_build(w, itr->node);
+    }
+    itr->block = itr->node;
+    itr->lane = 0;
+    return w;
+}
+
+
+uint32_t lddmc_wide_value(lddmc_wide_itr_t *itr)
+{
+    assert(itr->node != lddmc_false && itr->node != lddmc_true);
+    ldd_wide_entry_t *table = wide_table();
+    if (table != NULL) {
+        ldd_wide_entry_t *w = wide_locate(table, itr, 0);
+        if (w != NULL) return w->values[itr->lane];
+    }
+    return mddnode_getvalue(LDD_GETNODE(itr->node));
+}
+
+
+MDD lddmc_wide_down(lddmc_wide_itr_t *itr)
+{
+    assert(itr->node != lddmc_false && itr->node != lddmc_true);
+    ldd_wide_entry_t *table = wide_table();
+    if (table != NULL) {
+        ldd_wide_entry_t *w = wide_locate(table, itr, 0);
+        if (w != NULL) return w->downs[itr->lane];
+    }
+    return mddnode_getdown(LDD_GETNODE(itr->node));
+}
+
+
+void lddmc_wide_next(lddmc_wide_itr_t *itr)
+{
+    assert(itr->node != lddmc_false && itr->node != lddmc_true);
+    ldd_wide_entry_t *table = wide_table();
+    if (table == NULL) {
+        lddmc_wide_start(itr, mddnode_getright(LDD_GETNODE(itr->node)));
+        return;
+    }
+    ldd_wide_entry_t *w = wide_locate(table, itr, 1);
+    if (itr->lane + 1 < w->count) {
+        itr->lane++;
+        itr->node = w->nodes[itr->lane];
+    } else {
+        lddmc_wide_start(itr, w->next);
+    }
+}
+
+
+int lddmc_wide_seek(lddmc_wide_itr_t *itr, uint32_t value)
+{
+    ldd_wide_entry_t *table = wide_table();
+    if (table == NULL) {
+        while (itr->node != lddmc_false) {
+            mddnode_t n = LDD_GETNODE(itr->node);
+            uint32_t v = mddnode_getvalue(n);
+            if (v >= value) return v == value;
+            itr->node = mddnode_getright(n);
+            itr->block = lddmc_false;
+        }
+        return 0;
+    }
+
+    while (itr->node != lddmc_false) {
+        ldd_wide_entry_t *w = wide_locate(table, itr, 0);
+        if (w == NULL) {
+            // no run here yet: only pack the chain if we have to skip nodes
+            uint32_t v = mddnode_getvalue(LDD_GETNODE(itr->node));
+            if (v >= value) return v == value;
+            w = wide_locate(table, itr, 1);
+        }
+        uint32_t k = wide_lower_bound(w, itr->lane, value);
+        if (k < w->count) {
+            itr->lane = k;
+            itr->node = w->nodes[k];
+            return w->values[k] == value;
+        }
+        lddmc_wide_start(itr, w->next);
+    }
+    return 0;
+}
+
+
+MDD lddmc_wide_follow(MDD chain, uint32_t value)
+{
+    if (chain <= lddmc_true) return chain;
+    lddmc_wide_itr_t itr;
+    lddmc_wide_start(&itr, chain);
+    if (lddmc_wide_seek(&itr, value)) return lddmc_wide_down(&itr);
+    return lddmc_false;
+}
@@ -0,0 +1,67 @@
+#ifndef LDD_WIDE_H
+#define LDD_WIDE_H
+
+#include <stdbool.h>
+
+#include "sylvan_int.h"
+
+/**
+ * Side index for wide LDD sibling chains ("wide nodes").
+ *
+ * Walking a right-chain of an LDD costs one dependent load per value, which
+ * dominates for models with large counters. This index packs runs of up to
+ * LDD_WIDE_WIDTH consecutive siblings (values, nodes, and down pointers) into
+ * contiguous per-worker entries, so a seek compares a whole run at once
+ * (AVX2 or SSE4.1 when available, scalar otherwise). Runs are built lazily
+ * and the index is invalidated at every garbage collection.
+ *
+ * Chains are accessed through a small iterator. The caller must keep the
+ * chain alive (e.g. protect `itr.node` with lddmc_refs_pushptr) while using
+ * the iterator across calls that may trigger garbage collection.
+ *
+ * NOTE: the chains passed here should not contain copy nodes.
+ */
+
+#define LDD_WIDE_WIDTH 8
+
+typedef struct lddmc_wide_itr {
+    MDD node;       // current sibling (lddmc_false after the end of the chain)
+    MDD block;      // first node of the packed run containing node (0 if unknown)
+    uint32_t lane;  // position of node within that run
+} lddmc_wide_itr_t;
+
+/**
+ * Allocate the index with `size` entries per worker (rounded down to a power
+ * of 2) and register its garbage collection hook. A size of 0 disables the
+ * index, in which case all functions below walk the chain node by node.
+ * Call after sylvan_init_ldd().
+ */
+void lddmc_wide_init(size_t size);
+bool lddmc_wide_enabled(void);
+
+/* Start iterating at the first node of `chain` */
+static inline void
+lddmc_wide_start(lddmc_wide_itr_t *itr, MDD chain)
+{
+    itr->node = chain;
+    itr->block = lddmc_false;
+    itr->lane = 0;
+}
+
+/* Value / down of the current node */
+uint32_t lddmc_wide_value(lddmc_wide_itr_t *itr);
+MDD lddmc_wide_down(lddmc_wide_itr_t *itr);
+
+/* Step to the right sibling */
+void lddmc_wide_next(lddmc_wide_itr_t *itr);
+
+/**
+ * Move to the first sibling with value >= `value` (or past the end).
+ * Returns 1 if a sibling with exactly `value` was found.
+ */
+int lddmc_wide_seek(lddmc_wide_itr_t *itr, uint32_t value);
+
+/* Like lddmc_follow (without copy nodes), but using the index */
+MDD lddmc_wide_follow(MDD chain, uint32_t value);
+
+#endif
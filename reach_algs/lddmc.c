@@ -12,9 +12,13 @@
 #endif
 
 #include "ldd_custom.h"
+#include "ldd_wide.h"
 
 #include "getrss.h"
 #include "cache_op_ids.h"
+#include "exact_count.h"
+#include "group_deps.h"
+#include "stats_file.h"
 
 /* Configuration (via argp) */
 static int report_levels = 0; // report states at start of every level
@@ -23,14 +27,20 @@ static int report_nodes = 0; // report number of nodes of LDDs
 static int strategy = 0; // 0 = BFS, 1 = PAR, 2 = SAT, 3 = CHAINING, 4 = REC
 static int custom_img = 0; // use custom image func (only for rec or bfs-plain)
 static int extend_rels = 0; // extends rels to full domain
-static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly
+static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly (bfs/par/rec)
 static int merge_relations = 0; // merge relations to 1 relation
 static int print_transition_matrix = 0; // print transition relation matrix
+static int wide_chains = 1; // use packed sibling-chain index in custom image / REACH
 static int workers = 0; // autodetect
 static char* model_filename = NULL; // filename of model
 static char* out_filename = NULL; // filename of output
 static char* stats_filename = NULL; // filename of csv stats output file
 static char* matrix_filename = NULL; // no reach, just log TS relation matrix
+static size_t size_hint = 0; // expected peak number of nodes (0 = peaknodes from the stats file, if any)
+static int resize_policy = 0; // 0 = build default, 1 = aggressive, 2 = normal
+static char* gc_log_filename = NULL; // filename of csv log with a row per garbage collection
+static int compact_gc = 0; // compacting garbage collection after loading and between levels
+static int cache_priority = 0; // protect REACH results in the operation cache
 #ifdef HAVE_PROFILER
 static char* profile_filename = NULL; // filename for profiling
 #endif
@@ -60,11 +70,17 @@ static struct argp_option options[] =
     {"count-table", 2, 0, 0, "Report table usage at each level", 1},
     {"merge-relations", 6, 0, 0, "Merge transition relations into one transition relation", 1},
     {"custom-image", 9, 0, 0, "Use a custom image function for strategy 'rec'", 1},
-    {"custom-image2", 10, 0, 0, "Use a custom image function for strategy 'rec'",1 },
+    {"custom-image2", 10, 0, 0, "Use the right-recursive custom image function for strategy 'rec' (default with --merge-relations)",1 },
     {"extend-rels", 11, 0, 0, "Extend rels to full domain",1 },
+    {"no-wide-chains", 12, 0, 0, "Don't use the packed sibling-chain index in custom image / REACH", 1},
     {"print-matrix", 4, 0, 0, "Print transition matrix", 1},
     {"write-matrix", 8, "FILENAME", 0, "Write transition matrix to given file", 0},
     {"statsfile", 7, "FILENAME", 0, "Write stats to given filename (or append if exists)", 0},
+    {"size-hint", 13, "<nodes>", 0, "Expected peak number of nodes, grows the initial table sizes (default: peaknodes of previous runs in the stats file)", 0},
+    {"resize", 14, "<aggressive|normal>", 0, "Growth policy of the nodes table and cache (default: build setting)", 0},
+    {"gc-log", 15, "FILENAME", 0, "Write a row per garbage collection to given filename (or append if exists)", 0},
+    {"compact", 16, 0, 0, "Renumber the nodes in depth-first order after loading the relations and, when garbage was collected, after a level (bfs, par)", 1},
+    {"cache-priority", 17, 0, 0, "Put REACH results in the operation cache with priority, so cheaper results do not evict them (rec)", 1},
     {0, 0, 0, 0, 0, 0}
 };
 
@@ -102,7 +118,7 @@ parse_opt(int key, char *arg, struct argp_state *state)
         break;
     case 6:
         merge_relations = 1;
-        custom_img = 1;
+        if (custom_img == 0) custom_img = 2; // right-recursive image by default
         break;
     case 9:
         if (strategy == strat_rec || strategy == strat_rec2 || strategy == strat_bfs_plain)
@@ -123,9 +139,29 @@ parse_opt(int key, char *arg, struct argp_state *state)
     case 11:
         extend_rels = 1;
         break;
+    case 12:
+        wide_chains = 0;
+        break;
     case 7:
         stats_filename = arg;
         break;
+    case 13:
+        size_hint = strtoull(arg, NULL, 10);
+        break;
+    case 14:
+        if (strcmp(arg, "aggressive")==0) resize_policy = 1;
+        else if (strcmp(arg, "normal")==0) resize_policy = 2;
+        else argp_usage(state);
+        break;
+    case 15:
+        gc_log_filename = arg;
+        break;
+    case 16:
+        compact_gc = 1;
+        break;
+    case 17:
+        cache_priority = 1;
+        break;
     case 8:
         print_transition_matrix = 1;
         matrix_filename = arg;
@@ -166,19 +202,28 @@ typedef struct relation
     int r_k, w_k, *r_proj, *w_proj;
     int firstvar; // for saturation/chaining
     MDD topmeta; // for saturation
+    MDD guard; // states with a successor, over the read variables
+    MDD guard_proj; // for matching states against guard
 } *rel_t;
 
 static int vector_size; // size of vector in integers
 static int next_count; // number of partitions of the transition relation
 static rel_t *next; // each partition of the transition relation
+static int guard_count; // number of groups with a guard (next_count before merging)
 
 typedef struct stats {
     double reach_time;
+    double extend_rel_time;
     double merge_rel_time;
     double total_time;
-    double final_states;
+    char *final_states; // exact count, as a decimal string
     size_t final_nodecount;
-    size_t peaknodes;
+    size_t peaknodes; // largest table fill before garbage collection (if counted) or at the end
+    size_t gcs; // number of garbage collections
+    size_t compactions; // number of compacting garbage collections
+    double gc_time; // total pause time of garbage collections
+    double gc_max_pause;
+    double gc_clear_cache_time, gc_mark_time, gc_compact_time, gc_resize_time, gc_rehash_time;
 } stats_t;
 stats_t stats = {0};
 
@@ -293,6 +338,23 @@ TASK_1(rel_t, rel_load_proj, FILE*, f)
     rel->dd = lddmc_false;
     lddmc_protect(&rel->dd);
 
+    /* Projection of the state vector on the reads (for the guard) */
+    uint32_t guard_proj[vector_size+1];
+    int last_read = -1;
+    for (int k=0; k<r_k; k++) {
+        guard_proj[r_proj[k]] = 1;
+        last_read = r_proj[k];
+    }
+    for (int k=0, r=0; k<=last_read; k++) {
+        if (r < r_k && r_proj[r] == k) r++;
+        else guard_proj[k] = 0;
+    }
+    guard_proj[last_read+1] = (uint32_t)-1;
+    rel->guard_proj = lddmc_cube(guard_proj, last_read+2);
+    lddmc_protect(&rel->guard_proj);
+    rel->guard = lddmc_true;
+    lddmc_protect(&rel->guard);
+
     return rel;
 }
 
@@ -303,6 +365,24 @@ VOID_TASK_2(rel_load, FILE*, f, rel_t, rel)
     size_t dd;
     if (fread(&dd, sizeof(size_t), 1, f) != 1) Abort("Invalid input file!");
     rel->dd = lddmc_serialize_get_reversed(dd);
+
+    if (check_deadlocks) {
+        /* Guard: keep the reads, quantify the writes and the action label */
+        uint32_t proj[vector_size*2+2];
+        int k = 0;
+        for (MDD m = rel->meta; m != lddmc_true; ) {
+            uint32_t val = lddmc_getvalue(m);
+            if (val == 1 || val == 3) proj[k++] = 1;
+            else if (val == 2 || val == 4) proj[k++] = 0;
+            else if (val == 5 || val == (uint32_t)-1) break;
+            m = lddmc_follow(m, val);
+        }
+        proj[k++] = (uint32_t)-2;
+        MDD p = lddmc_cube(proj, k);
+        lddmc_refs_pushptr(&p);
+        rel->guard = CALL(lddmc_project, rel->dd, p);
+        lddmc_refs_popptr(1);
+    }
 }
 
 /**
@@ -355,6 +435,9 @@ print_memory_usage(void)
     INFO("Memory usage: %s\n", buf);
 }
 
+/* Columns of the stats file; rows are only appended to files with the same header */
+static const char *stats_header = "benchmark, strategy, merg_rels, custom_img, workers, reach_time, merge_time, total_time, final_states, final_nodecount, peaknodes, extend_time, gcs, gc_time, gc_max_pause";
+
 static void
 write_stats()
 {
@@ -363,11 +446,11 @@ write_stats()
     fseek (fp, 0, SEEK_END);
         long size = ftell(fp);
         if (size == 0)
-            fprintf(fp, "%s\n", "benchmark, strategy, merg_rels, custom_img, workers, reach_time, merge_time, total_time, final_states, final_nodecount, peaknodes");
+            fprintf(fp, "%s\n", stats_header);
     // append stats of this run
     char* benchname = basename((char*)model_filename);
     int strat = strategy + (custom_img * 100);
-    fprintf(fp, "%s, %d, %d, %d, %d, %f, %f, %f, %0.0f, %ld, %ld\n",
+    fprintf(fp, "%s, %d, %d, %d, %d, %f, %f, %f, %s, %ld, %ld, %f, %ld, %f, %f\n",
             benchname,
             strat,
             merge_relations,
@@ -378,10 +461,49 @@ write_stats()
             stats.total_time,
             stats.final_states,
             stats.final_nodecount,
-            stats.peaknodes);
+            stats.peaknodes,
+            stats.extend_rel_time,
+            stats.gcs,
+            stats.gc_time,
+            stats.gc_max_pause);
     fclose(fp);
 }
 
+static FILE *gc_log = NULL;
+static const char *gc_trigger_names[] = {"explicit", "table-full", "compact"};
+
+static const char *gc_log_header = "benchmark, gc, trigger, timestamp, time, clear_cache_time, mark_time, resize_time, rehash_time, nodes_before, nodes_after, table_before, table_after, compact_time";
+
+/**
+ * Open the per-GC log for appending, and write the header if it is empty
+ */
+static void
+open_gc_log()
+{
+    if (!stats_header_matches(gc_log_filename, gc_log_header))
+        Abort("The columns of '%s' differ from this version, use a new file!\n", gc_log_filename);
+    gc_log = fopen(gc_log_filename, "a");
+    if (gc_log == NULL) Abort("Cannot open file '%s'!\n", gc_log_filename);
+    fseek(gc_log, 0, SEEK_END);
+    if (ftell(gc_log) == 0)
+        fprintf(gc_log, "%s\n", gc_log_header);
+}
+
+/**
+ * With --compact, renumber the live nodes in depth-first order (sylvan_gc_compact).
+ * Only called where all LDDs in use are protected. Skipped if there was no garbage
+ * collection since the previous compaction, since the new nodes are then still
+ * stored in the order in which they were created.
+ */
+static size_t compact_gc_number = (size_t)-1;
+
+VOID_TASK_0(compact_nodes)
+{
+    if (!compact_gc || sylvan_gc_last_info()->number == compact_gc_number) return;
+    CALL(sylvan_gc_compact);
+    compact_gc_number = sylvan_gc_last_info()->number;
+}
+
 /**
  * Get the first variable of the transition relation
  */
@@ -429,54 +551,54 @@ fprint_matrix_row(FILE *stream, size_t size, MDD meta)
     }
 }
 
+static void
+report_deadlocks(MDD deadlocks)
+{
+    lddmc_refs_pushptr(&deadlocks);
+    INFO("Found %'0.0f deadlock states... ", lddmc_satcount_cached(deadlocks));
+    printf("example: ");
+    print_example(deadlocks);
+    printf("\n");
+    lddmc_refs_popptr(1);
+}
+
+
 /**
- * Implement parallel strategy (that performs the relprod operations in parallel)
+ * States in cur that have a successor according to the guards of the groups
+ * from..from+len-1, computed as a parallel union over the groups.
  */
-TASK_5(MDD, go_par, MDD, cur, MDD, visited, size_t, from, size_t, len, MDD*, deadlocks)
+TASK_3(MDD, go_enabled, MDD, cur, size_t, from, size_t, len)
 {
-    if (len == 1) {
-        // Calculate NEW successors (not in visited)
-        MDD succ = lddmc_relprod(cur, next[from]->dd, next[from]->meta);
-        lddmc_refs_push(succ);
-        if (deadlocks) {
-            // check which MDDs in deadlocks do not have a successor in this relation
-            MDD anc = lddmc_relprev(succ, next[from]->dd, next[from]->meta, cur);
-            lddmc_refs_push(anc);
-            *deadlocks = lddmc_minus(*deadlocks, anc);
-            lddmc_refs_pop(1);
-        }
-        MDD result = lddmc_minus(succ, visited);
-        lddmc_refs_pop(1);
-        return result;
-    } else if (deadlocks != NULL) {
-        MDD deadlocks_left = *deadlocks;
-        MDD deadlocks_right = *deadlocks;
-        lddmc_refs_pushptr(&deadlocks_left);
-        lddmc_refs_pushptr(&deadlocks_right);
+    if (cur == lddmc_false) return lddmc_false;
+    if (len == 1) return lddmc_match(cur, next[from]->guard, next[from]->guard_proj);
 
-        // Recursively compute left+right
-        lddmc_refs_spawn(SPAWN(go_par, cur, visited, from, len/2, &deadlocks_left));
-        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2, &deadlocks_right);
-        lddmc_refs_push(right);
-        MDD left = lddmc_refs_sync(SYNC(go_par));
-        lddmc_refs_push(left);
+    MDD result;
+    if (cache_get3(CACHE_LDD_ENABLED, cur, from, len, &result)) return result;
 
-        // Merge results of left+right
-        MDD result = lddmc_union(left, right);
-        lddmc_refs_pop(2);
+    lddmc_refs_spawn(SPAWN(go_enabled, cur, from, len/2));
+    MDD right = CALL(go_enabled, cur, from+len/2, len-len/2);
+    lddmc_refs_push(right);
+    MDD left = lddmc_refs_sync(SYNC(go_enabled));
+    lddmc_refs_push(left);
+    result = lddmc_union(left, right);
+    lddmc_refs_pop(2);
 
-        // Intersect deadlock sets
-        lddmc_refs_push(result);
-        *deadlocks = lddmc_intersect(deadlocks_left, deadlocks_right);
-        lddmc_refs_pop(1);
-        lddmc_refs_popptr(2);
+    cache_put3(CACHE_LDD_ENABLED, cur, from, len, result);
+    return result;
+}
 
-        // Return result
-        return result;
+/**
+ * Implement parallel strategy (that performs the relprod operations in parallel)
+ */
+TASK_4(MDD, go_par, MDD, cur, MDD, visited, size_t, from, size_t, len)
+{
+    if (len == 1) {
+        // Calculate NEW successors (not in visited)
+        return lddmc_relprod_minus(cur, next[from]->dd, next[from]->meta, visited);
     } else {
         // Recursively compute left+right
-        lddmc_refs_spawn(SPAWN(go_par, cur, visited, from, len/2, NULL));
-        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2, NULL);
+        lddmc_refs_spawn(SPAWN(go_par, cur, visited, from, len/2));
+        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2);
         lddmc_refs_push(right);
         MDD left = lddmc_refs_sync(SYNC(go_par));
         lddmc_refs_push(left);
@@ -504,30 +626,30 @@ VOID_TASK_1(par, set_t, set)
     int iteration = 1;
     do {
         if (check_deadlocks) {
-            // compute successors in parallel
-            MDD deadlocks = front;
-            lddmc_refs_pushptr(&deadlocks);
-            front = CALL(go_par, front, visited, 0, next_count, &deadlocks);
-            lddmc_refs_popptr(1);
+            // states in the front without a successor
+            MDD deadlocks = CALL(go_enabled, front, 0, guard_count);
+            lddmc_refs_push(deadlocks);
+            deadlocks = lddmc_minus(front, deadlocks);
+            lddmc_refs_pop(1);
 
             if (deadlocks != lddmc_false) {
-                INFO("Found %'0.0f deadlock states... ", lddmc_satcount_cached(deadlocks));
-                printf("example: ");
-                print_example(deadlocks);
-                printf("\n");
+                report_deadlocks(deadlocks);
                 check_deadlocks = 0;
             }
-        } else {
-            // compute successors in parallel
-            front = CALL(go_par, front, visited, 0, next_count, NULL);
         }
 
+        // compute successors in parallel
+        front = CALL(go_par, front, visited, 0, next_count);
+
         // visited = visited + front
         visited = lddmc_union(visited, front);
+        CALL(compact_nodes);
 
         INFO("Level %d done", iteration);
         if (report_levels) {
-            printf(", %'0.0f states explored", lddmc_satcount_cached(visited));
+            char *count = lddmc_exact_satcount_str(visited);
+            printf(", %s states explored", count);
+            free(count);
         }
         if (report_table) {
             size_t filled, total;
@@ -547,51 +669,16 @@ VOID_TASK_1(par, set_t, set)
 /**
  * Implement sequential strategy (that performs the relprod operations one by one)
  */
-TASK_5(MDD, go_bfs, MDD, cur, MDD, visited, size_t, from, size_t, len, MDD*, deadlocks)
+TASK_4(MDD, go_bfs, MDD, cur, MDD, visited, size_t, from, size_t, len)
 {
     if (len == 1) {
         // Calculate NEW successors (not in visited)
-        MDD succ = lddmc_relprod(cur, next[from]->dd, next[from]->meta);
-        lddmc_refs_push(succ);
-        if (deadlocks) {
-            // check which MDDs in deadlocks do not have a successor in this relation
-            MDD anc = lddmc_relprev(succ, next[from]->dd, next[from]->meta, cur);
-            lddmc_refs_push(anc);
-            *deadlocks = lddmc_minus(*deadlocks, anc);
-            lddmc_refs_pop(1);
-        }
-        MDD result = lddmc_minus(succ, visited);
-        lddmc_refs_pop(1);
-        return result;
-    } else if (deadlocks != NULL) {
-        MDD deadlocks_left = *deadlocks;
-        MDD deadlocks_right = *deadlocks;
-        lddmc_refs_pushptr(&deadlocks_left);
-        lddmc_refs_pushptr(&deadlocks_right);
-
-        // Recursively compute left+right
-        MDD left = CALL(go_par, cur, visited, from, len/2, &deadlocks_left);
-        lddmc_refs_push(left);
-        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2, &deadlocks_right);
-        lddmc_refs_push(right);
-
-        // Merge results of left+right
-        MDD result = lddmc_union(left, right);
-        lddmc_refs_pop(2);
-
-        // Intersect deadlock sets
-        lddmc_refs_push(result);
-        *deadlocks = lddmc_intersect(deadlocks_left, deadlocks_right);
-        lddmc_refs_pop(1);
-        lddmc_refs_popptr(2);
-
-        // Return result
-        return result;
+        return lddmc_relprod_minus(cur, next[from]->dd, next[from]->meta, visited);
     } else {
         // Recursively compute left+right
-        MDD left = CALL(go_par, cur, visited, from, len/2, NULL);
+        MDD left = CALL(go_par, cur, visited, from, len/2);
         lddmc_refs_push(left);
-        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2, NULL);
+        MDD right = CALL(go_par, cur, visited, from+len/2, len-len/2);
         lddmc_refs_push(right);
 
         // Merge results of left+right
@@ -615,30 +702,30 @@ VOID_TASK_1(bfs, set_t, set)
     int iteration = 1;
     do {
         if (check_deadlocks) {
-            // compute successors
-            MDD deadlocks = front;
-            lddmc_refs_pushptr(&deadlocks);
-            front = CALL(go_bfs, front, visited, 0, next_count, &deadlocks);
-            lddmc_refs_popptr(1);
+            // states in the front without a successor
+            MDD deadlocks = CALL(go_enabled, front, 0, guard_count);
+            lddmc_refs_push(deadlocks);
+            deadlocks = lddmc_minus(front, deadlocks);
+            lddmc_refs_pop(1);
 
             if (deadlocks != lddmc_false) {
-                INFO("Found %'0.0f deadlock states... ", lddmc_satcount_cached(deadlocks));
-                printf("example: ");
-                print_example(deadlocks);
-                printf("\n");
+                report_deadlocks(deadlocks);
                 check_deadlocks = 0;
             }
-        } else {
-            // compute successors
-            front = CALL(go_bfs, front, visited, 0, next_count, NULL);
         }
 
+        // compute successors
+        front = CALL(go_bfs, front, visited, 0, next_count);
+
         // visited = visited + front
         visited = lddmc_union(visited, front);
+        CALL(compact_nodes);
 
         INFO("Level %d done", iteration);
         if (report_levels) {
-            printf(", %'0.0f states explored", lddmc_satcount_cached(visited));
+            char *count = lddmc_exact_satcount_str(visited);
+            printf(", %s states explored", count);
+            free(count);
         }
         if (report_table) {
             size_t filled, total;
@@ -655,6 +742,39 @@ VOID_TASK_1(bfs, set_t, set)
     lddmc_refs_popptr(2);
 }
 
+/* Dependencies between transition groups, see group_deps.h */
+static char *group_deps = NULL; // group_deps[k*next_count+j]: j depends on k (or j == k)
+
+static void
+init_group_deps(void)
+{
+    group_proj_t proj[next_count];
+    for (int i=0; i<next_count; i++) {
+        proj[i] = (group_proj_t){next[i]->r_k, next[i]->w_k, next[i]->r_proj, next[i]->w_proj};
+    }
+    group_deps = compute_group_deps(proj, next_count);
+}
+
+/**
+ * Union of set with its successors under the groups first, ...,
+ * first+count-1 (which start at the current level), computed in parallel and
+ * combined with a parallel union
+ */
+TASK_3(MDD, relprod_batch, MDD, set, int, first, int, count)
+{
+    if (count == 1) return lddmc_relprod_union(set, next[first]->dd, next[first]->topmeta, set);
+
+    lddmc_refs_spawn(SPAWN(relprod_batch, set, first, count/2));
+    MDD right = lddmc_refs_push(CALL(relprod_batch, set, first+count/2, count-count/2));
+    MDD left = lddmc_refs_push(lddmc_refs_sync(SYNC(relprod_batch)));
+    MDD result = lddmc_union(left, right);
+    lddmc_refs_pop(2);
+    return result;
+}
+
+/* Number of intermediate sets of a fixpoint that are stored in the cache */
+#define SAT_CACHE_STEPS 16
+
 /**
  * Implementation of (parallel) saturation
  * (assumes relations are ordered on first variable)
@@ -671,11 +791,6 @@ TASK_3(MDD, go_sat, MDD, set, int, idx, int, depth)
     if (cache_get3(CACHE_LDD_SAT, _set, idx, 0, &result)) return result;
     lddmc_refs_pushptr(&_set);
 
-    /**
-     * Possible improvement: cache more things (like intermediate results?)
-     *   and chain-apply more of the current level before going deeper?
-     */
-
     /* Check if the relation should be applied */
     const int var = next[idx]->firstvar;
     assert(depth <= var);
@@ -686,22 +801,36 @@ TASK_3(MDD, go_sat, MDD, set, int, idx, int, depth)
         /*
          * Compute until fixpoint:
          * - SAT deeper
-         * - chain-apply all current level once
+         * - chain-apply all current level once, to the states found in the last round
+         * - SAT deeper only the new states
+         * The intermediate sets all saturate to the same result, so they are cached as well.
          */
-        MDD prev = lddmc_false;
+        MDD steps[SAT_CACHE_STEPS];
+        int n_steps = 0;
+        MDD front = lddmc_false;
         lddmc_refs_pushptr(&set);
-        lddmc_refs_pushptr(&prev);
-        while (prev != set) {
-            prev = set;
-            // SAT deeper
-            set = CALL(go_sat, set, idx + n, depth);
-            // chain-apply all current level once
-            for (int i=0; i<n; i++) {
-                set = lddmc_relprod_union(set, next[idx+i]->dd, next[idx+i]->topmeta, set);
+        lddmc_refs_pushptr(&front);
+        set = CALL(go_sat, set, idx + n, depth);
+        front = set;
+        for (;;) {
+            if (set != _set && n_steps < SAT_CACHE_STEPS) steps[n_steps++] = lddmc_refs_push(set);
+            // chain-apply all current level once, independent groups in parallel
+            for (int i=0; i<n;) {
+                int count = independent_run(group_deps, next_count, idx+i, idx+n);
+                front = CALL(relprod_batch, front, idx+i, count);
+                i += count;
             }
+            front = lddmc_minus(front, set);
+            if (front == lddmc_false) break;
+            // SAT deeper, only the new states
+            front = CALL(go_sat, front, idx + n, depth);
+            front = lddmc_minus(front, set);
+            set = lddmc_union(set, front);
         }
-        lddmc_refs_popptr(2);
         result = set;
+        for (int i=0; i<n_steps; i++) cache_put3(CACHE_LDD_SAT, steps[i], idx, 0, result);
+        lddmc_refs_pop(n_steps);
+        lddmc_refs_popptr(2);
     } else {
         /* Recursive computation */
         lddmc_refs_spawn(SPAWN(go_sat, lddmc_getright(set), idx, depth));
@@ -725,36 +854,78 @@ VOID_TASK_1(sat, set_t, set)
     set->dd = CALL(go_sat, set->dd, 0, 0);
 }
 
+/**
+ * Apply the pairwise independent groups batch[0..n-1] in parallel, each to
+ * the states it has not seen yet. The new states of group k are stored in
+ * succ[k]; returns their union.
+ */
+TASK_5(MDD, chain_batch, const int*, batch, int, n, MDD, visited, MDD*, seen, MDD*, succ)
+{
+    if (n == 1) {
+        const int k = batch[0];
+        MDD todo = lddmc_refs_push(lddmc_minus(visited, seen[k]));
+        seen[k] = visited;
+        succ[k] = lddmc_relprod_minus(todo, next[k]->dd, next[k]->meta, visited);
+        lddmc_refs_pop(1);
+        return succ[k];
+    }
+
+    lddmc_refs_spawn(SPAWN(chain_batch, batch, n/2, visited, seen, succ));
+    MDD right = lddmc_refs_push(CALL(chain_batch, batch+n/2, n-n/2, visited, seen, succ));
+    MDD left = lddmc_refs_push(lddmc_refs_sync(SYNC(chain_batch)));
+    MDD result = lddmc_union(left, right);
+    lddmc_refs_pop(2);
+    return result;
+}
+
 /**
  * Implementation of the Chaining strategy (does not support deadlock detection)
+ * Every pass applies each scheduled group once to the states it has not seen
+ * yet; a group that produces new states schedules its dependent groups (see
+ * group_sched_t). Consecutive independent groups are applied in parallel.
  */
 VOID_TASK_1(chaining, set_t, set)
 {
     MDD visited = set->dd;
-    MDD front = visited;
-    MDD succ = sylvan_false;
+    MDD succ = lddmc_false;
 
     lddmc_refs_pushptr(&visited);
-    lddmc_refs_pushptr(&front);
     lddmc_refs_pushptr(&succ);
 
+    // seen[k] is the set of visited states when group k was last applied
+    MDD seen[next_count], new_states[next_count];
+    for (int k=0; k<next_count; k++) {
+        seen[k] = new_states[k] = lddmc_false;
+        lddmc_refs_pushptr(&seen[k]);
+        lddmc_refs_pushptr(&new_states[k]);
+    }
+
+    group_sched_t sched;
+    sched_init(&sched, group_deps, next_count);
+    const int *batch = sched.batch;
+
     int iteration = 1;
     do {
-        // calculate successors in parallel
-        for (int i=0; i<next_count; i++) {
-            succ = lddmc_relprod(front, next[i]->dd, next[i]->meta);
-            front = lddmc_union(front, succ);
+        for (int k=0; k<next_count; k++) {
+            if (!sched.cur[k]) continue;
+            int n = sched_take_batch(&sched, k);
+
+            succ = CALL(chain_batch, batch, n, visited, seen, new_states);
+            if (succ != lddmc_false) {
+                visited = lddmc_union(visited, succ);
+            }
+            for (int b=0; b<n; b++) {
+                if (new_states[batch[b]] != lddmc_false) sched_dependents(&sched, batch[b], 1);
+                new_states[batch[b]] = lddmc_false; // reset, for gc
+            }
             succ = lddmc_false; // reset, for gc
         }
 
-        // front = front - visited
-        // visited = visited + front
-        front = lddmc_minus(front, visited);
-        visited = lddmc_union(visited, front);
-
         INFO("Level %d done", iteration);
         if (report_levels) {
-            printf(", %'0.0f states explored", lddmc_satcount_cached(visited));
+            char *count = lddmc_exact_satcount_str(visited);
+            printf(", %s states explored", count);
+            free(count);
         }
         if (report_table) {
             size_t filled, total;
@@ -765,10 +936,12 @@ VOID_TASK_1(chaining, set_t, set)
         to_h(getCurrentRSS(), buf);
         printf(", rss=%s.\n", buf);
         iteration++;
-    } while (front != lddmc_false);
+    } while (sched_next_pass(&sched));
+
+    sched_free(&sched);
 
     set->dd = visited;
-    lddmc_refs_popptr(3);
+    lddmc_refs_popptr(2 + 2*next_count);
 }
 
 
@@ -827,7 +1000,22 @@ get_next_meta(MDD meta)
 VOID_TASK_1(rec, set_t, set)
 {
     if (next_count != 1) Abort("Strategy rec requires merge-relations\n");
-    set->dd = CALL(go_rec, set->dd, next[0]->dd, next[0]->meta, custom_img);
+    if (!check_deadlocks) {
+        set->dd = CALL(go_rec, set->dd, next[0]->dd, lddmc_true, next[0]->meta, custom_img);
+        return;
+    }
+
+    // states with a successor, computed once; go_rec stops at the first
+    // reachable state outside of it
+    MDD guard = lddmc_rel_guard(next[0]->dd, next[0]->meta);
+    lddmc_refs_pushptr(&guard);
+    bool found;
+    set->dd = lddmc_reach_deadlocks(set->dd, next[0]->dd, guard, next[0]->meta, custom_img, &found);
+    if (found) {
+        report_deadlocks(lddmc_guard_deadlocks(set->dd, guard));
+        INFO("Stopped exploration at first deadlock, reachable states are incomplete\n");
+    }
+    lddmc_refs_popptr(1);
 }
 
 
@@ -835,6 +1023,14 @@ VOID_TASK_1(rec2, set_t, set)
 {
     if (next_count != 1) Abort("Strategy rec requires merge-relations\n");
     set->dd = CALL(go_rec2, set->dd, next[0]->dd, next[0]->meta, custom_img);
+    if (check_deadlocks) {
+        // go_rec2 has no early exit, check the final set
+        MDD guard = lddmc_rel_guard(next[0]->dd, next[0]->meta);
+        lddmc_refs_pushptr(&guard);
+        MDD deadlocks = lddmc_guard_deadlocks(set->dd, guard);
+        if (deadlocks != lddmc_false) report_deadlocks(deadlocks);
+        lddmc_refs_popptr(1);
+    }
 }
 
 
@@ -886,17 +1082,37 @@ assert_meta_full_domain(MDD meta)
 }
 
 
+/* Minimum initial nodes table when relations are extended by multiple workers */
+#define PARALLEL_EXTEND_NODES (1LL<<20)
+
 #define big_union(first, count) RUN(big_union, first, count)
 TASK_2(MDD, big_union, int, first, int, count)
 {
-    // TODO: maybe do this function in parallel like in bddmc
-    MDD res = next[first]->dd;
-    lddmc_protect(&res);
-    for (int i = first+1; i < count; i++) {
-        res = lddmc_union(res, next[i]->dd);
+    if (count == 1) return next[first]->dd;
+
+    lddmc_refs_spawn(SPAWN(big_union, first, count/2));
+    MDD right = lddmc_refs_push(CALL(big_union, first+count/2, count-count/2));
+    MDD left = lddmc_refs_push(lddmc_refs_sync(SYNC(big_union)));
+    MDD result = CALL(lddmc_rel_union, left, right);
+    lddmc_refs_pop(2);
+    return result;
+}
+
+/**
+ * Extend the transition groups [first, first+count) to the full domain.
+ */
+#define extend_all(first, count, meta) RUN(extend_all, first, count, meta)
+VOID_TASK_3(extend_all, int, first, int, count, MDD, meta)
+{
+    if (count == 1) {
+        next[first]->dd = CALL(lddmc_extend_rel, next[first]->dd, next[first]->meta, 2*vector_size);
+        next[first]->meta = meta;
+        return;
     }
-    lddmc_unprotect(&res);
-    return res;
+
+    SPAWN(extend_all, first, count/2, meta);
+    CALL(extend_all, first+count/2, count-count/2, meta);
+    SYNC(extend_all);
 }
 
 VOID_TASK_0(gc_start)
@@ -908,9 +1124,32 @@ VOID_TASK_0(gc_start)
 
 VOID_TASK_0(gc_end)
 {
+    const sylvan_gc_info_t *gc = sylvan_gc_last_info();
+    if (gc->nodes_before > stats.peaknodes) stats.peaknodes = gc->nodes_before;
+    stats.gcs++;
+    stats.gc_time += gc->time;
+    if (gc->time > stats.gc_max_pause) stats.gc_max_pause = gc->time;
+    stats.gc_clear_cache_time += gc->clear_cache_time;
+    stats.gc_mark_time += gc->mark_time;
+    stats.gc_compact_time += gc->compact_time;
+    if (gc->trigger == SYLVAN_GC_COMPACT) stats.compactions++;
+    stats.gc_resize_time += gc->resize_time;
+    stats.gc_rehash_time += gc->rehash_time;
+
     char buf[32];
     to_h(getCurrentRSS(), buf);
     INFO("(GC) Garbage collection done.       (rss: %s)\n", buf);
+    INFO("(GC) #%zu (%s): %f sec (cache %f, mark %f, compact %f, resize %f, rehash %f), table %'zu -> %'zu\n",
+         gc->number, gc_trigger_names[gc->trigger], gc->time, gc->clear_cache_time, gc->mark_time, gc->compact_time,
+         gc->resize_time, gc->rehash_time, gc->table_before, gc->table_after);
+    if (gc->nodes_before != 0) INFO("(GC) nodes %'zu -> %'zu\n", gc->nodes_before, gc->nodes_after);
+
+    if (gc_log != NULL) {
+        fprintf(gc_log, "%s, %zu, %s, %f, %f, %f, %f, %f, %f, %zu, %zu, %zu, %zu, %f\n",
+                basename((char*)model_filename), gc->number, gc_trigger_names[gc->trigger], gc->timestamp,
+                gc->time, gc->clear_cache_time, gc->mark_time, gc->resize_time, gc->rehash_time,
+                gc->nodes_before, gc->nodes_after, gc->table_before, gc->table_after, gc->compact_time);
+    }
 }
 
 void
@@ -948,8 +1187,14 @@ main(int argc, char **argv)
      * First: set memory limits
      * - 2 GB memory, nodes table twice as big as cache, initial size halved 6x
      *   (that means it takes 6 garbage collections to get to the maximum nodes&cache size)
+     * - with a size hint (given, or the peak of a previous run), the initial nodes table
+     *   holds twice the hinted number of nodes, so it does not have to grow
+     * - with multiple workers extending (and merging) relations concurrently, the initial
+     *   nodes table holds at least PARALLEL_EXTEND_NODES nodes: in a table of a few thousand
+     *   nodes, the other workers can fill it again between the garbage collection of a
+     *   worker that found it full and the retry of that worker
      * Second: initialize package and subpackages
-     * Third: add hooks to report garbage collection
+     * Third: add hooks to report garbage collection and set the resize policy
      */
 
     size_t max = 16LL<<30;
@@ -959,10 +1204,27 @@ main(int argc, char **argv)
     printf(" max.\n");
 
     sylvan_set_limits(max, 1, 16);
+    if (stats_filename != NULL && !stats_header_matches(stats_filename, stats_header))
+        Abort("The columns of '%s' differ from this version, use a new file!\n", stats_filename);
+    if (size_hint == 0 && stats_filename != NULL) {
+        size_hint = read_peaknodes(stats_filename, basename((char*)model_filename));
+        if (size_hint != 0) INFO("Size hint from %s: %'zu nodes\n", stats_filename, size_hint);
+    }
+    if (size_hint != 0) sylvan_set_initial_nodes(2*size_hint);
+    else if (lace_workers() > 1 && (extend_rels || custom_img != 0)) sylvan_set_initial_nodes(PARALLEL_EXTEND_NODES);
     sylvan_init_package();
     sylvan_init_ldd();
+    if (cache_priority) cache_set_priority(CACHE_LDD_REACH, 1);
+    if (wide_chains) lddmc_wide_init(1LL<<14);
+    exact_count_init(1LL<<16);
     sylvan_gc_hook_pregc(TASK(gc_start));
     sylvan_gc_hook_postgc(TASK(gc_end));
+    if (gc_log_filename != NULL) open_gc_log();
+    // the nodes are only counted at every garbage collection for peaknodes and the gc log
+    if (stats_filename != NULL || gc_log_filename != NULL) sylvan_gc_count_nodes(1);
+    if (resize_policy == 1) sylvan_gc_hook_main(TASK(sylvan_gc_aggressive_resize));
+    else if (resize_policy == 2) sylvan_gc_hook_main(TASK(sylvan_gc_normal_resize));
+    INFO("Initial nodes table: %'zu nodes, operation cache: %'zu entries\n", llmsset_get_size(nodes), cache_getsize());
 
     /**
      * Read the model from file
@@ -989,6 +1251,7 @@ main(int argc, char **argv)
     for (int i=0; i<next_count; i++) rel_load(f, next[i]);
 
     /* We ignore the reachable states and action labels that are stored after the relations */
+    guard_count = next_count;
 
     /* Close the file */
     fclose(f);
@@ -1039,14 +1302,16 @@ main(int argc, char **argv)
     double t1 = wctime();
     if (extend_rels || custom_img != 0) {
         // extend relations (only works with custom image function)
-        if (extend_rels || custom_img != 0) {
-            INFO("Extending relation to full domain.\n");
-            for (int i = 0; i < next_count; i++) {
-                next[i]->dd = lddmc_extend_rel(next[i]->dd, next[i]->meta, 2*vector_size);
-                next[i]->meta = lddmc_make_readwrite_meta(vector_size, true);
-            }
-        }
+        INFO("Extending relation to full domain.\n");
+        MDD full_meta = lddmc_make_readwrite_meta(vector_size, true);
+        lddmc_protect(&full_meta);
+        extend_all(0, next_count, full_meta);
+        lddmc_unprotect(&full_meta);
     }
+    double t2 = wctime();
+    stats.extend_rel_time = t2-t1;
+
+    t1 = wctime();
     if (merge_relations) {
         INFO("Asserting transition relations to cover full domain.\n");
         for (int i = 0; i < next_count; i++) {
@@ -1064,12 +1329,19 @@ main(int argc, char **argv)
         }
         next_count = 1;
     }
-    double t2 = wctime();
+    t2 = wctime();
     stats.merge_rel_time = t2-t1;
 
+    /* dependencies between groups, for saturation and chaining */
+    if (strategy == strat_sat || strategy == strat_chaining) {
+        init_group_deps();
+    }
+
 
     set_t states = set_clone(initial);
 
+    RUN(compact_nodes);
+
 #ifdef HAVE_PROFILER
     if (profile_filename != NULL) ProfilerStart(profile_filename);
 #endif
@@ -1123,6 +1395,9 @@ main(int argc, char **argv)
         Abort("Invalid strategy set?!\n");
     }
 
+    if (extend_rels || custom_img != 0) {
+        INFO("Extend time: %f\n", stats.extend_rel_time);
+    }
     if (merge_relations) {
         INFO("Merge time: %f\n", stats.merge_rel_time);
     }
@@ -1132,8 +1407,8 @@ main(int argc, char **argv)
 #endif
 
     // Now we just have states
-    stats.final_states = lddmc_satcount_cached(states->dd);
-    INFO("Final states: %'0.0f states\n", stats.final_states);
+    stats.final_states = lddmc_exact_satcount_str(states->dd);
+    INFO("Final states: %s states\n", stats.final_states);
     if (report_nodes) {
         stats.final_nodecount = lddmc_nodecount(states->dd);
         INFO("Final states: %'zu MDD nodes\n", stats.final_nodecount);
@@ -1168,6 +1443,17 @@ main(int argc, char **argv)
         fclose(f);
     }
 
+    size_t filled;
+    sylvan_table_usage(&filled, NULL);
+    if (filled > stats.peaknodes) stats.peaknodes = filled;
+    INFO("Garbage collections: %zu (%zu compacting), peak nodes: %'zu\n", stats.gcs, stats.compactions, stats.peaknodes);
+    if (stats.gcs > 0) {
+        INFO("GC time: %f sec, max pause: %f sec (cache %f, mark %f, compact %f, resize %f, rehash %f)\n",
+             stats.gc_time, stats.gc_max_pause, stats.gc_clear_cache_time, stats.gc_mark_time,
+             stats.gc_compact_time, stats.gc_resize_time, stats.gc_rehash_time);
+    }
+    if (gc_log != NULL) fclose(gc_log);
+
     print_memory_usage();
     sylvan_stats_report(stdout);
 
@@ -1180,6 +1466,7 @@ main(int argc, char **argv)
         INFO("Writing stats to %s\n", stats_filename);
         write_stats();
     }
+    free(stats.final_states);
 
     return 0;
 }
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats_file.h"
+
+size_t
+read_peaknodes(const char *filename, const char *benchname)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) return 0;
+
+    int bench_col = -1, peak_col = -1;
+    size_t peak = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *cols[64];
+        int n = 0;
+        for (char *tok = strtok(line, ",\n"); tok != NULL && n < 64; tok = strtok(NULL, ",\n")) {
+            while (*tok == ' ') tok++;
+            cols[n++] = tok;
+        }
+        if (bench_col == -1 || peak_col == -1) {
+            // header line
+            for (int i=0; i<n; i++) {
+                if (strcmp(cols[i], "benchmark") == 0) bench_col = i;
+                else if (strcmp(cols[i], "peaknodes") == 0) peak_col = i;
+            }
+            if (bench_col == -1 || peak_col == -1) break;
+        } else if (n > bench_col && n > peak_col && strcmp(cols[bench_col], benchname) == 0) {
+            size_t p = strtoull(cols[peak_col], NULL, 10);
+            if (p > peak) peak = p;
+        }
+    }
+    fclose(fp);
+    return peak;
+}
+
+int
+stats_header_matches(const char *filename, const char *header)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) return 1;
+
+    char line[4096];
+    int res = 1;
+    if (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+        res = strcmp(line, header) == 0;
+    }
+    fclose(fp);
+    return res;
+}
@@ -0,0 +1,23 @@
+#ifndef STATS_FILE_H
+#define STATS_FILE_H
+
+#include <stddef.h>
+
+/**
+ * Reading back the .csv stats files that bddmc and lddmc append to
+ * (--statsfile, --gc-log). Columns are found by their name in the header line.
+ */
+
+/**
+ * Largest peaknodes of previous runs on the benchmark `benchname` in the
+ * stats file `filename`, or 0 if there are none (or the file does not exist)
+ */
+size_t read_peaknodes(const char *filename, const char *benchname);
+
+/**
+ * Can rows with the columns `header` be appended to the stats file `filename`?
+ * True if the file does not exist, is empty, or its first line is `header`.
+ */
+int stats_header_matches(const char *filename, const char *header);
+
+#endif
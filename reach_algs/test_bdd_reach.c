@@ -0,0 +1,229 @@
+#include "sylvan.h"
+#include "test_assert.h"
+#include "sylvan_int.h"
+#include "bdd_reach_algs.h"
+
+/* State variable i is BDD variable 2i, its primed copy is 2i+1 */
+static BDD
+state_var(int i, int value)
+{
+    return value ? sylvan_ithvar(2*i) : sylvan_nithvar(2*i);
+}
+
+static BDD
+next_var(int i, int value)
+{
+    return value ? sylvan_ithvar(2*i+1) : sylvan_nithvar(2*i+1);
+}
+
+static BDDSET
+state_vars(int n)
+{
+    BDDSET vars = sylvan_set_empty();
+    for (int i=n-1; i>=0; i--) vars = sylvan_set_add(vars, 2*i);
+    return vars;
+}
+
+static BDDSET
+rel_vars(int n)
+{
+    BDDSET vars = sylvan_set_empty();
+    for (int i=2*n-1; i>=0; i--) vars = sylvan_set_add(vars, i);
+    return vars;
+}
+
+/* Random BDD over the variables i..j-1 */
+static BDD
+make_random(int i, int j)
+{
+    if (i == j) return rand() % 2 ? sylvan_true : sylvan_false;
+
+    BDD yes = make_random(i+1, j);
+    BDD no = make_random(i+1, j);
+    switch (rand() % 4) {
+    case 0: return no;
+    case 1: return yes;
+    case 2: return sylvan_makenode(i, yes, no);
+    default: return sylvan_makenode(i, no, yes);
+    }
+}
+
+/**
+ * The top variable of the states is x1 (x0 is unconstrained), while the top
+ * variable of the relation is x0' (it writes x0 without reading it). REACH
+ * must split both on the pair (x0, x0'), not on (x0', x1).
+ */
+int test_reach_skipped_unprimed()
+{
+    // s = {x1 = 0}, r = {x0' = 1, x1' = 1}
+    BDD s = state_var(1, 0);
+    BDD r = sylvan_and(next_var(0, 1), next_var(1, 1));
+    BDDSET svars = state_vars(2);
+    BDDSET vars = rel_vars(2);
+
+    // s plus the state 11
+    BDD expected = sylvan_or(s, sylvan_and(state_var(0, 1), state_var(1, 1)));
+    test_assert(sylvan_satcount(expected, svars) == 3);
+
+    BDD res = bdd_reach(s, r, vars);
+    test_assert(res == expected);
+
+    res = RUN(go_rec_partial, s, r, vars);
+    test_assert(res == expected);
+
+    // the same below the top level: s = {x0 = 0, x2 = 0}, r = {x0' = x0, x1' = 1, x2' = 1}
+    s = sylvan_and(state_var(0, 0), state_var(2, 0));
+    r = sylvan_and(sylvan_equiv(state_var(0, 1), next_var(0, 1)), sylvan_and(next_var(1, 1), next_var(2, 1)));
+    svars = state_vars(3);
+    vars = rel_vars(3);
+
+    // s plus the state 011
+    expected = sylvan_or(s, sylvan_and(state_var(0, 0), sylvan_and(state_var(1, 1), state_var(2, 1))));
+    test_assert(sylvan_satcount(expected, svars) == 3);
+
+    res = bdd_reach(s, r, vars);
+    test_assert(res == expected);
+
+    res = RUN(go_rec_partial, s, r, vars);
+    test_assert(res == expected);
+
+    return 0;
+}
+
+/**
+ * Two groups that set x0 and x1 from 0 to 1, with the guards !x0 and !x1, so
+ * 11 is the only deadlock. A third group 11 -> 00 removes it.
+ */
+int test_reach_deadlocks()
+{
+    BDD s = sylvan_and(state_var(0, 0), state_var(1, 0));
+    BDD all = sylvan_true;
+    BDD dead = sylvan_and(state_var(0, 1), state_var(1, 1));
+    BDD r[3], guards[3];
+    BDDSET vars[3];
+    r[0] = sylvan_and(state_var(0, 0), next_var(0, 1));
+    r[1] = sylvan_and(state_var(1, 0), next_var(1, 1));
+    r[2] = sylvan_and(dead, sylvan_and(next_var(0, 0), next_var(1, 0)));
+    vars[0] = sylvan_set_add(sylvan_set_add(sylvan_set_empty(), 1), 0);
+    vars[1] = sylvan_set_add(sylvan_set_add(sylvan_set_empty(), 3), 2);
+    vars[2] = rel_vars(2);
+    for (int i=0; i<3; i++) guards[i] = sylvan_project(r[i], state_vars(2));
+    test_assert(guards[0] == state_var(0, 0));
+    test_assert(guards[1] == state_var(1, 0));
+
+    test_assert(bdd_guard_deadlocks(all, guards, 2) == dead);
+    test_assert(bdd_guard_deadlocks(all, guards, 3) == sylvan_false);
+    test_assert(bdd_guard_deadlocks(s, guards, 2) == sylvan_false);
+
+    // merged relations in the implicit identity encoding
+    BDD merged2 = bdd_rel_union_id(bdd_rel_identity(r[0], vars[0]), bdd_rel_identity(r[1], vars[1]));
+    BDD merged3 = bdd_rel_union_id(merged2, bdd_rel_identity(r[2], vars[2]));
+
+    for (int par=0; par<=1; par++) {
+        bool found;
+        BDD res = bdd_reach_multi_deadlocks(s, r, vars, 2, guards, 2, par, &found);
+        test_assert(found);
+        test_assert(sylvan_and(res, dead) != sylvan_false);
+        res = bdd_reach_id_deadlocks(s, merged2, guards, 2, par, &found);
+        test_assert(found);
+        test_assert(sylvan_and(res, dead) != sylvan_false);
+
+        res = bdd_reach_multi_deadlocks(s, r, vars, 3, guards, 3, par, &found);
+        test_assert(!found);
+        test_assert(res == all);
+        res = bdd_reach_id_deadlocks(s, merged3, guards, 3, par, &found);
+        test_assert(!found);
+        test_assert(res == all);
+    }
+
+    return 0;
+}
+
+/**
+ * The implicit identity encoding against the explicit one, on random partial
+ * relations over 5 state variables: relnext_id on bdd_rel_identity(t, vars)
+ * equals relnext on t, relnext_id on a union_id equals the union of the
+ * images, and REACH on the union equals the fixpoint of these images.
+ */
+int test_rel_identity_random()
+{
+    const int n = 5;
+    BDDSET svars = state_vars(n);
+    BDDSET vars[3];
+    vars[0] = rel_vars(n);
+    vars[1] = sylvan_set_fromarray(((BDDVAR[]){2,3,6,7}), 4);
+    vars[2] = sylvan_set_fromarray(((BDDVAR[]){4,5}), 2);
+
+    for (int i=0; i<100; i++) {
+        BDD s = sylvan_project(make_random(0, 2*n), svars);
+        BDD t[3], t_id[3];
+        for (int k=0; k<3; k++) {
+            t[k] = sylvan_project(make_random(0, 2*n), vars[k]);
+            t_id[k] = bdd_rel_identity(t[k], vars[k]);
+            test_assert(bdd_relnext_id(s, t_id[k]) == sylvan_relnext(s, t[k], vars[k]));
+        }
+
+        for (int a=0; a<3; a++) {
+            int b = (a+1) % 3;
+            BDD u = bdd_rel_union_id(t_id[a], t_id[b]);
+            test_assert(u == bdd_rel_union_id(t_id[b], t_id[a]));
+            BDD next = sylvan_or(sylvan_relnext(s, t[a], vars[a]), sylvan_relnext(s, t[b], vars[b]));
+            test_assert(bdd_relnext_id(s, u) == next);
+
+            // the reachable states, one image at a time
+            BDD reach = s, prev = sylvan_false;
+            while (reach != prev) {
+                prev = reach;
+                reach = sylvan_or(reach, sylvan_relnext(reach, t[a], vars[a]));
+                reach = sylvan_or(reach, sylvan_relnext(reach, t[b], vars[b]));
+            }
+            test_assert(bdd_reach_id(s, u) == reach);
+            BDD rels[2] = {t[a], t[b]};
+            BDDSET rvars[2] = {vars[a], vars[b]};
+            test_assert(bdd_reach_multi(s, rels, rvars, 2) == reach);
+        }
+    }
+
+    return 0;
+}
+
+int runtests()
+{
+    // we are not testing garbage collection
+    sylvan_gc_disable();
+
+    printf("Testing REACH with skipped unprimed variables...  "); fflush(stdout);
+    if (test_reach_skipped_unprimed()) return 1;
+    printf("OK\n");
+
+    printf("Testing implicit identity on random relations...  "); fflush(stdout);
+    srand(42);
+    if (test_rel_identity_random()) return 1;
+    printf("OK\n");
+
+    printf("Testing REACH with deadlock detection...          "); fflush(stdout);
+    if (test_reach_deadlocks()) return 1;
+    printf("OK\n");
+
+    return 0;
+}
+
+int main()
+{
+    // Standard Lace initialization with 1 worker
+    lace_start(1, 0);
+
+    // Simple Sylvan initialization, also initialize BDD support
+    sylvan_set_sizes(1LL<<20, 1LL<<20, 1LL<<16, 1LL<<16);
+    sylvan_init_package();
+    sylvan_init_bdd();
+
+    printf("Sylvan initialization complete.\n");
+
+    int res = runtests();
+
+    sylvan_quit();
+    lace_stop();
+
+    return res;
+}
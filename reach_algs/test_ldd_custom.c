@@ -2,6 +2,7 @@
 #include "test_assert.h"
 #include "sylvan_int.h"
 #include "ldd_custom.h"
+#include "ldd_wide.h"
 
 static MDD write_mdd(MDD rel, char *name, int i)
 {
@@ -280,8 +281,8 @@ int test_homomorphism_nodes3()
     s2 = lddmc_union(s1, s2);
 
     MDD reach1, reach2, temp;
-    reach1 = RUN(go_rec, s1, rel, meta, 1); // {<10,2>,<20,5>}
-    reach2 = RUN(go_rec, s2, rel, meta, 1); // {<10,2>,<10,8>,<20,5>,<20,11>}
+    reach1 = RUN(go_rec, s1, rel, lddmc_true, meta, 1); // {<10,2>,<20,5>}
+    reach2 = RUN(go_rec, s2, rel, lddmc_true, meta, 1); // {<10,2>,<10,8>,<20,5>,<20,11>}
 
     temp = reach1;
     test_assert(lddmc_getvalue(temp) == 10);    temp = lddmc_getdown(temp);
@@ -321,8 +322,8 @@ int test_homomorphism_nodes4()
     test_assert(lddmc_satcount(s1) == 3);
 
     MDD reach1, reach2, temp;
-    reach1 = RUN(go_rec, s1, rel, meta, 1); // {<5,10>, <5,11>, <6,10>, <8,20>, <9,20>}
-    //reach2 = RUN(go_rec, s2, rel, meta, 1); // {}
+    reach1 = RUN(go_rec, s1, rel, lddmc_true, meta, 1); // {<5,10>, <5,11>, <6,10>, <8,20>, <9,20>}
+    //reach2 = RUN(go_rec, s2, rel, lddmc_true, meta, 1); // {}
 
     test_assert(lddmc_satcount(reach1) == 5);
 
@@ -382,6 +383,58 @@ int test_homomorphism_nodes5()
     return 0;
 }
 
+int test_homomorphism_nodes6()
+{
+    // Normal reads and homomorphism reads in the same relation
+    // Rel : {(2 -> 3), (>=5 -> -1)}
+    MDD rel, hmorph;
+    hmorph = lddmc_make_homomorphism_node(1, 1, lddmc_true, lddmc_false);
+    hmorph = lddmc_make_homomorphism_node(5, 0, hmorph, lddmc_false);
+    rel = lddmc_make_normalnode(3, lddmc_true, lddmc_false);
+    rel = lddmc_make_normalnode(2, rel, hmorph);
+    MDD meta = lddmc_make_readwrite_meta(1, false);
+
+    // s1 = {1,4}, s2 = {2,6}, s3 = {7}
+    MDD s1, s2, s3;
+    s1 = lddmc_make_normalnode(4, lddmc_true, lddmc_false);
+    s1 = lddmc_make_normalnode(1, lddmc_true, s1);
+    s2 = lddmc_make_normalnode(6, lddmc_true, lddmc_false);
+    s2 = lddmc_make_normalnode(2, lddmc_true, s2);
+    s3 = lddmc_make_normalnode(7, lddmc_true, lddmc_false);
+
+    MDD t1, t2, t3;
+    t1 = lddmc_image(s1, rel, meta); // {}
+    t2 = lddmc_image(s2, rel, meta); // {3,5}
+    t3 = lddmc_image(s3, rel, meta); // {6}
+    test_assert(t1 == lddmc_false);
+    test_assert(lddmc_satcount(t2) == 2);
+    test_assert(lddmc_follow(t2, 3) == lddmc_true);
+    test_assert(lddmc_follow(t2, 5) == lddmc_true);
+    test_assert(lddmc_satcount(t3) == 1);
+    test_assert(lddmc_follow(t3, 6) == lddmc_true);
+
+    MDD reach1, reach2, reach3;
+    reach1 = RUN(go_rec, s1, rel, lddmc_true, meta, 1); // {1,4}
+    reach2 = RUN(go_rec, s2, rel, lddmc_true, meta, 1); // {2,3,4,5,6}
+    reach3 = RUN(go_rec, s3, rel, lddmc_true, meta, 1); // {4,5,6,7}
+    test_assert(reach1 == s1);
+    test_assert(lddmc_satcount(reach2) == 5);
+    test_assert(lddmc_follow(reach2, 1) == lddmc_false);
+    test_assert(lddmc_satcount(reach3) == 4);
+    test_assert(lddmc_follow(reach3, 4) == lddmc_true);
+
+    // right-recursive image and REACH should give the same results
+    test_assert(lddmc_image2(s1, rel, meta) == t1);
+    test_assert(lddmc_image2(s2, rel, meta) == t2);
+    test_assert(lddmc_image2(s3, rel, meta) == t3);
+    test_assert(RUN(go_rec2, s1, rel, meta, 2) == reach1);
+    test_assert(RUN(go_rec2, s2, rel, meta, 2) == reach2);
+    test_assert(RUN(go_rec2, s3, rel, meta, 2) == reach3);
+    test_assert(RUN(go_rec, s3, rel, lddmc_true, meta, 2) == reach3);
+
+    return 0;
+}
+
 int test_homomorphism_nodes_copy1()
 {
     // Really just a copy, but encoded as hmorph(+0)
@@ -1520,6 +1573,120 @@ int test_rel_union6()
     return 0;
 }
 
+/**
+ * Relation over (x0, x1) with x1 a counter 0..n-1 (for both values of x0)
+ * and x0: 0 -> 1 at x1 = 0. With wrap, x1 = n-1 goes back to 0, otherwise
+ * the states with x1 = n-1 are the only deadlocks.
+ */
+static MDD
+counter_rel(uint32_t n, bool wrap)
+{
+    MDD rel = lddmc_false;
+    for (uint32_t x0 = 0; x0 <= 1; x0++) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (i == n-1 && !wrap) continue;
+            uint32_t t[4] = {x0, x0, i, (i+1) % n};
+            rel = lddmc_union(rel, lddmc_cube(t, 4));
+        }
+    }
+    uint32_t t[4] = {0, 1, 0, 0};
+    return lddmc_union(rel, lddmc_cube(t, 4));
+}
+
+/* The states (x0, x1) with x0 in {0, 1} and x1 in [from, to) */
+static MDD
+counter_states(uint32_t from, uint32_t to)
+{
+    MDD set = lddmc_false;
+    for (uint32_t x0 = 0; x0 <= 1; x0++) {
+        for (uint32_t i = from; i < to; i++) {
+            uint32_t s[2] = {x0, i};
+            set = lddmc_union(set, lddmc_cube(s, 2));
+        }
+    }
+    return set;
+}
+
+int test_rel_guard1()
+{
+    uint32_t n = 8;
+    MDD meta = lddmc_make_readwrite_meta(2, false);
+    MDD rel = counter_rel(n, false);
+    MDD all = counter_states(0, n);
+
+    // Enabled: x1 < n-1
+    MDD guard = lddmc_rel_guard(rel, meta);
+    test_assert(guard == counter_states(0, n-1));
+
+    // Deadlocks: x1 = n-1
+    MDD dead = lddmc_guard_deadlocks(all, guard);
+    test_assert(dead == counter_states(n-1, n));
+    test_assert(lddmc_guard_deadlocks(counter_states(0, n-1), guard) == lddmc_false);
+
+    // Without deadlocks
+    rel = counter_rel(n, true);
+    guard = lddmc_rel_guard(rel, meta);
+    test_assert(guard == all);
+    test_assert(lddmc_guard_deadlocks(all, guard) == lddmc_false);
+
+    return 0;
+}
+
+int test_rel_guard2()
+{
+    // Copy node on x0: {(* -> *), (i -> i+1)} for i < n-1, guard {(*, i)}
+    uint32_t n = 8;
+    MDD meta = lddmc_make_readwrite_meta(2, false);
+    MDD rel1 = lddmc_false;
+    MDD expected = lddmc_false;
+    for (uint32_t i = 0; i < n-1; i++) {
+        rel1 = lddmc_union(rel1, stack_transition(i, i+1, lddmc_true));
+        expected = lddmc_union(expected, lddmc_makenode(i, lddmc_true, lddmc_false));
+    }
+    MDD rel = lddmc_make_copynode(lddmc_make_copynode(rel1, lddmc_false), lddmc_false);
+    expected = lddmc_make_copynode(expected, lddmc_false);
+
+    MDD guard = lddmc_rel_guard(rel, meta);
+    test_assert(guard == expected);
+
+    uint32_t s53[2] = {5, 3};
+    MDD all = lddmc_union(counter_states(0, n), lddmc_cube(s53, 2));
+    MDD dead = lddmc_guard_deadlocks(all, guard);
+    test_assert(dead == counter_states(n-1, n));
+
+    return 0;
+}
+
+int test_reach_deadlocks()
+{
+    uint32_t n = 8;
+    MDD meta = lddmc_make_readwrite_meta(2, false);
+    uint32_t s0[2] = {0, 0};
+    MDD init = lddmc_cube(s0, 2);
+    MDD all = counter_states(0, n);
+    bool found;
+
+    // Without deadlocks: the full reachable set
+    MDD rel = counter_rel(n, true);
+    MDD guard = lddmc_rel_guard(rel, meta);
+    MDD res = lddmc_reach_deadlocks(init, rel, guard, meta, 1, &found);
+    test_assert(!found);
+    test_assert(res == all);
+    test_assert(RUN(go_rec, init, rel, lddmc_true, meta, 1) == all);
+
+    // With deadlocks: stops once (0, n-1) is reached, before exploring x0 = 1
+    rel = counter_rel(n, false);
+    guard = lddmc_rel_guard(rel, meta);
+    test_assert(RUN(go_rec, init, rel, lddmc_true, meta, 1) == all);
+    res = lddmc_reach_deadlocks(init, rel, guard, meta, 1, &found);
+    test_assert(found);
+    test_assert(lddmc_guard_deadlocks(res, guard) != lddmc_false);
+    test_assert(lddmc_intersect(res, all) == res);
+    test_assert(lddmc_satcount(res) < lddmc_satcount(all));
+
+    return 0;
+}
+
 MDD generate_random_meta(uint32_t nvars)
 {
     MDD meta = lddmc_true;
@@ -1613,7 +1780,7 @@ MDD generate_random_rel(MDD meta, uint32_t max_val, MDD *s_init)
 int test_random_relations(uint32_t num_tests, uint32_t nvars, uint32_t n_rels)
 {
     MDD *meta, *rel, *rel_ext, *s, states, merged_rels;
-    MDD succ0, succ1, succ2, succ_temp;
+    MDD succ0, succ1, succ2, succ3, succ_temp;
     MDD r_w_meta = lddmc_make_readwrite_meta(nvars, false);
     
     meta    = malloc(n_rels * sizeof(MDD));
@@ -1656,9 +1823,10 @@ int test_random_relations(uint32_t num_tests, uint32_t nvars, uint32_t n_rels)
             merged_rels = lddmc_union(merged_rels, rel_ext[j]);
         }
         succ2 = lddmc_image(states, merged_rels, r_w_meta);
+        succ3 = lddmc_image2(states, merged_rels, r_w_meta);
 
         assert(lddmc_satcount(succ0) >= 1);
-        if (succ0 != succ1 || succ1 != succ2) {
+        if (succ0 != succ1 || succ1 != succ2 || succ2 != succ3) {
             printf("Issue found, writing issue rels\n");
             for (uint32_t j = 0; j < n_rels; j++) {
                 write_mdd(meta[j], "meta", j);
@@ -1671,8 +1839,10 @@ int test_random_relations(uint32_t num_tests, uint32_t nvars, uint32_t n_rels)
                 write_mdd(succ0, "succ", 0);
                 write_mdd(succ1, "succ", 1);
                 write_mdd(succ2, "succ", 2);
+                write_mdd(succ3, "succ", 3);
             assert(succ0 == succ1);
             assert(succ1 == succ2);
+            assert(succ2 == succ3);
         }
     }
 
@@ -1684,6 +1854,52 @@ int test_random_relations(uint32_t num_tests, uint32_t nvars, uint32_t n_rels)
     return 0;
 }
 
+/* (a task, since the index is only used on Lace workers) */
+TASK_0(int, test_wide_chains)
+{
+    // chain {0, 3, 6, ..., 297} followed by some homomorphism values
+    MDD chain = lddmc_false;
+    for (int v = 2; v >= 0; v--)
+        chain = lddmc_make_homomorphism_node(v, false, lddmc_true, chain);
+    for (int v = 297; v >= 0; v -= 3)
+        chain = lddmc_makenode(v, lddmc_makenode(v+1, lddmc_true, lddmc_false), chain);
+
+    for (int pass = 0; pass < 2; pass++) {
+        // seek (from the start) and follow should match lddmc_follow
+        for (uint32_t v = 0; v < 310; v++) {
+            test_assert(lddmc_wide_follow(chain, v) == lddmc_follow(chain, v));
+            lddmc_wide_itr_t itr;
+            lddmc_wide_start(&itr, chain);
+            int found = lddmc_wide_seek(&itr, v);
+            test_assert(found == (v < 300 && v % 3 == 0));
+            test_assert(lddmc_wide_value(&itr) == (v <= 297 ? (v+2)/3*3 : 0x80000000));
+        }
+
+        // merge-join style seeks, and stepping through the entire chain
+        lddmc_wide_itr_t itr;
+        lddmc_wide_start(&itr, chain);
+        for (uint32_t v = 0; v < 300; v += 6) {
+            test_assert(lddmc_wide_seek(&itr, v));
+            test_assert(lddmc_getdown(itr.node) == lddmc_wide_down(&itr));
+        }
+        test_assert(!lddmc_wide_seek(&itr, 0x80000003));
+        test_assert(itr.node == lddmc_false);
+
+        MDD node = chain;
+        for (lddmc_wide_start(&itr, chain); itr.node != lddmc_false; lddmc_wide_next(&itr)) {
+            test_assert(itr.node == node);
+            test_assert(lddmc_wide_value(&itr) == lddmc_getvalue(node));
+            node = lddmc_getright(node);
+        }
+        test_assert(node == lddmc_false);
+
+        // second pass with a fresh (empty) index
+        lddmc_wide_init(1<<10);
+    }
+
+    return 0;
+}
+
 int runtests()
 {
     // we are not testing garbage collection
@@ -1702,12 +1918,17 @@ int runtests()
     if (test_lddmc_image_only_write2()) return 1;
     printf("OK\n");
 
+    printf("Testing packed sibling chains...                "); fflush(stdout);
+    if (RUN(test_wide_chains)) return 1;
+    printf("OK\n");
+
     printf("Testing homomorphism nodes...                   "); fflush(stdout);
     if (test_homomorphism_nodes1()) return 1;
     if (test_homomorphism_nodes2()) return 1;
     if (test_homomorphism_nodes3()) return 1;
     if (test_homomorphism_nodes4()) return 1;
     if (test_homomorphism_nodes5()) return 1;
+    if (test_homomorphism_nodes6()) return 1;
     if (test_homomorphism_nodes_copy1()) return 1;
     if (test_homomorphism_nodes_copy2()) return 1;
     printf("OK\n");
@@ -1751,6 +1972,12 @@ int runtests()
     if (test_rel_union6()) return 1;
     printf("OK\n");
 
+    printf("Testing guards and deadlock detection...        "); fflush(stdout);
+    if (test_rel_guard1()) return 1;
+    if (test_rel_guard2()) return 1;
+    if (test_reach_deadlocks()) return 1;
+    printf("OK\n");
+
     srand(42);
     uint32_t n = 500;
     uint32_t max_vars = 5;
@@ -1779,6 +2006,7 @@ int main()
     sylvan_init_bdd();
     sylvan_init_mtbdd();
     sylvan_init_ldd();
+    lddmc_wide_init(1<<10);
 
     printf("Sylvan initialization complete.\n");
 
@@ -0,0 +1,87 @@
+#!/bin/bash
+
+# Compares the hash functions of the nodes table and operation cache
+# (SYLVAN_HASH) on REACH for the BEEM models. Builds Sylvan once per hash
+# function, runs hashbench (throughput and probe lengths) and then bddmc and
+# lddmc with --strategy=rec against each build. Run from the repository root
+# after compile_sources.sh.
+#
+# usage:
+# bash scripts/bench_hash.sh [-w workers] [-t maxtime] [-n amount_per_dataset] [-h "default fnv mix crc32c"] [small]
+
+num_workers=1
+maxtime=10m
+amount=10
+hashes="default fnv mix crc32c"
+
+bddmc=reach_algs/build/bddmc
+lddmc=reach_algs/build/lddmc
+
+while getopts "w:t:n:h:" opt; do
+  case $opt in
+    w) num_workers="$OPTARG"
+    ;;
+    t) maxtime="$OPTARG"
+    ;;
+    n) amount="$OPTARG"
+    ;;
+    h) hashes="$OPTARG"
+    ;;
+    \?) echo "Invalid option -$OPTARG" >&1; exit 1;
+    ;;
+  esac
+done
+shift $((OPTIND-1))
+
+for var in "$@"; do
+  if [[ $var == 'small' ]]; then only_small=true; fi
+done
+
+outputfolder=bench_data/hash
+mkdir -p $outputfolder
+
+head_or_shuf=head
+beem_bdd_list=models/beem/permuted_bdds.txt
+beem_ldd_list=models/beem/permuted_ldds.txt
+if [[ $only_small ]]; then
+  beem_bdd_list=models/beem/small_bdds.txt
+  beem_ldd_list=models/beem/small_ldds.txt
+fi
+
+echo "Comparing hash functions [$hashes] with [$num_workers] workers"
+echo "timeout per run is $maxtime"
+echo "writing .csv output files to folder $outputfolder"
+
+for hash in $hashes; do
+  # build Sylvan with this hash function
+  builddir=sylvan/build-hash-$hash
+  cmake -S sylvan -B $builddir -DCMAKE_BUILD_TYPE=Release -DSYLVAN_HASH=$hash -DSYLVAN_BUILD_EXAMPLES=ON > /dev/null || exit 1
+  cmake --build $builddir -j > /dev/null || exit 1
+
+  # the microbenchmark covers all hash functions, so it runs only once
+  if [[ ! $ran_hashbench ]]; then
+    ./$builddir/examples/hashbench | tee $outputfolder/hashbench.txt
+    ran_hashbench=true
+  fi
+
+  # bddmc and lddmc use the libsylvan.so of this build
+  export LD_LIBRARY_PATH=$builddir/src
+
+  # BEEM, Sloan BDDs
+  $head_or_shuf -n $amount $beem_bdd_list | while read filename; do
+    filepath=models/beem/bdds/sloan/$filename
+    for nw in $num_workers; do
+      timeout $maxtime ./$bddmc $filepath --workers=$nw --strategy=rec --merge-relations --count-nodes --statsfile=$outputfolder/beem_sloan_stats_bdd_$hash.csv
+    done
+  done
+
+  # BEEM, Sloan LDDs
+  $head_or_shuf -n $amount $beem_ldd_list | while read filename; do
+    filepath=models/beem/ldds/sloan/$filename
+    for nw in $num_workers; do
+      timeout $maxtime ./$lddmc $filepath --workers=$nw --strategy=rec --merge-relations --count-nodes --statsfile=$outputfolder/beem_sloan_stats_ldd_$hash.csv
+    done
+  done
+
+  unset LD_LIBRARY_PATH
+done
@@ -390,6 +390,11 @@ def _plot_time_comp(compare, ax, x_dd, y_dd, x_select, y_select, z_select=None,
         if (add_merge_time):
             xs += joined['merge_time_x'].to_numpy()
             ys += joined['merge_time_y'].to_numpy()
+            # lddmc reports extending the relations separately
+            if 'extend_time_x' in joined:
+                xs += joined['extend_time_x'].fillna(0).to_numpy()
+            if 'extend_time_y' in joined:
+                ys += joined['extend_time_y'].fillna(0).to_numpy()
         
         # some styling
         s = marker_size[ds_name]
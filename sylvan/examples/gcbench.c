@@ -0,0 +1,174 @@
+/**
+ * Garbage collection microbenchmark.
+ * Fills the nodes table with a random layered BDD and then runs garbage collection
+ * a number of times, reporting how many nodes per second are marked and rehashed.
+ */
+
+#include <argp.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <sylvan.h>
+#include <sylvan_table.h>
+
+/* Configuration */
+static int workers = 0; // autodetect number of workers by default
+static int table_log = 24; // nodes table of 2^24 buckets
+static int fill = 50; // percentage of the table filled with nodes
+static int levels = 64; // number of BDD variables
+static int rounds = 10; // number of garbage collections measured
+
+/* argp configuration */
+static struct argp_option options[] =
+{
+    {"workers", 'w', "<workers>", 0, "Number of workers (default=0: autodetect)", 0},
+    {"table", 't', "<log2>", 0, "Nodes table size is 2^<log2> buckets (default=24)", 0},
+    {"fill", 'f', "<percent>", 0, "Percentage of the nodes table filled (default=50)", 0},
+    {"levels", 'l', "<levels>", 0, "Number of BDD variables (default=64)", 0},
+    {"rounds", 'r', "<rounds>", 0, "Number of garbage collections (default=10)", 0},
+    {0, 0, 0, 0, 0, 0}
+};
+static error_t
+parse_opt(int key, char *arg, struct argp_state *state)
+{
+    switch (key) {
+    case 'w':
+        workers = atoi(arg);
+        break;
+    case 't':
+        table_log = atoi(arg);
+        break;
+    case 'f':
+        fill = atoi(arg);
+        break;
+    case 'l':
+        levels = atoi(arg);
+        break;
+    case 'r':
+        rounds = atoi(arg);
+        break;
+    case ARGP_KEY_ARG:
+        argp_usage(state);
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+static struct argp argp = { options, parse_opt, 0, 0, 0, 0, 0 };
+
+/* Obtain current wallclock time */
+static double
+wctime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + 1E-6 * tv.tv_usec);
+}
+
+static double t_start;
+#define INFO(s, ...) fprintf(stdout, "[% 8.2f] " s, wctime()-t_start, ##__VA_ARGS__)
+#define Abort(...) { fprintf(stderr, __VA_ARGS__); exit(-1); }
+
+/* xorshift64*, deterministic so runs are comparable */
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t
+rng()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Create up to `width` nodes on every level, from the bottom level up. The low
+ * child of the i-th node is the i-th node of the level directly below, so every
+ * node is reachable from the roots (the nodes on the top level) and the table
+ * is filled with live nodes. The high child is chosen at random among all nodes
+ * created on lower levels. Both children are possibly complemented.
+ */
+static void
+make_layers(BDD *roots, size_t width)
+{
+    BDD *pool = (BDD*)malloc(sizeof(BDD[width*levels+1]));
+    size_t count = 0;
+    pool[count++] = sylvan_false;
+
+    for (int var=levels-1; var>=0; var--) {
+        const size_t below = count;
+        for (size_t i=0; i<width; i++) {
+            BDD low = var == levels-1 ? pool[0] : pool[below-width+i];
+            BDD high = pool[rng() % below];
+            if (rng() & 1) low = sylvan_not(low);
+            if (rng() & 1) high = sylvan_not(high);
+            if (low == high) high = sylvan_not(high);
+            roots[i] = pool[count++] = sylvan_makenode(var, low, high);
+        }
+    }
+
+    free(pool);
+}
+
+int
+main(int argc, char** argv)
+{
+    argp_parse(&argp, argc, argv, 0, 0, 0);
+    setlocale(LC_NUMERIC, "en_US.utf-8");
+    t_start = wctime();
+
+    if (table_log < 12 || table_log > 40) Abort("Table size out of range!\n");
+    if (fill < 1 || fill > 90) Abort("Fill percentage out of range!\n");
+    if (levels < 2) Abort("At least 2 levels required!\n");
+
+    lace_start(workers, 1000000);
+
+    // Fixed table sizes, so garbage collection never resizes
+    const size_t table_size = 1LL<<table_log;
+    sylvan_set_sizes(table_size, table_size, 1LL<<16, 1LL<<16);
+    sylvan_init_package();
+    sylvan_init_bdd();
+    sylvan_gc_disable();
+    sylvan_gc_count_nodes(1);
+
+    const size_t width = table_size / 100 * fill / levels;
+    BDD *roots = (BDD*)malloc(sizeof(BDD[width]));
+    make_layers(roots, width);
+    for (size_t i=0; i<width; i++) sylvan_protect(&roots[i]);
+    sylvan_gc_enable();
+
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    INFO("Nodes table: %'zu of %'zu buckets filled, %d levels of %'zu nodes, %d workers\n",
+         filled, total, levels, width, lace_workers());
+
+    double best_mark = 0, best_rehash = 0, sum_mark = 0, sum_rehash = 0, sum_time = 0;
+    size_t live = 0;
+    for (int i=0; i<rounds; i++) {
+        sylvan_gc();
+        const sylvan_gc_info_t *gc = sylvan_gc_last_info();
+        live = gc->nodes_after;
+        sum_mark += gc->mark_time;
+        sum_rehash += gc->rehash_time;
+        sum_time += gc->time;
+        if (i == 0 || gc->mark_time < best_mark) best_mark = gc->mark_time;
+        if (i == 0 || gc->rehash_time < best_rehash) best_rehash = gc->rehash_time;
+    }
+
+    INFO("Live nodes: %'zu\n", live);
+    INFO("Average GC time: %f sec (mark %f, rehash %f)\n", sum_time/rounds, sum_mark/rounds, sum_rehash/rounds);
+    INFO("Mark: %'.0f nodes/sec (best of %d rounds)\n", live/best_mark, rounds);
+    INFO("Rehash: %'.0f nodes/sec (best of %d rounds)\n", live/best_rehash, rounds);
+
+    for (size_t i=0; i<width; i++) sylvan_unprotect(&roots[i]);
+    free(roots);
+
+    sylvan_quit();
+    lace_stop();
+    return 0;
+}
@@ -0,0 +1,347 @@
+/**
+ * Hash function microbenchmark.
+ * Fills the nodes table with a random layered BDD and then, for every hash
+ * function that can be selected with SYLVAN_HASH, reports the throughput of
+ * the nodes table hash and the operation cache hash on the nodes in the table,
+ * the distribution of probe lengths when these nodes are inserted into an
+ * empty table with the probe sequence of the nodes table, and how many
+ * buckets of a direct-mapped cache of the same size the nodes occupy.
+ * End-to-end REACH times per hash function: see scripts/bench_hash.sh.
+ */
+
+#include <argp.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <sylvan_int.h>
+
+/* Configuration */
+static int workers = 1; // the benchmark itself is sequential
+static int table_log = 22; // nodes table of 2^22 buckets
+static int fill = 50; // percentage of the table filled with nodes
+static int levels = 64; // number of BDD variables
+static int rounds = 10; // number of throughput measurements
+
+/* argp configuration */
+static struct argp_option options[] =
+{
+    {"workers", 'w', "<workers>", 0, "Number of workers (default=1)", 0},
+    {"table", 't', "<log2>", 0, "Nodes table size is 2^<log2> buckets (default=22)", 0},
+    {"fill", 'f', "<percent>", 0, "Percentage of the nodes table filled (default=50)", 0},
+    {"levels", 'l', "<levels>", 0, "Number of BDD variables (default=64)", 0},
+    {"rounds", 'r', "<rounds>", 0, "Number of throughput measurements (default=10)", 0},
+    {0, 0, 0, 0, 0, 0}
+};
+static error_t
+parse_opt(int key, char *arg, struct argp_state *state)
+{
+    switch (key) {
+    case 'w':
+        workers = atoi(arg);
+        break;
+    case 't':
+        table_log = atoi(arg);
+        break;
+    case 'f':
+        fill = atoi(arg);
+        break;
+    case 'l':
+        levels = atoi(arg);
+        break;
+    case 'r':
+        rounds = atoi(arg);
+        break;
+    case ARGP_KEY_ARG:
+        argp_usage(state);
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+static struct argp argp = { options, parse_opt, 0, 0, 0, 0, 0 };
+
+/* Obtain current wallclock time */
+static double
+wctime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec + 1E-6 * tv.tv_usec);
+}
+
+static double t_start;
+#define INFO(s, ...) fprintf(stdout, "[% 8.2f] " s, wctime()-t_start, ##__VA_ARGS__)
+#define Abort(...) { fprintf(stderr, __VA_ARGS__); exit(-1); }
+
+/* xorshift64*, deterministic so runs are comparable */
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t
+rng()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Create up to `width` nodes on every level, from the bottom level up, with
+ * children (possibly complemented) chosen at random among all nodes created
+ * on lower levels.
+ */
+static void
+make_layers(size_t width)
+{
+    BDD *pool = (BDD*)malloc(sizeof(BDD[width*levels+1]));
+    size_t count = 0;
+    pool[count++] = sylvan_false;
+
+    for (int var=levels-1; var>=0; var--) {
+        const size_t below = count;
+        for (size_t i=0; i<width; i++) {
+            BDD low = pool[rng() % below];
+            BDD high = pool[rng() % below];
+            if (rng() & 1) low = sylvan_not(low);
+            if (rng() & 1) high = sylvan_not(high);
+            if (low == high) high = sylvan_not(high);
+            pool[count++] = sylvan_makenode(var, low, high);
+        }
+    }
+
+    free(pool);
+}
+
+/* The nodes in the table, as the (a, b) keys that the nodes table hashes */
+static uint64_t *keys;
+static size_t key_count;
+
+static const uint64_t seed = 14695981039346656037LLU;
+
+/* Functions without a 24-byte version use FNV-1a for the cache, as in the default build */
+#define sylvan_tabhash24 sylvan_fnvhash24
+
+/**
+ * One row per hash function. The benchmark loops are generated per function,
+ * so the hash is inlined as in the nodes table and the operation cache.
+ */
+#define HASH_FUNCTIONS(X) \
+    X(tab, "default (tabulation, cache FNV-1a)") \
+    X(fnv, "fnv") \
+    X(mix, "mix") \
+    X(crc32c, "crc32c")
+
+#define HASH_LOOPS(NAME, DESC) \
+static uint64_t \
+loop16_##NAME(void) \
+{ \
+    uint64_t sum = 0; \
+    for (size_t i=0; i<key_count; i++) sum += sylvan_##NAME##hash16(keys[2*i], keys[2*i+1], seed); \
+    return sum; \
+} \
+static uint64_t \
+loop24_##NAME(void) \
+{ \
+    uint64_t sum = 0; \
+    for (size_t i=0; i<key_count; i++) sum += sylvan_##NAME##hash24(keys[2*i] | (1LL<<40), keys[2*i+1], keys[2*i], seed); \
+    return sum; \
+} \
+static uint64_t \
+hash16_##NAME(uint64_t a, uint64_t b) \
+{ \
+    return sylvan_##NAME##hash16(a, b, seed); \
+} \
+static uint64_t \
+hash24_##NAME(uint64_t a, uint64_t b, uint64_t c) \
+{ \
+    return sylvan_##NAME##hash24(a, b, c, seed); \
+}
+
+#if !SYLVAN_HAVE_CRC32C
+/* Not available on this target (compile with -msse4.2), the row is skipped */
+#define sylvan_crc32chash16(a, b, s) ((void)(a), (void)(b), (uint64_t)(s))
+#define sylvan_crc32chash24(a, b, c, s) ((void)(a), (void)(b), (void)(c), (uint64_t)(s))
+#endif
+
+HASH_FUNCTIONS(HASH_LOOPS)
+
+typedef struct hash_function {
+    const char *name;
+    uint64_t (*loop16)(void);
+    uint64_t (*loop24)(void);
+    uint64_t (*hash16)(uint64_t, uint64_t);
+    uint64_t (*hash24)(uint64_t, uint64_t, uint64_t);
+} hash_function_t;
+
+#define HASH_ROW(NAME, DESC) {DESC, loop16_##NAME, loop24_##NAME, hash16_##NAME, hash24_##NAME},
+static hash_function_t functions[] = { HASH_FUNCTIONS(HASH_ROW) };
+
+static int
+available(const hash_function_t *f)
+{
+    if (strcmp(f->name, "crc32c") != 0) return 1;
+#if !SYLVAN_HAVE_CRC32C
+    return 0;
+#elif defined(__x86_64__)
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 1;
+#endif
+}
+
+/* Best time of <rounds> runs of the loop, in seconds */
+static volatile uint64_t sink;
+
+static double
+time_loop(uint64_t (*loop)(void))
+{
+    double best = 0;
+    for (int r=0; r<rounds; r++) {
+        double t = wctime();
+        sink += loop();
+        t = wctime() - t;
+        if (r == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/* Histogram of probe lengths (number of buckets inspected) */
+#define PROBE_CLASSES 7
+static const size_t probe_class_max[PROBE_CLASSES] = {1, 2, 4, 8, 16, 64, (size_t)-1};
+static const char *probe_class_name[PROBE_CLASSES] = {"1", "2", "3-4", "5-8", "9-16", "17-64", ">64"};
+
+/**
+ * Insert all keys into an empty table of 2^table_log buckets with the probe
+ * sequence of the nodes table (llmsset_lookup): linear probing within a cache
+ * line, then the next cache line at a hash-dependent step.
+ */
+static void
+simulate_probes(const hash_function_t *f, size_t *histogram, double *mean, size_t *max)
+{
+    const size_t size = 1LL<<table_log;
+    const uint64_t mask = size - 1;
+    const uint64_t line_mask = (LINE_SIZE/8) - 1;
+    uint8_t *table = (uint8_t*)calloc(size, 1);
+    size_t total = 0;
+    *max = 0;
+    memset(histogram, 0, sizeof(size_t[PROBE_CLASSES]));
+
+    for (size_t k=0; k<key_count; k++) {
+        uint64_t hash = f->hash16(keys[2*k], keys[2*k+1]);
+        const uint64_t step = (((hash >> 20) | 1) << 3);
+        uint64_t idx = hash & mask, last = idx;
+        size_t probes = 1;
+        while (table[idx]) {
+            probes++;
+            idx = (idx & ~line_mask) | ((idx+1) & line_mask);
+            if (idx == last) {
+                hash += step;
+                last = idx = hash & mask;
+            }
+        }
+        table[idx] = 1;
+        total += probes;
+        if (probes > *max) *max = probes;
+        int c = 0;
+        while (probes > probe_class_max[c]) c++;
+        histogram[c]++;
+    }
+
+    *mean = (double)total / key_count;
+    free(table);
+}
+
+/**
+ * Fraction of the buckets of a direct-mapped cache of 2^table_log buckets
+ * that is occupied after putting an operation on every node
+ */
+static double
+simulate_cache(const hash_function_t *f)
+{
+    const size_t size = 1LL<<table_log;
+    uint8_t *table = (uint8_t*)calloc(size, 1);
+    size_t used = 0;
+    for (size_t k=0; k<key_count; k++) {
+        uint64_t hash = f->hash24(keys[2*k] | (1LL<<40), keys[2*k+1], keys[2*k]);
+        uint8_t *bucket = table + (hash & (size-1));
+        if (!*bucket) used++;
+        *bucket = 1;
+    }
+    free(table);
+    return (double)used / size;
+}
+
+int
+main(int argc, char** argv)
+{
+    argp_parse(&argp, argc, argv, 0, 0, 0);
+    setlocale(LC_NUMERIC, "en_US.utf-8");
+    t_start = wctime();
+
+    if (table_log < 12 || table_log > 32) Abort("Table size out of range!\n");
+    if (fill < 1 || fill > 90) Abort("Fill percentage out of range!\n");
+    if (levels < 2) Abort("At least 2 levels required!\n");
+    if (rounds < 1) Abort("At least 1 round required!\n");
+
+    lace_start(workers, 1000000);
+
+    // Fixed table sizes, so the table is never resized
+    const size_t table_size = 1LL<<table_log;
+    sylvan_set_sizes(table_size, table_size, 1LL<<16, 1LL<<16);
+    sylvan_init_package();
+    sylvan_init_bdd();
+    sylvan_gc_disable();
+
+    make_layers(table_size / 100 * fill / levels);
+
+    // Collect the keys of all nodes in the table
+    keys = (uint64_t*)malloc(sizeof(uint64_t[2*table_size]));
+    key_count = 0;
+    for (size_t i=2; i<table_size; i++) {
+        if (!llmsset_is_marked(nodes, i)) continue;
+        uint64_t *d = (uint64_t*)llmsset_index_to_ptr(nodes, i);
+        keys[2*key_count] = d[0];
+        keys[2*key_count+1] = d[1];
+        key_count++;
+    }
+
+    const double load = (double)key_count / table_size;
+    INFO("Nodes: %'zu in a table of %'zu buckets (%.0f%% full), %d levels\n", key_count, table_size, 100*load, levels);
+    INFO("Expected cache occupancy for random hashes: %.2f%%\n", 100*(1-exp(-load)));
+
+    for (size_t i=0; i<sizeof(functions)/sizeof(functions[0]); i++) {
+        const hash_function_t *f = &functions[i];
+        if (!available(f)) {
+            INFO("%s: not available on this target\n", f->name);
+            continue;
+        }
+        const double t16 = time_loop(f->loop16);
+        const double t24 = time_loop(f->loop24);
+        size_t histogram[PROBE_CLASSES], max;
+        double mean;
+        simulate_probes(f, histogram, &mean, &max);
+        const double occupancy = simulate_cache(f);
+
+        INFO("%s\n", f->name);
+        INFO("  Throughput: nodes table %'.0f, cache %'.0f hashes/sec (best of %d rounds)\n",
+             key_count/t16, key_count/t24, rounds);
+        INFO("  Probe length: mean %.3f, max %zu\n", mean, max);
+        for (int c=0; c<PROBE_CLASSES; c++) {
+            if (histogram[c] == 0) continue;
+            INFO("    %-6s %'12zu (%.3f%%)\n", probe_class_name[c], histogram[c], 100.0*histogram[c]/key_count);
+        }
+        INFO("  Cache occupancy: %.2f%%\n", 100*occupancy);
+    }
+
+    free(keys);
+
+    sylvan_quit();
+    lace_stop();
+    return 0;
+}
@@ -1130,6 +1130,439 @@ TASK_IMPL_4(BDD, sylvan_relnext, BDD, a, BDD, b, BDDSET, vars, BDDVAR, prev_leve
     return result;
 }
 
+TASK_IMPL_5(BDD, sylvan_relnext_minus, BDD, a, BDD, b, BDDSET, vars, BDD, v, BDDVAR, prev_level)
+{
+    /* Compute R(s) \and \not V(s) with R(s) = \exists x: A(x) \and B(x,s) as in relnext
+     * Since the conjunction with \not V distributes over the disjunctions in relnext,
+     * V is cofactored along with the result and subresults in V are pruned early.
+     */
+
+    /* Terminals */
+    if (a == sylvan_false) return sylvan_false;
+    if (b == sylvan_false) return sylvan_false;
+    if (v == sylvan_true) return sylvan_false;
+    if (v == sylvan_false) return CALL(sylvan_relnext, a, b, vars, prev_level);
+    if (a == sylvan_true && b == sylvan_true) return sylvan_not(v);
+    if (sylvan_set_isempty(vars)) return CALL(sylvan_and, a, sylvan_not(v), prev_level);
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_RELNEXT_MINUS);
+
+    /* Determine top level */
+    bddnode_t na = sylvan_isconst(a) ? 0 : MTBDD_GETNODE(a);
+    bddnode_t nb = sylvan_isconst(b) ? 0 : MTBDD_GETNODE(b);
+    bddnode_t nv = MTBDD_GETNODE(v);
+
+    BDDVAR va = na ? bddnode_getvariable(na) : 0xffffffff;
+    BDDVAR vb = nb ? bddnode_getvariable(nb) : 0xffffffff;
+    BDDVAR vv = bddnode_getvariable(nv);
+    BDDVAR level = va < vb ? va : vb;
+    if (vv < level) level = vv;
+
+    /* Skip vars */
+    int is_s_or_t = 0;
+    bddnode_t nvars = 0;
+    if (vars == sylvan_false) {
+        is_s_or_t = 1;
+    } else {
+        nvars = MTBDD_GETNODE(vars);
+        for (;;) {
+            /* check if level is s/t */
+            BDDVAR vx = bddnode_getvariable(nvars);
+            if (level == vx || (level^1) == vx) {
+                is_s_or_t = 1;
+                break;
+            }
+            /* check if level < s/t */
+            if (level < vx) break;
+            vars = node_high(vars, nvars); // get next in vars
+            if (sylvan_set_isempty(vars)) return CALL(sylvan_and, a, sylvan_not(v), prev_level);
+            nvars = MTBDD_GETNODE(vars);
+        }
+    }
+
+    /* Consult cache */
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get4(CACHE_BDD_RELNEXT_MINUS, a, b, vars, v, &result)) {
+            sylvan_stats_count(BDD_RELNEXT_MINUS_CACHED);
+            return result;
+        }
+    }
+
+    BDD result;
+
+    if (is_s_or_t) {
+        /* Get s and t */
+        BDDVAR s = level & (~1);
+        BDDVAR t = s+1;
+
+        BDD a0, a1, b0, b1, v0, v1;
+        if (na && va == s) {
+            a0 = node_low(a, na);
+            a1 = node_high(a, na);
+        } else {
+            a0 = a1 = a;
+        }
+        if (nb && vb == s) {
+            b0 = node_low(b, nb);
+            b1 = node_high(b, nb);
+        } else {
+            b0 = b1 = b;
+        }
+        if (vv == s) {
+            v0 = node_low(v, nv);
+            v1 = node_high(v, nv);
+        } else {
+            assert(vv != t); // V must not depend on the primed variables
+            v0 = v1 = v;
+        }
+
+        BDD b00, b01, b10, b11;
+        if (!sylvan_isconst(b0)) {
+            bddnode_t nb0 = MTBDD_GETNODE(b0);
+            if (bddnode_getvariable(nb0) == t) {
+                b00 = node_low(b0, nb0);
+                b01 = node_high(b0, nb0);
+            } else {
+                b00 = b01 = b0;
+            }
+        } else {
+            b00 = b01 = b0;
+        }
+        if (!sylvan_isconst(b1)) {
+            bddnode_t nb1 = MTBDD_GETNODE(b1);
+            if (bddnode_getvariable(nb1) == t) {
+                b10 = node_low(b1, nb1);
+                b11 = node_high(b1, nb1);
+            } else {
+                b10 = b11 = b1;
+            }
+        } else {
+            b10 = b11 = b1;
+        }
+
+        BDD _vars = vars == sylvan_false ? sylvan_false : node_high(vars, nvars);
+
+        /* Successors with s=0 are pruned by v0, successors with s=1 by v1 */
+        bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b00, _vars, v0, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b10, _vars, v0, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b01, _vars, v1, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b11, _vars, v1, level));
+
+        BDD f = bdd_refs_sync(SYNC(sylvan_relnext_minus)); bdd_refs_push(f);
+        BDD e = bdd_refs_sync(SYNC(sylvan_relnext_minus)); bdd_refs_push(e);
+        BDD d = bdd_refs_sync(SYNC(sylvan_relnext_minus)); bdd_refs_push(d);
+        BDD c = bdd_refs_sync(SYNC(sylvan_relnext_minus)); bdd_refs_push(c);
+
+        bdd_refs_spawn(SPAWN(sylvan_ite, c, sylvan_true, d, 0)); /* a0 b00  \or  a1 b10 */
+        bdd_refs_spawn(SPAWN(sylvan_ite, e, sylvan_true, f, 0)); /* a0 b01  \or  a1 b11 */
+
+        /* R1 */ d = bdd_refs_sync(SYNC(sylvan_ite)); bdd_refs_push(d);
+        /* R0 */ c = bdd_refs_sync(SYNC(sylvan_ite)); // not necessary: bdd_refs_push(c);
+
+        bdd_refs_pop(5);
+        result = sylvan_makenode(s, c, d);
+    } else {
+        /* Variable not in vars! Take a, quantify b, cofactor v */
+        BDD a0, a1, b0, b1, v0, v1;
+        if (na && va == level) {
+            a0 = node_low(a, na);
+            a1 = node_high(a, na);
+        } else {
+            a0 = a1 = a;
+        }
+        if (nb && vb == level) {
+            b0 = node_low(b, nb);
+            b1 = node_high(b, nb);
+        } else {
+            b0 = b1 = b;
+        }
+        if (vv == level) {
+            v0 = node_low(v, nv);
+            v1 = node_high(v, nv);
+        } else {
+            v0 = v1 = v;
+        }
+
+        if (b0 != b1) {
+            if (a0 == a1 && v0 == v1) {
+                /* Quantify "b" variables */
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b0, vars, v0, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b1, vars, v1, level));
+
+                BDD r1 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r1);
+                BDD r0 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r0);
+                result = sylvan_or(r0, r1);
+                bdd_refs_pop(2);
+            } else {
+                /* Quantify "b" variables, but keep "a" and "v" variables */
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b0, vars, v0, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b1, vars, v0, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b0, vars, v1, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b1, vars, v1, level));
+
+                BDD r11 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r11);
+                BDD r10 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r10);
+                BDD r01 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r01);
+                BDD r00 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+                bdd_refs_push(r00);
+
+                bdd_refs_spawn(SPAWN(sylvan_ite, r00, sylvan_true, r01, 0));
+                bdd_refs_spawn(SPAWN(sylvan_ite, r10, sylvan_true, r11, 0));
+
+                BDD r1 = bdd_refs_sync(SYNC(sylvan_ite));
+                bdd_refs_push(r1);
+                BDD r0 = bdd_refs_sync(SYNC(sylvan_ite));
+                bdd_refs_pop(5);
+
+                result = sylvan_makenode(level, r0, r1);
+            }
+        } else {
+            /* Keep "a" and "v" variables */
+            bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a0, b0, vars, v0, level));
+            bdd_refs_spawn(SPAWN(sylvan_relnext_minus, a1, b1, vars, v1, level));
+
+            BDD r1 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+            bdd_refs_push(r1);
+            BDD r0 = bdd_refs_sync(SYNC(sylvan_relnext_minus));
+            bdd_refs_pop(1);
+            result = sylvan_makenode(level, r0, r1);
+        }
+    }
+
+    if (cachenow) {
+        if (cache_put4(CACHE_BDD_RELNEXT_MINUS, a, b, vars, v, result)) sylvan_stats_count(BDD_RELNEXT_MINUS_CACHEDPUT);
+    }
+
+    return result;
+}
+
+TASK_IMPL_5(BDD, sylvan_relnext_union, BDD, a, BDD, b, BDDSET, vars, BDD, u, BDDVAR, prev_level)
+{
+    /* Compute R(s) \or U(s) with R(s) = \exists x: A(x) \and B(x,s) as in relnext
+     * U is cofactored along with the result, and is added to one of the subresults
+     * on every level instead of in a separate pass afterwards.
+     */
+
+    /* Terminals */
+    if (u == sylvan_true) return sylvan_true;
+    if (a == sylvan_false || b == sylvan_false) return u;
+    if (u == sylvan_false) return CALL(sylvan_relnext, a, b, vars, prev_level);
+    if (a == sylvan_true && b == sylvan_true) return sylvan_true;
+    if (sylvan_set_isempty(vars)) return CALL(sylvan_ite, a, sylvan_true, u, prev_level);
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_RELNEXT_UNION);
+
+    /* Determine top level */
+    bddnode_t na = sylvan_isconst(a) ? 0 : MTBDD_GETNODE(a);
+    bddnode_t nb = sylvan_isconst(b) ? 0 : MTBDD_GETNODE(b);
+    bddnode_t nu = MTBDD_GETNODE(u);
+
+    BDDVAR va = na ? bddnode_getvariable(na) : 0xffffffff;
+    BDDVAR vb = nb ? bddnode_getvariable(nb) : 0xffffffff;
+    BDDVAR vu = bddnode_getvariable(nu);
+    BDDVAR level = va < vb ? va : vb;
+    if (vu < level) level = vu;
+
+    /* Skip vars */
+    int is_s_or_t = 0;
+    bddnode_t nvars = 0;
+    if (vars == sylvan_false) {
+        is_s_or_t = 1;
+    } else {
+        nvars = MTBDD_GETNODE(vars);
+        for (;;) {
+            /* check if level is s/t */
+            BDDVAR vx = bddnode_getvariable(nvars);
+            if (level == vx || (level^1) == vx) {
+                is_s_or_t = 1;
+                break;
+            }
+            /* check if level < s/t */
+            if (level < vx) break;
+            vars = node_high(vars, nvars); // get next in vars
+            if (sylvan_set_isempty(vars)) return CALL(sylvan_ite, a, sylvan_true, u, prev_level);
+            nvars = MTBDD_GETNODE(vars);
+        }
+    }
+
+    /* Consult cache */
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get4(CACHE_BDD_RELNEXT_UNION, a, b, vars, u, &result)) {
+            sylvan_stats_count(BDD_RELNEXT_UNION_CACHED);
+            return result;
+        }
+    }
+
+    BDD result;
+
+    if (is_s_or_t) {
+        /* Get s and t */
+        BDDVAR s = level & (~1);
+        BDDVAR t = s+1;
+
+        BDD a0, a1, b0, b1, u0, u1;
+        if (na && va == s) {
+            a0 = node_low(a, na);
+            a1 = node_high(a, na);
+        } else {
+            a0 = a1 = a;
+        }
+        if (nb && vb == s) {
+            b0 = node_low(b, nb);
+            b1 = node_high(b, nb);
+        } else {
+            b0 = b1 = b;
+        }
+        if (vu == s) {
+            u0 = node_low(u, nu);
+            u1 = node_high(u, nu);
+        } else {
+            assert(vu != t); // U must not depend on the primed variables
+            u0 = u1 = u;
+        }
+
+        BDD b00, b01, b10, b11;
+        if (!sylvan_isconst(b0)) {
+            bddnode_t nb0 = MTBDD_GETNODE(b0);
+            if (bddnode_getvariable(nb0) == t) {
+                b00 = node_low(b0, nb0);
+                b01 = node_high(b0, nb0);
+            } else {
+                b00 = b01 = b0;
+            }
+        } else {
+            b00 = b01 = b0;
+        }
+        if (!sylvan_isconst(b1)) {
+            bddnode_t nb1 = MTBDD_GETNODE(b1);
+            if (bddnode_getvariable(nb1) == t) {
+                b10 = node_low(b1, nb1);
+                b11 = node_high(b1, nb1);
+            } else {
+                b10 = b11 = b1;
+            }
+        } else {
+            b10 = b11 = b1;
+        }
+
+        BDD _vars = vars == sylvan_false ? sylvan_false : node_high(vars, nvars);
+
+        /* U0 is added to the successors with s=0, U1 to those with s=1 */
+        bdd_refs_spawn(SPAWN(sylvan_relnext_union, a0, b00, _vars, u0, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext, a1, b10, _vars, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_union, a0, b01, _vars, u1, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext, a1, b11, _vars, level));
+
+        BDD f = bdd_refs_sync(SYNC(sylvan_relnext)); bdd_refs_push(f);
+        BDD e = bdd_refs_sync(SYNC(sylvan_relnext_union)); bdd_refs_push(e);
+        BDD d = bdd_refs_sync(SYNC(sylvan_relnext)); bdd_refs_push(d);
+        BDD c = bdd_refs_sync(SYNC(sylvan_relnext_union)); bdd_refs_push(c);
+
+        bdd_refs_spawn(SPAWN(sylvan_ite, c, sylvan_true, d, 0)); /* a0 b00 u0  \or  a1 b10 */
+        bdd_refs_spawn(SPAWN(sylvan_ite, e, sylvan_true, f, 0)); /* a0 b01 u1  \or  a1 b11 */
+
+        /* R1 */ d = bdd_refs_sync(SYNC(sylvan_ite)); bdd_refs_push(d);
+        /* R0 */ c = bdd_refs_sync(SYNC(sylvan_ite)); // not necessary: bdd_refs_push(c);
+
+        bdd_refs_pop(5);
+        result = sylvan_makenode(s, c, d);
+    } else {
+        /* Variable not in vars! Take a, quantify b, cofactor u */
+        BDD a0, a1, b0, b1, u0, u1;
+        if (na && va == level) {
+            a0 = node_low(a, na);
+            a1 = node_high(a, na);
+        } else {
+            a0 = a1 = a;
+        }
+        if (nb && vb == level) {
+            b0 = node_low(b, nb);
+            b1 = node_high(b, nb);
+        } else {
+            b0 = b1 = b;
+        }
+        if (vu == level) {
+            u0 = node_low(u, nu);
+            u1 = node_high(u, nu);
+        } else {
+            u0 = u1 = u;
+        }
+
+        if (b0 != b1) {
+            if (a0 == a1 && u0 == u1) {
+                /* Quantify "b" variables */
+                bdd_refs_spawn(SPAWN(sylvan_relnext_union, a0, b0, vars, u0, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext, a1, b1, vars, level));
+
+                BDD r1 = bdd_refs_sync(SYNC(sylvan_relnext));
+                bdd_refs_push(r1);
+                BDD r0 = bdd_refs_sync(SYNC(sylvan_relnext_union));
+                bdd_refs_push(r0);
+                result = sylvan_or(r0, r1);
+                bdd_refs_pop(2);
+            } else {
+                /* Quantify "b" variables, but keep "a" and "u" variables */
+                bdd_refs_spawn(SPAWN(sylvan_relnext_union, a0, b0, vars, u0, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext, a0, b1, vars, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext_union, a1, b0, vars, u1, level));
+                bdd_refs_spawn(SPAWN(sylvan_relnext, a1, b1, vars, level));
+
+                BDD r11 = bdd_refs_sync(SYNC(sylvan_relnext));
+                bdd_refs_push(r11);
+                BDD r10 = bdd_refs_sync(SYNC(sylvan_relnext_union));
+                bdd_refs_push(r10);
+                BDD r01 = bdd_refs_sync(SYNC(sylvan_relnext));
+                bdd_refs_push(r01);
+                BDD r00 = bdd_refs_sync(SYNC(sylvan_relnext_union));
+                bdd_refs_push(r00);
+
+                bdd_refs_spawn(SPAWN(sylvan_ite, r00, sylvan_true, r01, 0));
+                bdd_refs_spawn(SPAWN(sylvan_ite, r10, sylvan_true, r11, 0));
+
+                BDD r1 = bdd_refs_sync(SYNC(sylvan_ite));
+                bdd_refs_push(r1);
+                BDD r0 = bdd_refs_sync(SYNC(sylvan_ite));
+                bdd_refs_pop(5);
+
+                result = sylvan_makenode(level, r0, r1);
+            }
+        } else {
+            /* Keep "a" and "u" variables */
+            bdd_refs_spawn(SPAWN(sylvan_relnext_union, a0, b0, vars, u0, level));
+            bdd_refs_spawn(SPAWN(sylvan_relnext_union, a1, b1, vars, u1, level));
+
+            BDD r1 = bdd_refs_sync(SYNC(sylvan_relnext_union));
+            bdd_refs_push(r1);
+            BDD r0 = bdd_refs_sync(SYNC(sylvan_relnext_union));
+            bdd_refs_pop(1);
+            result = sylvan_makenode(level, r0, r1);
+        }
+    }
+
+    if (cachenow) {
+        if (cache_put4(CACHE_BDD_RELNEXT_UNION, a, b, vars, u, result)) sylvan_stats_count(BDD_RELNEXT_UNION_CACHEDPUT);
+    }
+
+    return result;
+}
+
 TASK_IMPL_4(BDD, sylvan_relprev, BDD, a, BDD, b, BDDSET, vars, BDDVAR, prev_level)
 {
     /* Compute \exists x: A(s,x) \and B(x,t)
@@ -139,6 +139,28 @@ TASK_DECL_4(BDD, sylvan_relprev, BDD, BDD, BDDSET, BDDVAR);
 TASK_DECL_4(BDD, sylvan_relnext, BDD, BDD, BDDSET, BDDVAR);
 #define sylvan_relnext(a,b,vars) RUN(sylvan_relnext,a,b,vars,0)
 
+/**
+ * Compute R(s) \and \not V(s), with R(s) the result of relnext(A, B, vars).
+ * Parameter V is a set of states (e.g. the visited states) that must not
+ * depend on the t variables. States in V are pruned during the recursion,
+ * instead of first computing all successors and then subtracting V.
+ *
+ * Use this function to take the 'new next' of a set S  --> \ V
+ */
+TASK_DECL_5(BDD, sylvan_relnext_minus, BDD, BDD, BDDSET, BDD, BDDVAR);
+#define sylvan_relnext_minus(a,b,vars,v) RUN(sylvan_relnext_minus,a,b,vars,v,0)
+
+/**
+ * Compute R(s) \or U(s), with R(s) the result of relnext(A, B, vars).
+ * Parameter U is a set of states that must not depend on the t variables.
+ * U is merged into the result during the recursion, instead of taking the
+ * union with all successors afterwards.
+ *
+ * Use this function to extend a set S with its successors: relnext_union(S, R, vars, S)
+ */
+TASK_DECL_5(BDD, sylvan_relnext_union, BDD, BDD, BDDSET, BDD, BDDVAR);
+#define sylvan_relnext_union(a,b,vars,u) RUN(sylvan_relnext_union,a,b,vars,u,0)
+
 /**
  * Computes the transitive closure by traversing the BDD recursively.
  * See Y. Matsunaga, P. C. McGeer, R. K. Brayton
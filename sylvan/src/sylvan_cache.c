@@ -18,6 +18,7 @@
 #include <sylvan_int.h>
 
 #include <errno.h>  // for errno
+#include <inttypes.h> // for PRIu64
 #include <string.h> // for strerror
 #include <sys/mman.h> // for mmap
 
@@ -37,12 +38,44 @@
 #define cas(ptr, old, new) (__sync_bool_compare_and_swap((ptr),(old),(new)))
 #endif
 
+#ifndef SYLVAN_CACHE_COMPACT
+#define SYLVAN_CACHE_COMPACT 0
+#endif
+
+/* Per-worker L1 cache of 2^SYLVAN_CACHE_L1 entries, 0 to disable */
+#ifndef SYLVAN_CACHE_L1
+#define SYLVAN_CACHE_L1 0
+#endif
+
 /**
  * This cache is designed to store a,b,c->res, with a,b,c,res 64-bit integers.
  *
  * Each cache bucket takes 32 bytes, 2 per cache line.
  * Each cache status bucket takes 4 bytes, 16 per cache line.
  * Therefore, size 2^N = 36*(2^N) bytes.
+ *
+ * With SYLVAN_CACHE_COMPACT, each cache bucket takes 16 bytes (4 per cache
+ * line) and stores a,b,c,res as 32-bit values. This works for entries where
+ * a is an operation id plus a node index below 2^31 and b,c,res are values
+ * below 2^31, where each may have the complement mark (bit 63) set. This is
+ * the common case for models with fewer than 2^31 nodes. Other entries take
+ * two consecutive buckets, like the entries of cache_put6 in normal mode.
+ * Then size 2^N = 20*(2^N) bytes.
+ *
+ * With SYLVAN_CACHE_L1 set to N > 0, every thread has a small direct-mapped
+ * L1 cache of 2^N entries of 32 bytes (N=10 gives 32 KB) in front of this
+ * shared cache, which requires no status fields or locking. cache_get consults
+ * the L1 cache first and copies hits in the shared cache to it; cache_put
+ * writes to both. This saves traffic on the shared cache lines when many
+ * workers share the cache, but costs a few percent with a single worker.
+ *
+ * Entries of expensive operations can be put with priority, either with
+ * cache_put_prio or for all entries of an operation id (cache_set_priority).
+ * An ordinary put does not evict a priority entry, but clears its priority
+ * bit, so the next ordinary put to that bucket does evict it. This protects
+ * expensive results against the first of a stream of cheap results, without
+ * letting old priority entries occupy buckets forever. Priority puts evict
+ * anything, and cache_put6 ignores priorities.
  */
 
 struct __attribute__((packed)) cache6_entry {
@@ -57,12 +90,30 @@ struct __attribute__((packed)) cache6_entry {
 };
 typedef struct cache6_entry *cache6_entry_t;
 
+#if SYLVAN_CACHE_COMPACT
 struct __attribute__((packed)) cache_entry {
+    uint32_t            a;
+    uint32_t            b;
+    uint32_t            c;
+    uint32_t            res;
+};
+
+/* An entry with 64-bit values, stored in two consecutive buckets */
+struct __attribute__((packed)) cache_wide_entry {
     uint64_t            a;
     uint64_t            b;
     uint64_t            c;
     uint64_t            res;
 };
+typedef struct cache_wide_entry *cache_wide_entry_t;
+#else
+struct __attribute__((packed)) cache_entry {
+    uint64_t            a;
+    uint64_t            b;
+    uint64_t            c;
+    uint64_t            res;
+};
+#endif
 
 static size_t             cache_size;         // power of 2
 static size_t             cache_max;          // power of 2
@@ -74,6 +125,20 @@ static uint32_t*          cache_status;
 
 static uint64_t           next_opid;
 
+/* Increased whenever the shared cache is cleared, which invalidates all L1 caches */
+static volatile uint64_t  cache_epoch;
+
+/* Operation ids (below CACHE_PRIO_OPS) whose entries are put with priority */
+#define CACHE_PRIO_OPS 1024
+static uint64_t           cache_prio_ops[CACHE_PRIO_OPS/64];
+
+static inline int
+cache_op_priority(uint64_t a)
+{
+    const uint64_t op = (a >> 40) & 0x7fffff;
+    return op < CACHE_PRIO_OPS && ((cache_prio_ops[op/64] >> (op%64)) & 1);
+}
+
 uint64_t
 cache_next_opid()
 {
@@ -82,36 +147,260 @@ cache_next_opid()
 
 // status: 0x80000000 - bitlock
 //         0x7fff0000 - hash (part of the 64-bit hash not used to position)
-//         0x0000ffff - tag (every put increases tag field)
+//         0x00008000 - priority (see cache_put_prio)
+//         0x00007fff - tag (every put increases tag field)
 
-/* Rotating 64-bit FNV-1a hash */
-static uint64_t
+/* Hash of the operation cache, see SYLVAN_HASH in sylvan_hash.h (default: rotating 64-bit FNV-1a) */
+static inline uint64_t
 cache_hash(uint64_t a, uint64_t b, uint64_t c)
 {
-    const uint64_t prime = 1099511628211;
-    uint64_t hash = 14695981039346656037LLU;
-    hash = (hash ^ (a>>32));
-    hash = (hash ^ a) * prime;
-    hash = (hash ^ b) * prime;
-    hash = (hash ^ c) * prime;
-    return hash;
+    return sylvan_hash24(a, b, c, 14695981039346656037LLU);
 }
 
-static uint64_t
+static inline uint64_t
 cache_hash6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f)
 {
+#if SYLVAN_HASH == SYLVAN_HASH_DEFAULT || SYLVAN_HASH == SYLVAN_HASH_FNV
+    /* FNV-1a continued over d, e, f (the cache hash of the default build) */
     const uint64_t prime = 1099511628211;
-    uint64_t hash = 14695981039346656037LLU;
-    hash = (hash ^ (a>>32));
-    hash = (hash ^ a) * prime;
-    hash = (hash ^ b) * prime;
-    hash = (hash ^ c) * prime;
+    uint64_t hash = cache_hash(a, b, c);
     hash = (hash ^ d) * prime;
     hash = (hash ^ e) * prime;
     hash = (hash ^ f) * prime;
     return hash;
+#else
+    return sylvan_hash24(d, e, f, cache_hash(a, b, c));
+#endif
+}
+
+#if SYLVAN_CACHE_COMPACT
+
+// status: 0x80000000 - bitlock
+//         0x40000000 - part of a multi-bucket entry
+//         0x20000000 - (multi-bucket) entry of cache_put6, which takes 4 buckets
+//         0x3fff0000 - (single bucket) operation id + 1
+//         0x1fff0000 - (multi-bucket) hash (part of the 64-bit hash not used to position)
+//         0x00008000 - priority (see cache_put_prio)
+//         0x00007fff - tag (every put increases tag field)
+
+static inline size_t
+cache_index(uint64_t hash)
+{
+#if CACHE_MASK
+    return hash & cache_mask;
+#else
+    return hash % cache_size;
+#endif
+}
+
+/**
+ * Narrow a 64-bit value to 32 bits, keeping the complement mark in bit 31.
+ * Returns 0 if the value does not fit.
+ */
+static inline int
+cache_narrow(uint64_t value, uint32_t *res)
+{
+    if (value & 0x7fffffff80000000LL) return 0;
+    *res = (uint32_t)(value & 0x7fffffff) | (uint32_t)((value >> 32) & 0x80000000);
+    return 1;
+}
+
+static inline uint64_t
+cache_widen(uint32_t value)
+{
+    return (uint64_t)(value & 0x7fffffff) | ((uint64_t)(value & 0x80000000) << 32);
+}
+
+/**
+ * Split a into the operation id (+1, so it is never 0) and the narrowed node index.
+ * Returns 0 if a does not fit in a single bucket.
+ */
+static inline int
+cache_narrow_a(uint64_t a, uint32_t *op, uint32_t *dd)
+{
+    uint64_t opid = (a >> 40) & 0x7fffff;
+    if (opid >= 0x3fff) return 0;
+    *op = (uint32_t)(opid + 1) << 16;
+    return cache_narrow(a & 0x800000ffffffffffLL, dd);
 }
 
+int
+cache_get6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t *res1, uint64_t *res2)
+{
+    const uint64_t hash = cache_hash6(a, b, c, d, e, f);
+    const size_t index = cache_index(hash) & ~(size_t)3;
+    volatile uint64_t *s_bucket = (uint64_t*)(cache_status + index);
+    cache6_entry_t bucket = (cache6_entry_t)(cache_table + index);
+    const uint64_t s1 = s_bucket[0];
+    const uint64_t s2 = s_bucket[1];
+    compiler_barrier();
+    // abort if locked or not a 4-part entry or if different hash
+    uint64_t x = ((hash>>32) & 0x1fff0000) | 0x60000000;
+    x = x | (x<<32);
+    if ((s1 & 0xffff0000ffff0000) != x) return 0;
+    if ((s2 & 0xffff0000ffff0000) != x) return 0;
+    // abort if key different
+    if (bucket->a != a || bucket->b != b || bucket->c != c) return 0;
+    if (bucket->d != d || bucket->e != e || bucket->f != f) return 0;
+    *res1 = bucket->res;
+    if (res2) *res2 = bucket->res2;
+    compiler_barrier();
+    // abort if status fields changed after compiler_barrier()
+    return (s_bucket[0] == s1 && s_bucket[1] == s2) ? 1 : 0;
+}
+
+int
+cache_put6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t res1, uint64_t res2)
+{
+    const uint64_t hash = cache_hash6(a, b, c, d, e, f);
+    const size_t index = cache_index(hash) & ~(size_t)3;
+    volatile uint64_t *s_bucket = (uint64_t*)(cache_status + index);
+    cache6_entry_t bucket = (cache6_entry_t)(cache_table + index);
+    const uint64_t s1 = s_bucket[0];
+    const uint64_t s2 = s_bucket[1];
+    // abort if locked
+    if ((s1 | s2) & 0x8000000080000000LL) return 0;
+    // create new
+    uint64_t x = ((hash>>32) & 0x1fff0000) | 0x60000000;
+    x |= (x<<32);
+    const uint64_t new_s1 = x | ((((s1>>32)+1)&0x7fff)<<32) | ((s1+1)&0x7fff);
+    const uint64_t new_s2 = x | ((((s2>>32)+1)&0x7fff)<<32) | ((s2+1)&0x7fff);
+    // use cas to claim all four buckets
+    if (!cas(&s_bucket[0], s1, new_s1 | 0x8000000080000000LL)) return 0;
+    if (!cas(&s_bucket[1], s2, new_s2 | 0x8000000080000000LL)) {
+        // nothing was written yet, so simply restore the first status
+        s_bucket[0] = s1;
+        return 0;
+    }
+    // cas succesful: write data
+    bucket->a = a;
+    bucket->b = b;
+    bucket->c = c;
+    bucket->d = d;
+    bucket->e = e;
+    bucket->f = f;
+    bucket->res = res1;
+    bucket->res2 = res2;
+    compiler_barrier();
+    // after compiler_barrier(), unlock status fields
+    s_bucket[1] = new_s2;
+    s_bucket[0] = new_s1;
+    return 1;
+}
+
+static int
+cache_get_wide(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
+{
+    const size_t index = cache_index(hash) & ~(size_t)1;
+    volatile uint64_t *s_bucket = (uint64_t*)(cache_status + index);
+    cache_wide_entry_t bucket = (cache_wide_entry_t)(cache_table + index);
+    const uint64_t s = *s_bucket;
+    compiler_barrier();
+    // abort if locked or not a 2-part entry or if different hash
+    uint64_t x = ((hash>>32) & 0x1fff0000) | 0x40000000;
+    x = x | (x<<32);
+    if ((s & 0xffff0000ffff0000) != x) return 0;
+    // abort if key different
+    if (bucket->a != a || bucket->b != b || bucket->c != c) return 0;
+    *res = bucket->res;
+    compiler_barrier();
+    // abort if status field changed after compiler_barrier()
+    return *s_bucket == s ? 1 : 0;
+}
+
+static int
+cache_put_wide(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio)
+{
+    const size_t index = cache_index(hash) & ~(size_t)1;
+    volatile uint64_t *s_bucket = (uint64_t*)(cache_status + index);
+    cache_wide_entry_t bucket = (cache_wide_entry_t)(cache_table + index);
+    const uint64_t s = *s_bucket;
+    // abort if locked
+    if (s & 0x8000000080000000LL) return 0;
+    // do not evict a priority entry, but take away its priority
+    if (!prio && (s & 0x0000800000008000LL)) {
+        cas(s_bucket, s, s & ~0x0000800000008000LL);
+        return 0;
+    }
+    // create new
+    uint64_t new_s = ((hash>>32) & 0x1fff0000) | 0x40000000;
+    if (prio) new_s |= 0x00008000;
+    new_s |= (new_s<<32);
+    new_s |= (((s>>32)+1)&0x7fff)<<32;
+    new_s |= (s+1)&0x7fff;
+    // use cas to claim bucket
+    if (!cas(s_bucket, s, new_s | 0x8000000080000000LL)) return 0;
+    // cas succesful: write data
+    bucket->a = a;
+    bucket->b = b;
+    bucket->c = c;
+    bucket->res = res;
+    compiler_barrier();
+    // after compiler_barrier(), unlock status field
+    *s_bucket = new_s;
+    return 1;
+}
+
+static inline int
+cache_l2_get(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
+{
+    uint32_t op, a32, b32, c32;
+    if (!cache_narrow_a(a, &op, &a32) || !cache_narrow(b, &b32) || !cache_narrow(c, &c32)) {
+        return cache_get_wide(hash, a, b, c, res);
+    }
+    const size_t index = cache_index(hash);
+    volatile uint32_t *s_bucket = cache_status + index;
+    cache_entry_t bucket = cache_table + index;
+    const uint32_t s = *s_bucket;
+    compiler_barrier();
+    // the result may not have fit in a single bucket
+    if ((s & 0xe0000000) == 0x40000000) return cache_get_wide(hash, a, b, c, res);
+    // abort if locked or if part of a multi-bucket entry
+    if (s & 0xc0000000) return 0;
+    // abort if different operation
+    if ((s & 0x3fff0000) != op) return 0;
+    // abort if key different
+    if (bucket->a != a32 || bucket->b != b32 || bucket->c != c32) return 0;
+    *res = cache_widen(bucket->res);
+    compiler_barrier();
+    // abort if status field changed after compiler_barrier()
+    return *s_bucket == s ? 1 : 0;
+}
+
+static inline int
+cache_l2_put(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio)
+{
+    uint32_t op, a32, b32, c32, res32;
+    if (!cache_narrow_a(a, &op, &a32) || !cache_narrow(b, &b32) || !cache_narrow(c, &c32) || !cache_narrow(res, &res32)) {
+        return cache_put_wide(hash, a, b, c, res, prio);
+    }
+    const size_t index = cache_index(hash);
+    volatile uint32_t *s_bucket = cache_status + index;
+    cache_entry_t bucket = cache_table + index;
+    const uint32_t s = *s_bucket;
+    // abort if locked
+    if (s & 0x80000000) return 0;
+    // do not evict a priority entry, but take away its priority
+    if (!prio && (s & 0x00008000)) {
+        cas(s_bucket, s, s & ~0x00008000);
+        return 0;
+    }
+    // use cas to claim bucket
+    const uint32_t new_s = ((s+1) & 0x00007fff) | op | (prio ? 0x00008000 : 0);
+    if (!cas(s_bucket, s, new_s | 0x80000000)) return 0;
+    // cas succesful: write data
+    bucket->a = a32;
+    bucket->b = b32;
+    bucket->c = c32;
+    bucket->res = res32;
+    compiler_barrier();
+    // after compiler_barrier(), unlock status field
+    *s_bucket = new_s;
+    return 1;
+}
+
+#else
+
 int
 cache_get6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t *res1, uint64_t *res2)
 {
@@ -156,8 +445,8 @@ cache_put6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t
     // create new
     uint64_t new_s = ((hash>>32) & 0x7fff0000) | 0x04000000;
     new_s |= (new_s<<32);
-    new_s |= (((s>>32)+1)&0xffff)<<32;
-    new_s |= (s+1)&0xffff;
+    new_s |= (((s>>32)+1)&0x7fff)<<32;
+    new_s |= (s+1)&0x7fff;
     // use cas to claim bucket
     if (!cas(s_bucket, s, new_s | 0x8000000080000000LL)) return 0;
     // cas succesful: write data
@@ -175,10 +464,9 @@ cache_put6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t
     return 1;
 }
 
-int
-cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
+static inline int
+cache_l2_get(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
 {
-    const uint64_t hash = cache_hash(a, b, c);
 #if CACHE_MASK
     volatile uint32_t *s_bucket = cache_status + (hash & cache_mask);
     cache_entry_t bucket = cache_table + (hash & cache_mask);
@@ -200,10 +488,9 @@ cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
     return *s_bucket == s ? 1 : 0;
 }
 
-int
-cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res)
+static inline int
+cache_l2_put(uint64_t hash, uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio)
 {
-    const uint64_t hash = cache_hash(a, b, c);
 #if CACHE_MASK
     volatile uint32_t *s_bucket = cache_status + (hash & cache_mask);
     cache_entry_t bucket = cache_table + (hash & cache_mask);
@@ -214,11 +501,16 @@ cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res)
     const uint32_t s = *s_bucket;
     // abort if locked
     if (s & 0x80000000) return 0;
+    // do not evict a priority entry, but take away its priority
+    if (!prio && (s & 0x00008000)) {
+        cas(s_bucket, s, s & ~0x00008000);
+        return 0;
+    }
     // abort if hash identical -> no: in iscasmc this occasionally causes timeouts?!
     const uint32_t hash_mask = (hash>>32) & 0x3fff0000;
     // if ((s & 0x7fff0000) == hash_mask) return 0;
     // use cas to claim bucket
-    const uint32_t new_s = ((s+1) & 0x0000ffff) | hash_mask;
+    const uint32_t new_s = ((s+1) & 0x00007fff) | hash_mask | (prio ? 0x00008000 : 0);
     if (!cas(s_bucket, s, new_s | 0x80000000)) return 0;
     // cas succesful: write data
     bucket->a = a;
@@ -231,6 +523,124 @@ cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res)
     return 1;
 }
 
+#endif
+
+#if SYLVAN_CACHE_L1
+
+struct cache_l1 {
+    uint64_t            epoch;
+    struct {
+        uint64_t        a;
+        uint64_t        b;
+        uint64_t        c;
+        uint64_t        res;
+    } table[1LL<<SYLVAN_CACHE_L1];
+};
+
+DECLARE_THREAD_LOCAL(cache_l1, struct cache_l1*);
+
+/**
+ * Obtain the L1 cache of this thread, allocating it on first use and wiping it
+ * if the shared cache was cleared since the last use. Wiped entries have
+ * a = -1, which is never stored (see cache_put).
+ */
+static struct cache_l1*
+cache_l1_local(void)
+{
+    LOCALIZE_THREAD_LOCAL(cache_l1, struct cache_l1*);
+    if (__builtin_expect(cache_l1 == NULL, 0)) {
+        cache_l1 = (struct cache_l1*)malloc(sizeof(struct cache_l1));
+        if (cache_l1 == NULL) {
+            fprintf(stderr, "cache_l1: Unable to allocate memory!\n");
+            exit(1);
+        }
+        cache_l1->epoch = cache_epoch - 1;
+        SET_THREAD_LOCAL(cache_l1, cache_l1);
+    }
+    if (__builtin_expect(cache_l1->epoch != cache_epoch, 0)) {
+        memset(cache_l1->table, 0xff, sizeof(cache_l1->table));
+        cache_l1->epoch = cache_epoch;
+    }
+    return cache_l1;
+}
+
+int
+cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
+{
+    const uint64_t hash = cache_hash(a, b, c);
+    struct cache_l1 *l1 = cache_l1_local();
+    const size_t index = hash & ((1LL<<SYLVAN_CACHE_L1)-1);
+    if (l1->table[index].a == a && l1->table[index].b == b && l1->table[index].c == c && a != (uint64_t)-1) {
+        *res = l1->table[index].res;
+        sylvan_stats_cache(a, CACHE_L1_HIT);
+        return 1;
+    }
+    if (cache_l2_get(hash, a, b, c, res)) {
+        l1->table[index].a = a;
+        l1->table[index].b = b;
+        l1->table[index].c = c;
+        l1->table[index].res = *res;
+        sylvan_stats_cache(a, CACHE_L2_HIT);
+        return 1;
+    }
+    sylvan_stats_cache(a, CACHE_MISS);
+    return 0;
+}
+
+int
+cache_put_prio(uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio)
+{
+    const uint64_t hash = cache_hash(a, b, c);
+    if (a != (uint64_t)-1) {
+        struct cache_l1 *l1 = cache_l1_local();
+        const size_t index = hash & ((1LL<<SYLVAN_CACHE_L1)-1);
+        l1->table[index].a = a;
+        l1->table[index].b = b;
+        l1->table[index].c = c;
+        l1->table[index].res = res;
+    }
+    return cache_l2_put(hash, a, b, c, res, prio || cache_op_priority(a));
+}
+
+#else
+
+int
+cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
+{
+    if (cache_l2_get(cache_hash(a, b, c), a, b, c, res)) {
+        sylvan_stats_cache(a, CACHE_L2_HIT);
+        return 1;
+    }
+    sylvan_stats_cache(a, CACHE_MISS);
+    return 0;
+}
+
+int
+cache_put_prio(uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio)
+{
+    return cache_l2_put(cache_hash(a, b, c), a, b, c, res, prio || cache_op_priority(a));
+}
+
+#endif
+
+int
+cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res)
+{
+    return cache_put_prio(a, b, c, res, 0);
+}
+
+void
+cache_set_priority(uint64_t opid, int prio)
+{
+    const uint64_t op = (opid >> 40) & 0x7fffff;
+    if (op >= CACHE_PRIO_OPS) {
+        fprintf(stderr, "cache_set_priority: operation id %" PRIu64 " out of range!\n", op);
+        exit(1);
+    }
+    if (prio) __sync_fetch_and_or(&cache_prio_ops[op/64], 1LL<<(op%64));
+    else __sync_fetch_and_and(&cache_prio_ops[op/64], ~(1LL<<(op%64)));
+}
+
 void
 cache_create(size_t _cache_size, size_t _max_size)
 {
@@ -262,6 +672,15 @@ cache_create(size_t _cache_size, size_t _max_size)
     }
 
     next_opid = 512LL << 40;
+
+#if SYLVAN_CACHE_L1
+    static int l1_key_created = 0;
+    if (!l1_key_created) {
+        INIT_THREAD_LOCAL(cache_l1);
+        l1_key_created = 1;
+    }
+#endif
+    cache_epoch++;
 }
 
 void
@@ -300,11 +719,22 @@ cache_getused()
     for (size_t i=0;i<cache_size;i++) {
         uint32_t s = cache_status[i];
         if (s & 0x80000000) fprintf(stderr, "cache_getuser: cache in use during cache_getused()\n");
+#if SYLVAN_CACHE_COMPACT
+        // count multi-bucket entries only once
+        if ((s & 0x60000000) == 0x60000000 && (i & 3) != 0) continue;
+        if ((s & 0x60000000) == 0x40000000 && (i & 1) != 0) continue;
+#endif
         if (s) result++;
     }
     return result;
 }
 
+size_t
+cache_getbucketsize()
+{
+    return sizeof(struct cache_entry) + sizeof(uint32_t);
+}
+
 size_t
 cache_getmaxsize()
 {
@@ -37,6 +37,8 @@ extern "C" {
  * - cache_get4/cache_put4 for any operation with 4 BDDs
  *   int success = cache_get4(opid, dd1, dd2, dd3, dd4, &result);
  *   int success = cache_get4(opid, dd1, dd2, dd3, dd4, result);
+ * - cache_put3_prio for results that are expensive to recompute, or
+ *   cache_set_priority(opid, 1) to protect all results of an operation
  *
  * Notes:
  * - The "result" is any 64-bit value
@@ -51,6 +53,20 @@ typedef struct cache_entry *cache_entry_t;
 int cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res);
 int cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res);
 
+/**
+ * Put with priority if prio is nonzero, for results that are expensive to
+ * recompute. An ordinary put does not evict a priority entry, but removes its
+ * priority, so it survives one conflicting put. cache_put uses the priority
+ * of the operation id (see cache_set_priority).
+ */
+int cache_put_prio(uint64_t a, uint64_t b, uint64_t c, uint64_t res, int prio);
+
+/**
+ * Set whether all entries of operation id <opid> are put with priority.
+ * Only operation ids below 1024<<40 can have priority.
+ */
+void cache_set_priority(uint64_t opid, int prio);
+
 /**
  * Primitives for cache get/put that use two buckets
  */
@@ -93,6 +109,16 @@ cache_put3(uint64_t opid, uint64_t dd, uint64_t d2, uint64_t d3, uint64_t res)
     return cache_put(dd | opid, d2, d3, res);
 }
 
+/**
+ * Like cache_put3, with a priority hint (e.g. nonzero for results of deep or
+ * large computations), see cache_put_prio
+ */
+static inline int __attribute__((unused))
+cache_put3_prio(uint64_t opid, uint64_t dd, uint64_t d2, uint64_t d3, uint64_t res, int prio)
+{
+    return cache_put_prio(dd | opid, d2, d3, res, prio);
+}
+
 /**
  * dd/dd2/dd3/dd4 must be MTBDDs
  */
@@ -123,6 +149,12 @@ size_t cache_getsize(void);
 
 size_t cache_getmaxsize(void);
 
+/**
+ * Number of bytes per cache bucket (including its status), which depends on
+ * whether Sylvan was compiled with SYLVAN_CACHE_COMPACT.
+ */
+size_t cache_getbucketsize(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
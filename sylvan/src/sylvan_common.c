@@ -100,6 +100,65 @@ sylvan_gc_hook_main(gc_hook_cb callback)
     main_hook = callback;
 }
 
+/**
+ * Compaction callbacks, with the marking callback whose roots they rewrite
+ */
+typedef struct gc_compact_entry
+{
+    struct gc_compact_entry *next;
+    gc_hook_cb mark_cb;
+    gc_hook_cb cb;
+} * gc_compact_entry_t;
+
+static gc_compact_entry_t compact_list;
+
+void
+sylvan_gc_add_compact(gc_hook_cb mark_cb, gc_hook_cb compact_cb)
+{
+    // append, so the callbacks are called in the order they are added
+    gc_compact_entry_t e = (gc_compact_entry_t)malloc(sizeof(struct gc_compact_entry));
+    e->mark_cb = mark_cb;
+    e->cb = compact_cb;
+    e->next = NULL;
+    gc_compact_entry_t *tail = &compact_list;
+    while (*tail != NULL) tail = &(*tail)->next;
+    *tail = e;
+}
+
+/**
+ * Compaction is only possible if all roots can be rewritten
+ */
+static int
+gc_can_compact(void)
+{
+    for (gc_hook_entry_t m = mark_list; m != NULL; m = m->next) {
+        gc_compact_entry_t e = compact_list;
+        while (e != NULL && e->mark_cb != m->cb) e = e->next;
+        if (e == NULL) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Renumber all marked nodes using the compaction callbacks.
+ */
+VOID_TASK_0(sylvan_compact_nodes)
+{
+    CALL(llmsset_compact_begin, nodes);
+
+    for (gc_compact_entry_t e = compact_list; e != NULL; e = e->next) {
+        // a callback added for several marking callbacks is only called once
+        gc_compact_entry_t f = compact_list;
+        while (f->cb != e->cb) f = f->next;
+        if (f == e) WRAP(e->cb);
+    }
+
+    if (CALL(llmsset_compact_end, nodes) != 0) {
+        fprintf(stderr, "sylvan_gc_compact error: not all marked nodes were renumbered!\n");
+        exit(1);
+    }
+}
+
 /**
  * Clear the operation cache.
  */
@@ -213,6 +272,33 @@ VOID_TASK_IMPL_0(sylvan_gc_normal_resize)
     }
 }
 
+/**
+ * Record of the most recent garbage collection, and the trigger of the next one
+ */
+static sylvan_gc_info_t gc_info;
+static int gc_trigger;
+static int gc_count_nodes = 0;
+
+static double
+gc_clock(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+const sylvan_gc_info_t*
+sylvan_gc_last_info(void)
+{
+    return &gc_info;
+}
+
+void
+sylvan_gc_count_nodes(int enabled)
+{
+    gc_count_nodes = enabled;
+}
+
 /**
  * Actual implementation of garbage collection
  */
@@ -221,24 +307,66 @@ VOID_TASK_0(sylvan_gc_go)
     sylvan_stats_count(SYLVAN_GC_COUNT);
     sylvan_timer_start(SYLVAN_GC);
 
+    sylvan_gc_info_t info;
+    info.number = gc_info.number + 1;
+    info.trigger = gc_trigger;
+    info.timestamp = gc_clock(CLOCK_REALTIME);
+    double t_start = gc_clock(CLOCK_MONOTONIC);
+
     // call pre gc hooks
     for (gc_hook_entry_t e = pregc_list; e != NULL; e = e->next) {
         WRAP(e->cb);
     }
 
+    // counting the nodes scans the table, which is not part of the pause time
+    double count_time = 0;
+    double t = gc_clock(CLOCK_MONOTONIC);
+    info.nodes_before = gc_count_nodes ? CALL(llmsset_count_marked, nodes) : 0;
+    info.table_before = llmsset_get_size(nodes);
+    double t_next = gc_clock(CLOCK_MONOTONIC);
+    count_time += t_next - t;
+    t = t_next;
+
     /*
      * This simply clears the cache.
      * Alternatively, we could implement for example some strategy
      * where part of the cache is cleared and part is marked
      */
     CALL(sylvan_clear_cache);
+    t_next = gc_clock(CLOCK_MONOTONIC);
+    info.clear_cache_time = t_next - t;
+    t = t_next;
 
     CALL(sylvan_clear_and_mark);
+    t_next = gc_clock(CLOCK_MONOTONIC);
+    info.mark_time = t_next - t;
+    t = t_next;
+
+    info.compact_time = 0;
+    if (info.trigger == SYLVAN_GC_COMPACT) {
+        CALL(sylvan_compact_nodes);
+        t_next = gc_clock(CLOCK_MONOTONIC);
+        info.compact_time = t_next - t;
+        t = t_next;
+    }
 
     // call hooks for resizing and all that
     WRAP(main_hook);
+    t_next = gc_clock(CLOCK_MONOTONIC);
+    info.resize_time = t_next - t;
+    t = t_next;
 
     CALL(sylvan_rehash_all);
+    t_next = gc_clock(CLOCK_MONOTONIC);
+    info.rehash_time = t_next - t;
+    t = t_next;
+
+    info.nodes_after = gc_count_nodes ? CALL(llmsset_count_marked, nodes) : 0;
+    info.table_after = llmsset_get_size(nodes);
+    t_next = gc_clock(CLOCK_MONOTONIC);
+    count_time += t_next - t;
+    info.time = t_next - t_start - count_time;
+    gc_info = info;
 
     // call post gc hooks
     for (gc_hook_entry_t e = postgc_list; e != NULL; e = e->next) {
@@ -251,10 +379,11 @@ VOID_TASK_0(sylvan_gc_go)
 /**
  * Perform garbage collection
  */
-VOID_TASK_IMPL_0(sylvan_gc)
+VOID_TASK_1(sylvan_gc_run, int, trigger)
 {
     if (gc_enabled) {
         if (cas(&gc, 0, 1)) {
+            gc_trigger = trigger;
             NEWFRAME(sylvan_gc_go);
             gc = 0;
         } else {
@@ -265,6 +394,21 @@ VOID_TASK_IMPL_0(sylvan_gc)
     }
 }
 
+VOID_TASK_IMPL_0(sylvan_gc)
+{
+    CALL(sylvan_gc_run, SYLVAN_GC_EXPLICIT);
+}
+
+VOID_TASK_IMPL_0(sylvan_gc_compact)
+{
+    CALL(sylvan_gc_run, gc_can_compact() ? SYLVAN_GC_COMPACT : SYLVAN_GC_EXPLICIT);
+}
+
+VOID_TASK_IMPL_0(sylvan_gc_table_full)
+{
+    CALL(sylvan_gc_run, SYLVAN_GC_TABLE_FULL);
+}
+
 /**
  * The unique table
  */
@@ -319,7 +463,7 @@ sylvan_set_limits(size_t memorycap, int table_ratio, int initial_ratio)
         max_c <<= -table_ratio;
     }
 
-    size_t cur = max_t * 24 + max_c * 36;
+    size_t cur = max_t * 24 + max_c * cache_getbucketsize();
     if (cur > memorycap) {
         fprintf(stderr, "sylvan_set_limits: memory cap incompatible with requested table ratio\n");
     }
@@ -348,6 +492,26 @@ sylvan_set_limits(size_t memorycap, int table_ratio, int initial_ratio)
     cache_max = max_c;
 }
 
+void
+sylvan_set_initial_nodes(size_t nodes)
+{
+    if (table_max == 0) {
+        fprintf(stderr, "sylvan_set_initial_nodes error: table sizes not set (sylvan_set_sizes or sylvan_set_limits)!\n");
+        exit(1);
+    }
+
+    /* Halve both tables from their maximum, as long as the nodes table stays big enough,
+       but not below the initial sizes that are already set */
+    size_t min_t = table_max, min_c = cache_max;
+    while ((min_t >> 1) >= nodes && min_t > table_min && min_c > cache_min) {
+        min_t >>= 1;
+        min_c >>= 1;
+    }
+
+    table_min = min_t;
+    cache_min = min_c;
+}
+
 /**
  * Initializes Sylvan.
  */
@@ -419,6 +583,12 @@ sylvan_quit()
         free(e);
     }
 
+    while (compact_list != NULL) {
+        gc_compact_entry_t e = compact_list;
+        compact_list = e->next;
+        free(e);
+    }
+
     cache_free();
     llmsset_free(nodes);
 }
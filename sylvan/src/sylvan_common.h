@@ -69,6 +69,17 @@ void sylvan_set_sizes(size_t min_tablesize, size_t max_tablesize, size_t min_cac
  */
 void sylvan_set_limits(size_t memory_cap, int table_ratio, int initial_ratio);
 
+/**
+ * Grow the initial table sizes computed by sylvan_set_sizes or sylvan_set_limits.
+ * The initial nodes table is the smallest size (obtained by halving the maximum) with
+ * at least the given number of buckets, but never smaller than before. The initial
+ * operation cache is scaled by the same factor. Use this when the peak number of nodes
+ * is known, e.g. from a previous run, to avoid the garbage collections that only serve
+ * to grow the tables.
+ * Call this function before sylvan_init_package.
+ */
+void sylvan_set_initial_nodes(size_t nodes);
+
 /**
  * Frees all Sylvan data (also calls the quit() functions of BDD/LDD parts)
  */
@@ -116,6 +127,9 @@ VOID_TASK_DECL_2(sylvan_table_usage, size_t*, size_t*);
  * - sylvan_clear_cache() clears the operation cache (step 2)
  * - sylvan_clear_and_mark() performs steps 3 and 4.
  * - sylvan_rehash_all() performs steps 5 and 6.
+ *
+ * Compacting garbage collection (sylvan_gc_compact) additionally renumbers the marked
+ * nodes between steps 4 and 5, see sylvan_gc_compact.
  */
 
 /**
@@ -128,6 +142,72 @@ VOID_TASK_DECL_2(sylvan_table_usage, size_t*, size_t*);
 VOID_TASK_DECL_0(sylvan_gc);
 #define sylvan_gc() (RUN(sylvan_gc))
 
+/**
+ * Trigger compacting garbage collection manually.
+ *
+ * After marking, all live nodes are renumbered in depth-first order from the roots and
+ * moved to the start of the nodes table, so nodes that are traversed together are
+ * stored together, and the roots are rewritten to the new node indices. The roots are
+ * those of the marking callbacks installed with sylvan_gc_add_compact, i.e., for
+ * MTBDDs and LDDs the external references (mtbdd_ref), the protected variables
+ * (mtbdd_protect) and the pointer and value stacks (mtbdd_refs_pushptr, mtbdd_refs_push).
+ * Any other copy of a node index, for example in a local variable or in a custom cache
+ * that is not cleared by a pre gc hook, is invalid afterwards.
+ *
+ * Only call this between operations, never from inside a Sylvan operation.
+ * If a marking callback is installed without compaction callback, this performs an
+ * ordinary garbage collection instead.
+ */
+VOID_TASK_DECL_0(sylvan_gc_compact);
+#define sylvan_gc_compact() (RUN(sylvan_gc_compact))
+
+/**
+ * Trigger garbage collection because no new nodes can be added to the nodes table.
+ * Used by the node constructors; the only difference with sylvan_gc() is the
+ * trigger recorded in sylvan_gc_info_t.
+ */
+VOID_TASK_DECL_0(sylvan_gc_table_full);
+
+/**
+ * Statistics of a single garbage collection. Times are in seconds.
+ * The total time includes the pre gc hooks, but not the post gc hooks.
+ */
+typedef enum sylvan_gc_trigger {
+    SYLVAN_GC_EXPLICIT,   // sylvan_gc() was called
+    SYLVAN_GC_TABLE_FULL, // a node could not be added to the nodes table
+    SYLVAN_GC_COMPACT,    // sylvan_gc_compact() was called
+} sylvan_gc_trigger_t;
+
+typedef struct sylvan_gc_info {
+    size_t number;          // garbage collections so far, including this one
+    int trigger;            // one of sylvan_gc_trigger_t
+    double timestamp;       // wall-clock time at the start (seconds since the epoch)
+    double time;            // total pause time
+    double clear_cache_time;
+    double mark_time;
+    double compact_time;    // renumbering the nodes (compacting garbage collection only)
+    double resize_time;     // the main gc hook
+    double rehash_time;
+    size_t nodes_before;    // occupied buckets before (live and dead nodes), see sylvan_gc_count_nodes
+    size_t nodes_after;     // live nodes after, see sylvan_gc_count_nodes
+    size_t table_before;    // nodes table size before
+    size_t table_after;     // nodes table size after (resizing)
+} sylvan_gc_info_t;
+
+/**
+ * Statistics of the most recent garbage collection (all zero before the first).
+ * The record is complete when the post gc hooks are called.
+ */
+const sylvan_gc_info_t* sylvan_gc_last_info(void);
+
+/**
+ * Enable or disable counting the nodes before and after every garbage collection
+ * (nodes_before and nodes_after of sylvan_gc_info_t, otherwise 0). Disabled by default.
+ * Counting scans the entire nodes table twice per garbage collection; this is not
+ * included in the reported times.
+ */
+void sylvan_gc_count_nodes(int enabled);
+
 /**
  * Enable or disable garbage collection.
  *
@@ -196,6 +276,18 @@ void sylvan_gc_hook_main(gc_hook_cb callback);
  */
 void sylvan_gc_add_mark(gc_hook_cb mark_cb);
 
+/**
+ * Add a compaction callback for the marking callback mark_cb.
+ *
+ * During compacting garbage collection, compact_cb is called (in the order the
+ * callbacks were added) after all nodes are marked and llmsset_compact_begin is called.
+ * It must claim the new index of every node reachable from the roots of mark_cb with
+ * llmsset_compact_claim, in depth-first order, and rewrite these roots to the new
+ * indices. See mtbdd_compact_rec and lddmc_compact_rec.
+ * A compaction callback that is added for several marking callbacks is called once.
+ */
+void sylvan_gc_add_compact(gc_hook_cb mark_cb, gc_hook_cb compact_cb);
+
 /**
  * One of the hooks for resizing behavior.
  * Default if SYLVAN_AGGRESSIVE_RESIZE is set.
@@ -19,6 +19,36 @@
 #ifndef SYLVAN_HASH_H
 #define SYLVAN_HASH_H
 
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#define SYLVAN_HAVE_CRC32C 1
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__)
+#define SYLVAN_HAVE_CRC32C 1
+#else
+#define SYLVAN_HAVE_CRC32C 0
+#endif
+
+/**
+ * Hash function of the nodes table and the operation cache, selected at build
+ * time with SYLVAN_HASH:
+ * - SYLVAN_HASH_DEFAULT: tabulation hashing (nodes table) and FNV-1a (cache)
+ * - SYLVAN_HASH_FNV: FNV-1a for both
+ * - SYLVAN_HASH_MIX: multiply-xorshift for both
+ * - SYLVAN_HASH_CRC32C: hardware CRC32C for both (requires SSE4.2 or ARMv8 CRC)
+ * The hash of custom leaves (sylvan_mt) is not affected.
+ */
+#define SYLVAN_HASH_DEFAULT 0
+#define SYLVAN_HASH_FNV     1
+#define SYLVAN_HASH_MIX     2
+#define SYLVAN_HASH_CRC32C  3
+
+#ifndef SYLVAN_HASH
+#define SYLVAN_HASH SYLVAN_HASH_DEFAULT
+#endif
+
+#if SYLVAN_HASH == SYLVAN_HASH_CRC32C && !SYLVAN_HAVE_CRC32C
+#error "SYLVAN_HASH_CRC32C requires a target with CRC32C instructions (e.g. -msse4.2)"
+#endif
+
 #ifdef __cplusplus
 namespace sylvan {
 extern "C" {
@@ -77,6 +107,116 @@ sylvan_fnvhash8(uint64_t a, uint64_t seed)
     return hash ^ (hash >> 32);
 }
 
+/**
+ * FNV-1a over three 64-bit values, also using the upper half of a.
+ * This is the hash of the operation cache.
+ */
+static inline uint64_t
+sylvan_fnvhash24(uint64_t a, uint64_t b, uint64_t c, uint64_t seed)
+{
+    const uint64_t prime = 1099511628211;
+    uint64_t hash = seed;
+    hash = (hash ^ (a>>32));
+    hash = (hash ^ a) * prime;
+    hash = (hash ^ b) * prime;
+    hash = (hash ^ c) * prime;
+    return hash;
+}
+
+/**
+ * Multiply-xorshift mixer (the finalizer of splitmix64/murmur3), applied
+ * after adding each value. Every output bit depends on every input bit.
+ */
+static inline uint64_t
+sylvan_mix64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9LLU;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebLLU;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t
+sylvan_mixhash16(uint64_t a, uint64_t b, uint64_t seed)
+{
+    uint64_t hash = sylvan_mix64(seed ^ a);
+    return sylvan_mix64(hash ^ (b * 0x9e3779b97f4a7c15LLU));
+}
+
+static inline uint64_t
+sylvan_mixhash24(uint64_t a, uint64_t b, uint64_t c, uint64_t seed)
+{
+    uint64_t hash = sylvan_mix64(seed ^ a);
+    hash = sylvan_mix64(hash ^ (b * 0x9e3779b97f4a7c15LLU));
+    return sylvan_mix64(hash ^ (c * 0xc2b2ae3d27d4eb4fLLU));
+}
+
+#if SYLVAN_HAVE_CRC32C
+
+static inline uint32_t
+sylvan_crc32c_u64(uint32_t crc, uint64_t value)
+{
+#if defined(__SSE4_2__)
+    return (uint32_t)__builtin_ia32_crc32di(crc, value);
+#else
+    return __builtin_aarch64_crc32cx(crc, value);
+#endif
+}
+
+/**
+ * Two independent CRC32C chains (with the values in opposite order) give the
+ * upper and lower half of the 64-bit hash. The instructions of both chains
+ * can execute in parallel.
+ */
+static inline uint64_t
+sylvan_crc32chash16(uint64_t a, uint64_t b, uint64_t seed)
+{
+    uint64_t hi = sylvan_crc32c_u64(sylvan_crc32c_u64((uint32_t)seed, a), b);
+    uint64_t lo = sylvan_crc32c_u64(sylvan_crc32c_u64((uint32_t)(seed>>32), b), a);
+    return (hi << 32) | lo;
+}
+
+static inline uint64_t
+sylvan_crc32chash24(uint64_t a, uint64_t b, uint64_t c, uint64_t seed)
+{
+    uint64_t hi = sylvan_crc32c_u64(sylvan_crc32c_u64(sylvan_crc32c_u64((uint32_t)seed, a), b), c);
+    uint64_t lo = sylvan_crc32c_u64(sylvan_crc32c_u64(sylvan_crc32c_u64((uint32_t)(seed>>32), c), b), a);
+    return (hi << 32) | lo;
+}
+
+#endif
+
+/**
+ * Hash of the nodes table
+ */
+static inline uint64_t
+sylvan_hash16(uint64_t a, uint64_t b, uint64_t seed)
+{
+#if SYLVAN_HASH == SYLVAN_HASH_FNV
+    return sylvan_fnvhash16(a, b, seed);
+#elif SYLVAN_HASH == SYLVAN_HASH_MIX
+    return sylvan_mixhash16(a, b, seed);
+#elif SYLVAN_HASH == SYLVAN_HASH_CRC32C
+    return sylvan_crc32chash16(a, b, seed);
+#else
+    return sylvan_tabhash16(a, b, seed);
+#endif
+}
+
+/**
+ * Hash of the operation cache
+ */
+static inline uint64_t
+sylvan_hash24(uint64_t a, uint64_t b, uint64_t c, uint64_t seed)
+{
+#if SYLVAN_HASH == SYLVAN_HASH_MIX
+    return sylvan_mixhash24(a, b, c, seed);
+#elif SYLVAN_HASH == SYLVAN_HASH_CRC32C
+    return sylvan_crc32chash24(a, b, c, seed);
+#else
+    return sylvan_fnvhash24(a, b, c, seed);
+#endif
+}
+
 /**
  * Called by Sylvan's hash table initializer to initialize the tables for
  * tabulation hashing.
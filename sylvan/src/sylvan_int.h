@@ -68,6 +68,8 @@ static const uint64_t CACHE_BDD_CLOSURE             = (13LL<<40);
 static const uint64_t CACHE_BDD_ISBDD               = (14LL<<40);
 static const uint64_t CACHE_BDD_SUPPORT             = (15LL<<40);
 static const uint64_t CACHE_BDD_PATHCOUNT           = (16LL<<40);
+static const uint64_t CACHE_BDD_RELNEXT_MINUS       = (17LL<<40);
+static const uint64_t CACHE_BDD_RELNEXT_UNION       = (18LL<<40);
 
 // MDD operations
 static const uint64_t CACHE_MDD_RELPROD             = (20LL<<40);
@@ -81,6 +83,7 @@ static const uint64_t CACHE_MDD_RELPREV             = (27LL<<40);
 static const uint64_t CACHE_MDD_SATCOUNT            = (28LL<<40);
 static const uint64_t CACHE_MDD_SATCOUNTL1          = (29LL<<40);
 static const uint64_t CACHE_MDD_SATCOUNTL2          = (30LL<<40);
+static const uint64_t CACHE_MDD_RELPROD_MINUS       = (31LL<<40);
 
 // MTBDD operations
 static const uint64_t CACHE_MTBDD_APPLY             = (40LL<<40);
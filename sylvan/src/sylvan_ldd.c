@@ -42,6 +42,54 @@ VOID_TASK_IMPL_1(lddmc_gc_mark_rec, MDD, mdd)
     }
 }
 
+/**
+ * Recursively renumber MDD nodes during compacting garbage collection.
+ * Only the down edges recurse; the right chain is walked in a loop, so the stack
+ * depth is bounded by the number of levels and not by the length of the chains.
+ */
+MDD
+lddmc_compact_rec(MDD mdd)
+{
+    if (mdd <= lddmc_true) return mdd;
+
+    const uint64_t result = llmsset_compact_get(nodes, mdd);
+    if (result != 0) return result;
+
+    // depth-first, the node gets its index before its successors (down first)
+    uint64_t new_index = llmsset_compact_claim(nodes, mdd);
+    const uint64_t first = new_index;
+    for (;;) {
+        struct mddnode n = *LDD_GETNODE(mdd);
+        mddnode_setdown(&n, lddmc_compact_rec(mddnode_getdown(&n)));
+
+        // claim the right sibling after the down subgraph, unless it already has an index
+        const MDD right = mddnode_getright(&n);
+        uint64_t new_right = right;
+        int claimed = 0;
+        if (right > lddmc_true) {
+            new_right = llmsset_compact_get(nodes, right);
+            if (new_right == 0) {
+                new_right = llmsset_compact_claim(nodes, right);
+                claimed = 1;
+            }
+        }
+        mddnode_setright(&n, new_right);
+        llmsset_compact_set(nodes, new_index, n.a, n.b);
+
+        if (!claimed) return first;
+        mdd = right;
+        new_index = new_right;
+    }
+}
+
+/* The new index of an MDD, after lddmc_compact_rec */
+static inline MDD
+lddmc_compact_get(MDD mdd)
+{
+    if (mdd <= lddmc_true) return mdd;
+    return llmsset_compact_get(nodes, mdd);
+}
+
 /**
  * External references
  */
@@ -124,6 +172,12 @@ VOID_TASK_0(lddmc_gc_mark_protected)
     }
 }
 
+/* Called during compacting garbage collection */
+VOID_TASK_0(lddmc_compact_external_refs)
+{
+    refs_remap(&lddmc_refs, lddmc_compact_rec);
+}
+
 /* Infrastructure for internal markings */
 typedef struct lddmc_refs_task
 {
@@ -203,6 +257,64 @@ VOID_TASK_0(lddmc_refs_mark)
     TOGETHER(lddmc_refs_mark_task);
 }
 
+/* Stacks of the workers, collected for compaction */
+static lddmc_refs_internal_t *lddmc_compact_stacks;
+static volatile size_t lddmc_compact_stacks_count;
+
+VOID_TASK_0(lddmc_compact_collect_task)
+{
+    LOCALIZE_THREAD_LOCAL(lddmc_refs_key, lddmc_refs_internal_t);
+    lddmc_compact_stacks[__sync_fetch_and_add(&lddmc_compact_stacks_count, 1)] = lddmc_refs_key;
+}
+
+static int
+lddmc_compact_ptr_cmp(const void *a, const void *b)
+{
+    const uintptr_t x = (uintptr_t)*(MDD* const*)a, y = (uintptr_t)*(MDD* const*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/**
+ * Renumber the MDDs of the protected variables and of the pointer and value stacks.
+ * A variable can be protected and on a pointer stack (or on several pointer stacks),
+ * so first all nodes are renumbered and then every variable is rewritten once.
+ */
+VOID_TASK_0(lddmc_compact_roots)
+{
+    const size_t workers = lace_workers();
+    lddmc_compact_stacks = (lddmc_refs_internal_t*)malloc(sizeof(lddmc_refs_internal_t[workers]));
+    lddmc_compact_stacks_count = 0;
+    TOGETHER(lddmc_compact_collect_task);
+
+    size_t count = lddmc_protected.refs_size;
+    for (size_t i=0; i<workers; i++) {
+        count += lddmc_compact_stacks[i]->pcur - lddmc_compact_stacks[i]->pbegin;
+    }
+    MDD **vars = (MDD**)malloc(sizeof(MDD*[count+1]));
+    size_t n = 0;
+
+    uint64_t *it = protect_iter(&lddmc_protected, 0, lddmc_protected.refs_size);
+    while (it != NULL) vars[n++] = (MDD*)protect_next(&lddmc_protected, &it, lddmc_protected.refs_size);
+    for (size_t i=0; i<workers; i++) {
+        lddmc_refs_internal_t s = lddmc_compact_stacks[i];
+        for (const MDD **p = s->pbegin; p != s->pcur; p++) vars[n++] = (MDD*)*p;
+    }
+
+    for (size_t i=0; i<n; i++) lddmc_compact_rec(*vars[i]);
+    qsort(vars, n, sizeof(MDD*), lddmc_compact_ptr_cmp);
+    for (size_t i=0; i<n; i++) {
+        if (i == 0 || vars[i] != vars[i-1]) *vars[i] = lddmc_compact_get(*vars[i]);
+    }
+
+    for (size_t i=0; i<workers; i++) {
+        lddmc_refs_internal_t s = lddmc_compact_stacks[i];
+        for (MDD *r = s->rbegin; r != s->rcur; r++) *r = lddmc_compact_rec(*r);
+    }
+
+    free(vars);
+    free(lddmc_compact_stacks);
+}
+
 void
 lddmc_refs_init_key(void)
 {
@@ -316,6 +428,7 @@ lddmc_refs_sync(MDD result)
 }
 
 VOID_TASK_DECL_0(lddmc_gc_mark_serialize);
+VOID_TASK_DECL_0(lddmc_compact_serialize);
 
 /**
  * Initialize and quit functions
@@ -334,6 +447,10 @@ sylvan_init_ldd()
     sylvan_gc_add_mark(TASK(lddmc_gc_mark_external_refs));
     sylvan_gc_add_mark(TASK(lddmc_gc_mark_protected));
     sylvan_gc_add_mark(TASK(lddmc_gc_mark_serialize));
+    sylvan_gc_add_compact(TASK(lddmc_gc_mark_protected), TASK(lddmc_compact_roots));
+    sylvan_gc_add_compact(TASK(lddmc_refs_mark), TASK(lddmc_compact_roots));
+    sylvan_gc_add_compact(TASK(lddmc_gc_mark_external_refs), TASK(lddmc_compact_external_refs));
+    sylvan_gc_add_compact(TASK(lddmc_gc_mark_serialize), TASK(lddmc_compact_serialize));
 
     refs_create(&lddmc_refs, 1024);
     if (!lddmc_protected_created) {
@@ -365,7 +482,7 @@ lddmc_makenode(uint32_t value, MDD ifeq, MDD ifneq)
     if (index == 0) {
         lddmc_refs_push(ifeq);
         lddmc_refs_push(ifneq);
-        RUN(sylvan_gc);
+        RUN(sylvan_gc_table_full);
         lddmc_refs_pop(2);
 
         index = llmsset_lookup(nodes, n.a, n.b, &created);
@@ -392,7 +509,7 @@ lddmc_make_copynode(MDD ifeq, MDD ifneq)
     if (index == 0) {
         lddmc_refs_push(ifeq);
         lddmc_refs_push(ifneq);
-        RUN(sylvan_gc);
+        RUN(sylvan_gc_table_full);
         lddmc_refs_pop(2);
 
         index = llmsset_lookup(nodes, n.a, n.b, &created);
@@ -1291,6 +1408,190 @@ TASK_IMPL_4(MDD, lddmc_relprod_union, MDD, set, MDD, rel, MDD, meta, MDD, un)
     return result;
 }
 
+TASK_5(MDD, lddmc_relprod_minus_help, uint32_t, val, MDD, set, MDD, rel, MDD, proj, MDD, avoid)
+{
+    return lddmc_makenode(val, CALL(lddmc_relprod_minus, set, rel, proj, avoid), lddmc_false);
+}
+
+// meta: -1 (end; rest not in rel), 0 (not in rel), 1 (read), 2 (write), 3 (only-read), 4 (only-write), 5 (action label)
+TASK_IMPL_4(MDD, lddmc_relprod_minus, MDD, set, MDD, rel, MDD, meta, MDD, avoid)
+{
+    // same as relprod, but every value of the result is immediately matched
+    // against avoid, so successors in avoid are never constructed
+    if (set == lddmc_false) return lddmc_false;
+    if (rel == lddmc_false) return lddmc_false;
+    if (avoid == lddmc_false) return CALL(lddmc_relprod, set, rel, meta);
+    if (avoid == lddmc_true) return lddmc_false;
+    if (meta == lddmc_true) return CALL(lddmc_minus, set, avoid);
+
+    mddnode_t n_meta = LDD_GETNODE(meta);
+    uint32_t m_val = mddnode_getvalue(n_meta);
+    if (m_val == (uint32_t)-1) return CALL(lddmc_minus, set, avoid);
+
+    // if meta is not 0, then both set and rel must be an internal LDD node
+    if (m_val != 0 && m_val != 5) assert(set != lddmc_true && rel != lddmc_true);
+
+    /* Skip nodes if possible */
+    if (!mddnode_getcopy(LDD_GETNODE(rel))) {
+        if (m_val == 1 || m_val == 3) {
+            if (!match_ldds(&set, &rel)) return lddmc_false;
+        }
+    }
+
+    /* Test gc */
+    sylvan_gc_test();
+
+    sylvan_stats_count(LDD_RELPROD_MINUS);
+
+    /* Access cache */
+    MDD result;
+    MDD _set=set, _rel=rel;
+    if (cache_get4(CACHE_MDD_RELPROD_MINUS, set, rel, meta, avoid, &result)) {
+        sylvan_stats_count(LDD_RELPROD_MINUS_CACHED);
+        return result;
+    }
+
+    mddnode_t n_set = LDD_GETNODE(set);
+    mddnode_t n_rel = LDD_GETNODE(rel);
+
+    /* Recursive operations */
+    if (m_val == 0) { // not in rel
+        uint32_t value = mddnode_getvalue(n_set);
+        lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, mddnode_getright(n_set), rel, meta, avoid));
+        MDD down = CALL(lddmc_relprod_minus, mddnode_getdown(n_set), rel, mddnode_getdown(n_meta), lddmc_follow(avoid, value));
+        lddmc_refs_push(down);
+        MDD right = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+        lddmc_refs_pop(1);
+        result = lddmc_makenode(value, down, right);
+    } else if (m_val == 5) { // action label
+        lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, set, mddnode_getright(n_rel), meta, avoid));
+        MDD down = CALL(lddmc_relprod_minus, set, mddnode_getdown(n_rel), mddnode_getdown(n_meta), avoid);
+        lddmc_refs_push(down);
+        MDD right = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+        lddmc_refs_push(right);
+        result = CALL(lddmc_union, down, right);
+        lddmc_refs_pop(2);
+    } else if (m_val == 1) { // read
+        // the values of the result are only known at the write level
+        lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, set, mddnode_getright(n_rel), meta, avoid)); // spawn next read in list
+
+        if (mddnode_getcopy(n_rel)) {
+            // spawn for every value to copy (set)
+            int count = 0;
+            for (;;) {
+                lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, set, mddnode_getdown(n_rel), mddnode_getdown(n_meta), avoid));
+                count++;
+                set = mddnode_getright(n_set);
+                if (set == lddmc_false) break;
+                n_set = LDD_GETNODE(set);
+            }
+
+            // sync+union (one by one)
+            result = lddmc_false;
+            while (count--) {
+                lddmc_refs_push(result);
+                MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+                lddmc_refs_push(result2);
+                result = CALL(lddmc_union, result, result2);
+                lddmc_refs_pop(2);
+            }
+        } else {
+            result = CALL(lddmc_relprod_minus, set, mddnode_getdown(n_rel), mddnode_getdown(n_meta), avoid);
+        }
+
+        lddmc_refs_push(result);
+        MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus)); // sync next read in list
+        lddmc_refs_push(result2);
+        result = CALL(lddmc_union, result, result2);
+        lddmc_refs_pop(2);
+    } else if (m_val == 3) { // only-read
+        if (mddnode_getcopy(n_rel)) {
+            // copy on read ('for any value')
+            lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, set, mddnode_getright(n_rel), meta, avoid)); // spawn without_copy
+
+            // spawn for every value to copy (set)
+            int count = 0;
+            for (;;) {
+                uint32_t value = mddnode_getvalue(n_set);
+                lddmc_refs_spawn(SPAWN(lddmc_relprod_minus_help, value, mddnode_getdown(n_set), mddnode_getdown(n_rel), mddnode_getdown(n_meta), lddmc_follow(avoid, value)));
+                count++;
+                set = mddnode_getright(n_set);
+                if (set == lddmc_false) break;
+                n_set = LDD_GETNODE(set);
+            }
+
+            // sync+union (one by one)
+            result = lddmc_false;
+            while (count--) {
+                lddmc_refs_push(result);
+                MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus_help));
+                lddmc_refs_push(result2);
+                result = CALL(lddmc_union, result, result2);
+                lddmc_refs_pop(2);
+            }
+
+            // add result from without_copy
+            lddmc_refs_push(result);
+            MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+            lddmc_refs_push(result2);
+            result = CALL(lddmc_union, result, result2);
+            lddmc_refs_pop(2);
+        } else {
+            // only-read, without copy
+            uint32_t value = mddnode_getvalue(n_set);
+            lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, mddnode_getright(n_set), mddnode_getright(n_rel), meta, avoid));
+            MDD down = CALL(lddmc_relprod_minus, mddnode_getdown(n_set), mddnode_getdown(n_rel), mddnode_getdown(n_meta), lddmc_follow(avoid, value));
+            lddmc_refs_push(down);
+            MDD right = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+            lddmc_refs_pop(1);
+            result = lddmc_makenode(value, down, right);
+        }
+    } else if (m_val == 2 || m_val == 4) {
+        // write, only-write
+        if (m_val == 4) {
+            // only-write, so we need to include 'for all variables'
+            lddmc_refs_spawn(SPAWN(lddmc_relprod_minus, mddnode_getright(n_set), rel, meta, avoid)); // next in set
+        }
+
+        // spawn for every value to write (rel)
+        int count = 0;
+        for (;;) {
+            uint32_t value;
+            if (mddnode_getcopy(n_rel)) value = mddnode_getvalue(n_set);
+            else value = mddnode_getvalue(n_rel);
+            lddmc_refs_spawn(SPAWN(lddmc_relprod_minus_help, value, mddnode_getdown(n_set), mddnode_getdown(n_rel), mddnode_getdown(n_meta), lddmc_follow(avoid, value)));
+            count++;
+            rel = mddnode_getright(n_rel);
+            if (rel == lddmc_false) break;
+            n_rel = LDD_GETNODE(rel);
+        }
+
+        // sync+union (one by one)
+        result = lddmc_false;
+        while (count--) {
+            lddmc_refs_push(result);
+            MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus_help));
+            lddmc_refs_push(result2);
+            result = CALL(lddmc_union, result, result2);
+            lddmc_refs_pop(2);
+        }
+
+        if (m_val == 4) {
+            // sync+union with other variables
+            lddmc_refs_push(result);
+            MDD result2 = lddmc_refs_sync(SYNC(lddmc_relprod_minus));
+            lddmc_refs_push(result2);
+            result = CALL(lddmc_union, result, result2);
+            lddmc_refs_pop(2);
+        }
+    }
+
+    /* Write to cache */
+    if (cache_put4(CACHE_MDD_RELPROD_MINUS, _set, _rel, meta, avoid, result)) sylvan_stats_count(LDD_RELPROD_MINUS_CACHEDPUT);
+
+    return result;
+}
+
 TASK_5(MDD, lddmc_relprev_help, uint32_t, val, MDD, set, MDD, rel, MDD, proj, MDD, uni)
 {
     return lddmc_makenode(val, CALL(lddmc_relprev, set, rel, proj, uni), lddmc_false);
@@ -2625,6 +2926,26 @@ VOID_TASK_IMPL_0(lddmc_gc_mark_serialize)
     }
 }
 
+VOID_TASK_IMPL_0(lddmc_compact_serialize)
+{
+    struct lddmc_ser *s;
+    avl_iter_t *it = lddmc_ser_reversed_iter(lddmc_ser_reversed_set);
+
+    /* Renumber in the order of serialization (the order of this set does not change) */
+    while ((s=lddmc_ser_reversed_iter_next(it))) {
+        s->mdd = lddmc_compact_rec(s->mdd);
+    }
+    lddmc_ser_reversed_iter_free(it);
+
+    /* Rebuild the set ordered by MDD */
+    lddmc_ser_free(&lddmc_ser_set);
+    it = lddmc_ser_reversed_iter(lddmc_ser_reversed_set);
+    while ((s=lddmc_ser_reversed_iter_next(it))) {
+        lddmc_ser_insert(&lddmc_ser_set, s);
+    }
+    lddmc_ser_reversed_iter_free(it);
+}
+
 static void
 lddmc_sha2_rec(MDD mdd, SHA256_CTX *ctx)
 {
@@ -96,6 +96,12 @@ size_t lddmc_count_refs(void);
 VOID_TASK_DECL_1(lddmc_gc_mark_rec, MDD)
 #define lddmc_gc_mark_rec(mdd) RUN(lddmc_gc_mark_rec, mdd)
 
+/**
+ * Call lddmc_compact_rec for every mdd you keep in your custom compaction functions
+ * (see sylvan_gc_add_compact). Returns the renumbered mdd.
+ */
+MDD lddmc_compact_rec(MDD mdd);
+
 /* Sanity check - returns depth of MDD including 'true' terminal or 0 for empty set */
 #ifndef NDEBUG
 size_t lddmc_test_ismdd(MDD mdd);
@@ -131,6 +137,14 @@ TASK_DECL_3(MDD, lddmc_relprod, MDD, MDD, MDD);
 TASK_DECL_4(MDD, lddmc_relprod_union, MDD, MDD, MDD, MDD);
 #define lddmc_relprod_union(a, b, meta, un) RUN(lddmc_relprod_union, a, b, meta, un)
 
+/**
+ * Calculate the successors of a according to rel[meta] that are not in avoid,
+ * i.e. relprod(a, rel, meta) minus avoid, without constructing the successors
+ * that are in avoid (typically the visited states).
+ */
+TASK_DECL_4(MDD, lddmc_relprod_minus, MDD, MDD, MDD, MDD);
+#define lddmc_relprod_minus(a, b, meta, avoid) RUN(lddmc_relprod_minus, a, b, meta, avoid)
+
 /**
  * Calculate all predecessors to a in uni according to rel[proj]
  * <proj> follows the same semantics as relprod
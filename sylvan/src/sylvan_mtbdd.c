@@ -94,13 +94,49 @@ VOID_TASK_IMPL_1(mtbdd_gc_mark_rec, MDD, mtbdd)
     if (llmsset_mark(nodes, MTBDD_STRIPMARK(mtbdd))) {
         mtbddnode_t n = MTBDD_GETNODE(mtbdd);
         if (!mtbddnode_isleaf(n)) {
-            SPAWN(mtbdd_gc_mark_rec, mtbddnode_getlow(n));
-            CALL(mtbdd_gc_mark_rec, mtbddnode_gethigh(n));
+            const MTBDD low = mtbddnode_getlow(n);
+            const MTBDD high = mtbddnode_gethigh(n);
+            // fetch both children before descending into either
+            llmsset_prefetch(nodes, MTBDD_STRIPMARK(low));
+            llmsset_prefetch(nodes, MTBDD_STRIPMARK(high));
+            SPAWN(mtbdd_gc_mark_rec, low);
+            CALL(mtbdd_gc_mark_rec, high);
             SYNC(mtbdd_gc_mark_rec);
         }
     }
 }
 
+/* Recursively renumber MTBDD nodes during compacting garbage collection */
+MTBDD
+mtbdd_compact_rec(MTBDD mtbdd)
+{
+    const uint64_t index = mtbdd & 0x000000ffffffffff;
+    if (index == 0) return mtbdd;
+
+    uint64_t new_index = llmsset_compact_get(nodes, index);
+    if (new_index == 0) {
+        // depth-first, the node gets its index before its children (low first)
+        new_index = llmsset_compact_claim(nodes, index);
+        mtbddnode_t n = MTBDD_GETNODE(index);
+        uint64_t a = n->a, b = n->b;
+        if (!mtbddnode_isleaf(n)) {
+            a = (a & 0xffffff0000000000) | mtbdd_compact_rec(a & 0x000000ffffffffff);
+            b = (b & 0xffffff0000000000) | mtbdd_compact_rec(b & 0x000000ffffffffff);
+        }
+        llmsset_compact_set(nodes, new_index, a, b);
+    }
+    return (mtbdd & 0xffffff0000000000) | new_index;
+}
+
+/* The new index of an MTBDD, after mtbdd_compact_rec */
+static inline MTBDD
+mtbdd_compact_get(MTBDD mtbdd)
+{
+    const uint64_t index = mtbdd & 0x000000ffffffffff;
+    if (index == 0) return mtbdd;
+    return (mtbdd & 0xffffff0000000000) | llmsset_compact_get(nodes, index);
+}
+
 /**
  * External references
  */
@@ -183,6 +219,12 @@ VOID_TASK_0(mtbdd_gc_mark_protected)
     }
 }
 
+/* Called during compacting garbage collection */
+VOID_TASK_0(mtbdd_compact_external_refs)
+{
+    refs_remap(&mtbdd_refs, mtbdd_compact_rec);
+}
+
 /* Infrastructure for internal markings */
 typedef struct mtbdd_refs_task
 {
@@ -195,10 +237,27 @@ typedef struct mtbdd_refs_internal
     const MTBDD **pbegin, **pend, **pcur;
     MTBDD *rbegin, *rend, *rcur;
     mtbdd_refs_task_t sbegin, send, scur;
+    struct mtbdd_refs_internal *next; // for the list of non-worker threads
 } *mtbdd_refs_internal_t;
 
 DECLARE_THREAD_LOCAL(mtbdd_refs_key, mtbdd_refs_internal_t);
 
+/* Reference stacks of threads that are not Lace workers (e.g. the main thread) */
+static mtbdd_refs_internal_t mtbdd_refs_external = NULL;
+static volatile int mtbdd_refs_external_lock = 0;
+
+static inline void
+mtbdd_refs_external_acquire(void)
+{
+    while (!__sync_bool_compare_and_swap(&mtbdd_refs_external_lock, 0, 1)) {}
+}
+
+static inline void
+mtbdd_refs_external_release(void)
+{
+    __sync_lock_release(&mtbdd_refs_external_lock);
+}
+
 VOID_TASK_2(mtbdd_refs_mark_p_par, const MTBDD**, begin, size_t, count)
 {
     if (count < 32) {
@@ -260,6 +319,80 @@ VOID_TASK_0(mtbdd_refs_mark_task)
 VOID_TASK_0(mtbdd_refs_mark)
 {
     TOGETHER(mtbdd_refs_mark_task);
+
+    // threads that are not Lace workers wait for the operation that triggered
+    // garbage collection, so their stacks can be marked from here
+    mtbdd_refs_external_acquire();
+    for (mtbdd_refs_internal_t s = mtbdd_refs_external; s != NULL; s = s->next) {
+        SPAWN(mtbdd_refs_mark_p_par, s->pbegin, s->pcur-s->pbegin);
+        CALL(mtbdd_refs_mark_r_par, s->rbegin, s->rcur-s->rbegin);
+        SYNC(mtbdd_refs_mark_p_par);
+    }
+    mtbdd_refs_external_release();
+}
+
+/* Stacks of the workers, collected for compaction */
+static mtbdd_refs_internal_t *mtbdd_compact_stacks;
+static volatile size_t mtbdd_compact_stacks_count;
+
+VOID_TASK_0(mtbdd_compact_collect_task)
+{
+    LOCALIZE_THREAD_LOCAL(mtbdd_refs_key, mtbdd_refs_internal_t);
+    mtbdd_compact_stacks[__sync_fetch_and_add(&mtbdd_compact_stacks_count, 1)] = mtbdd_refs_key;
+}
+
+static int
+mtbdd_compact_ptr_cmp(const void *a, const void *b)
+{
+    const uintptr_t x = (uintptr_t)*(MTBDD* const*)a, y = (uintptr_t)*(MTBDD* const*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/**
+ * Renumber the MTBDDs of the protected variables and of the pointer and value stacks.
+ * A variable can be protected and on a pointer stack (or on several pointer stacks),
+ * so first all nodes are renumbered and then every variable is rewritten once.
+ */
+VOID_TASK_0(mtbdd_compact_roots)
+{
+    mtbdd_compact_stacks = (mtbdd_refs_internal_t*)malloc(sizeof(mtbdd_refs_internal_t[lace_workers()]));
+    mtbdd_compact_stacks_count = 0;
+    TOGETHER(mtbdd_compact_collect_task);
+    mtbdd_refs_external_acquire();
+    for (mtbdd_refs_internal_t s = mtbdd_refs_external; s != NULL; s = s->next) {
+        mtbdd_compact_stacks = (mtbdd_refs_internal_t*)realloc(mtbdd_compact_stacks, sizeof(mtbdd_refs_internal_t[mtbdd_compact_stacks_count+1]));
+        mtbdd_compact_stacks[mtbdd_compact_stacks_count++] = s;
+    }
+
+    size_t count = mtbdd_protected.refs_size;
+    for (size_t i=0; i<mtbdd_compact_stacks_count; i++) {
+        count += mtbdd_compact_stacks[i]->pcur - mtbdd_compact_stacks[i]->pbegin;
+    }
+    MTBDD **vars = (MTBDD**)malloc(sizeof(MTBDD*[count+1]));
+    size_t n = 0;
+
+    uint64_t *it = protect_iter(&mtbdd_protected, 0, mtbdd_protected.refs_size);
+    while (it != NULL) vars[n++] = (MTBDD*)protect_next(&mtbdd_protected, &it, mtbdd_protected.refs_size);
+    for (size_t i=0; i<mtbdd_compact_stacks_count; i++) {
+        mtbdd_refs_internal_t s = mtbdd_compact_stacks[i];
+        for (const MTBDD **p = s->pbegin; p != s->pcur; p++) vars[n++] = (MTBDD*)*p;
+    }
+
+    for (size_t i=0; i<n; i++) mtbdd_compact_rec(*vars[i]);
+    qsort(vars, n, sizeof(MTBDD*), mtbdd_compact_ptr_cmp);
+    for (size_t i=0; i<n; i++) {
+        if (i == 0 || vars[i] != vars[i-1]) *vars[i] = mtbdd_compact_get(*vars[i]);
+    }
+
+    for (size_t i=0; i<mtbdd_compact_stacks_count; i++) {
+        mtbdd_refs_internal_t s = mtbdd_compact_stacks[i];
+        for (MTBDD *r = s->rbegin; r != s->rcur; r++) *r = mtbdd_compact_rec(*r);
+    }
+
+    mtbdd_refs_external_release();
+
+    free(vars);
+    free(mtbdd_compact_stacks);
 }
 
 void
@@ -272,7 +405,35 @@ mtbdd_refs_init_key(void)
     s->rend = s->rbegin + 1024;
     s->scur = s->sbegin = (mtbdd_refs_task_t)malloc(sizeof(struct mtbdd_refs_task) * 1024);
     s->send = s->sbegin + 1024;
+    s->next = NULL;
     SET_THREAD_LOCAL(mtbdd_refs_key, s);
+
+    if (lace_get_worker() == NULL) {
+        // not a Lace worker, so not marked by mtbdd_refs_mark_task
+        mtbdd_refs_external_acquire();
+        s->next = mtbdd_refs_external;
+        mtbdd_refs_external = s;
+        mtbdd_refs_external_release();
+    }
+}
+
+void
+mtbdd_refs_thread_exit(void)
+{
+    LOCALIZE_THREAD_LOCAL(mtbdd_refs_key, mtbdd_refs_internal_t);
+    if (mtbdd_refs_key == 0 || lace_get_worker() != NULL) return;
+
+    mtbdd_refs_external_acquire();
+    mtbdd_refs_internal_t *p = &mtbdd_refs_external;
+    while (*p != mtbdd_refs_key) p = &(*p)->next;
+    *p = mtbdd_refs_key->next;
+    mtbdd_refs_external_release();
+
+    free(mtbdd_refs_key->pbegin);
+    free(mtbdd_refs_key->rbegin);
+    free(mtbdd_refs_key->sbegin);
+    free(mtbdd_refs_key);
+    SET_THREAD_LOCAL(mtbdd_refs_key, 0);
 }
 
 VOID_TASK_0(mtbdd_refs_init_task)
@@ -336,6 +497,22 @@ mtbdd_refs_popptr(size_t amount)
     mtbdd_refs_key->pcur -= amount;
 }
 
+void
+mtbdd_refs_removeptr(const MTBDD *ptr)
+{
+    LOCALIZE_THREAD_LOCAL(mtbdd_refs_key, mtbdd_refs_internal_t);
+    const MTBDD **cur = mtbdd_refs_key->pcur - 1;
+    if (*cur != ptr) {
+        // not on top: find it and shift the pointers above it down
+        while (*cur != ptr) {
+            assert(cur != mtbdd_refs_key->pbegin);
+            cur--;
+        }
+        memmove(cur, cur + 1, sizeof(MTBDD*) * (mtbdd_refs_key->pcur - cur - 1));
+    }
+    mtbdd_refs_key->pcur -= 1;
+}
+
 MTBDD __attribute__((unused))
 mtbdd_refs_push(MTBDD mtbdd)
 {
@@ -404,6 +581,9 @@ sylvan_init_mtbdd()
     sylvan_register_quit(mtbdd_quit);
     sylvan_gc_add_mark(TASK(mtbdd_gc_mark_external_refs));
     sylvan_gc_add_mark(TASK(mtbdd_gc_mark_protected));
+    sylvan_gc_add_compact(TASK(mtbdd_gc_mark_protected), TASK(mtbdd_compact_roots));
+    sylvan_gc_add_compact(TASK(mtbdd_refs_mark), TASK(mtbdd_compact_roots));
+    sylvan_gc_add_compact(TASK(mtbdd_gc_mark_external_refs), TASK(mtbdd_compact_external_refs));
 
     refs_create(&mtbdd_refs, 1024);
     if (!mtbdd_protected_created) {
@@ -428,7 +608,7 @@ mtbdd_makeleaf(uint32_t type, uint64_t value)
     int created;
     uint64_t index = custom ? llmsset_lookupc(nodes, n.a, n.b, &created) : llmsset_lookup(nodes, n.a, n.b, &created);
     if (index == 0) {
-        RUN(sylvan_gc);
+        RUN(sylvan_gc_table_full);
 
         index = custom ? llmsset_lookupc(nodes, n.a, n.b, &created) : llmsset_lookup(nodes, n.a, n.b, &created);
         if (index == 0) {
@@ -467,7 +647,7 @@ _mtbdd_makenode(uint32_t var, MTBDD low, MTBDD high)
     if (index == 0) {
         mtbdd_refs_push(low);
         mtbdd_refs_push(high);
-        RUN(sylvan_gc);
+        RUN(sylvan_gc_table_full);
         mtbdd_refs_pop(2);
 
         index = llmsset_lookup(nodes, n.a, n.b, &created);
@@ -499,7 +679,7 @@ mtbdd_makemapnode(uint32_t var, MTBDD low, MTBDD high)
     if (index == 0) {
         mtbdd_refs_push(low);
         mtbdd_refs_push(high);
-        RUN(sylvan_gc);
+        RUN(sylvan_gc_table_full);
         mtbdd_refs_pop(2);
 
         index = llmsset_lookup(nodes, n.a, n.b, &created);
@@ -89,6 +89,8 @@ static const MTBDD sylvan_invalid    = 0xffffffffffffffffLL;
 #define sylvan_ithvar           mtbdd_ithvar
 #define bdd_refs_pushptr        mtbdd_refs_pushptr
 #define bdd_refs_popptr         mtbdd_refs_popptr
+#define bdd_refs_removeptr      mtbdd_refs_removeptr
+#define bdd_refs_thread_exit    mtbdd_refs_thread_exit
 #define bdd_refs_push           mtbdd_refs_push
 #define bdd_refs_pop            mtbdd_refs_pop
 #define bdd_refs_spawn          mtbdd_refs_spawn
@@ -1018,6 +1020,12 @@ MTBDDMAP mtbdd_map_removeall(MTBDDMAP map, MTBDD variables);
 VOID_TASK_DECL_1(mtbdd_gc_mark_rec, MTBDD);
 #define mtbdd_gc_mark_rec(mtbdd) RUN(mtbdd_gc_mark_rec, mtbdd)
 
+/**
+ * Call mtbdd_compact_rec for every mtbdd you keep in your custom compaction functions
+ * (see sylvan_gc_add_compact). Returns the renumbered mtbdd.
+ */
+MTBDD mtbdd_compact_rec(MTBDD mtbdd);
+
 /**
  * Infrastructure for external references using a hash table.
  * Two hash tables store external references: a pointers table and a values table.
@@ -1077,6 +1085,20 @@ void mtbdd_refs_pushptr(const MTBDD *ptr);
  */
 void mtbdd_refs_popptr(size_t amount);
 
+/**
+ * Remove the MTBDD variable <ptr> from the pointer reference stack.
+ * This is cheap if <ptr> is the last variable pushed, which is the usual case.
+ */
+void mtbdd_refs_removeptr(const MTBDD *ptr);
+
+/**
+ * Release the reference stacks of the calling thread, if it is not a Lace worker.
+ * The stacks of such threads are marked during garbage collection until they are
+ * released, so a thread that used them (e.g. with LocalBdd) must call this before
+ * it exits, after its last pushed variable is popped.
+ */
+void mtbdd_refs_thread_exit(void);
+
 /**
  * Push an MTBDD to the values reference stack.
  * During garbage collection the references MTBDD will be marked.
@@ -42,6 +42,17 @@ Bdd::operator=(const Bdd& right)
     return *this;
 }
 
+Bdd&
+Bdd::operator=(Bdd&& right)
+{
+    // both objects are protected already, so no protect table updates needed
+    if (this != &right) {
+        bdd = right.bdd;
+        right.bdd = sylvan_false;
+    }
+    return *this;
+}
+
 int
 Bdd::operator<=(const Bdd& other) const
 {
@@ -751,6 +762,17 @@ Mtbdd::operator=(const Mtbdd& right)
     return *this;
 }
 
+Mtbdd&
+Mtbdd::operator=(Mtbdd&& right)
+{
+    // both objects are protected already, so no protect table updates needed
+    if (this != &right) {
+        mtbdd = right.mtbdd;
+        right.mtbdd = mtbdd_false;
+    }
+    return *this;
+}
+
 Mtbdd
 Mtbdd::operator!() const
 {
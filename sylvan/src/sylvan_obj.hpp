@@ -38,6 +38,8 @@ public:
     Bdd() { bdd = sylvan_false; sylvan_protect(&bdd); }
     Bdd(const BDD from) : bdd(from) { sylvan_protect(&bdd); }
     Bdd(const Bdd &from) : bdd(from.bdd) { sylvan_protect(&bdd); }
+    /* Protection is tied to the address, so a move still protects the new object */
+    Bdd(Bdd &&from) : bdd(from.bdd) { from.bdd = sylvan_false; sylvan_protect(&bdd); }
     Bdd(const uint32_t var) { bdd = sylvan_ithvar(var); sylvan_protect(&bdd); }
     ~Bdd() { sylvan_unprotect(&bdd); }
 
@@ -82,6 +84,7 @@ public:
     int operator==(const Bdd& other) const;
     int operator!=(const Bdd& other) const;
     Bdd& operator=(const Bdd& right);
+    Bdd& operator=(Bdd&& right);
     int operator<=(const Bdd& other) const;
     int operator>=(const Bdd& other) const;
     int operator<(const Bdd& other) const;
@@ -328,6 +331,65 @@ private:
     BDD bdd;
 };
 
+/**
+ * A Bdd for short-lived values, such as intermediate results.
+ *
+ * Unlike a Bdd, which is protected in the global protect table (a hash table
+ * insert and delete for every object), a LocalBdd is rooted on the refs stack
+ * of the current thread (see mtbdd_refs_pushptr). This is much cheaper, but a
+ * LocalBdd must be destroyed by the thread that created it. Typically they are
+ * local variables and temporaries; use Bdd for values that are stored or
+ * passed between threads. Operators on LocalBdd return LocalBdd.
+ * A thread that is not a Lace worker must call bdd_refs_thread_exit() after its
+ * last LocalBdd is destroyed and before it exits.
+ */
+class LocalBdd {
+public:
+    LocalBdd() : bdd(sylvan_false) { bdd_refs_pushptr(&bdd); }
+    LocalBdd(const BDD from) : bdd(from) { bdd_refs_pushptr(&bdd); }
+    LocalBdd(const Bdd &from) : bdd(from.GetBDD()) { bdd_refs_pushptr(&bdd); }
+    LocalBdd(const LocalBdd &from) : bdd(from.bdd) { bdd_refs_pushptr(&bdd); }
+    LocalBdd(LocalBdd &&from) : bdd(from.bdd) { bdd_refs_pushptr(&bdd); }
+    ~LocalBdd() { bdd_refs_removeptr(&bdd); }
+
+    /* LocalBdd objects are not meant to live on the heap */
+    static void* operator new(size_t) = delete;
+    static void* operator new[](size_t) = delete;
+
+    LocalBdd& operator=(const LocalBdd& right) { bdd = right.bdd; return *this; }
+    LocalBdd& operator=(const Bdd& right) { bdd = right.GetBDD(); return *this; }
+
+    int operator==(const LocalBdd& other) const { return bdd == other.bdd; }
+    int operator!=(const LocalBdd& other) const { return bdd != other.bdd; }
+    LocalBdd operator!() const { return LocalBdd(sylvan_not(bdd)); }
+    LocalBdd operator~() const { return LocalBdd(sylvan_not(bdd)); }
+    LocalBdd operator*(const LocalBdd& other) const { return LocalBdd(sylvan_and(bdd, other.bdd)); }
+    LocalBdd& operator*=(const LocalBdd& other) { bdd = sylvan_and(bdd, other.bdd); return *this; }
+    LocalBdd operator&(const LocalBdd& other) const { return LocalBdd(sylvan_and(bdd, other.bdd)); }
+    LocalBdd& operator&=(const LocalBdd& other) { bdd = sylvan_and(bdd, other.bdd); return *this; }
+    LocalBdd operator+(const LocalBdd& other) const { return LocalBdd(sylvan_or(bdd, other.bdd)); }
+    LocalBdd& operator+=(const LocalBdd& other) { bdd = sylvan_or(bdd, other.bdd); return *this; }
+    LocalBdd operator|(const LocalBdd& other) const { return LocalBdd(sylvan_or(bdd, other.bdd)); }
+    LocalBdd& operator|=(const LocalBdd& other) { bdd = sylvan_or(bdd, other.bdd); return *this; }
+    LocalBdd operator^(const LocalBdd& other) const { return LocalBdd(sylvan_xor(bdd, other.bdd)); }
+    LocalBdd& operator^=(const LocalBdd& other) { bdd = sylvan_xor(bdd, other.bdd); return *this; }
+    LocalBdd operator-(const LocalBdd& other) const { return LocalBdd(sylvan_and(bdd, sylvan_not(other.bdd))); }
+    LocalBdd& operator-=(const LocalBdd& other) { bdd = sylvan_and(bdd, sylvan_not(other.bdd)); return *this; }
+
+    /**
+     * @brief Returns a (protected) Bdd with the same value
+     */
+    Bdd toBdd() const { return Bdd(bdd); }
+
+    /**
+     * @brief Gets the BDD of this LocalBdd (for C functions)
+     */
+    BDD GetBDD() const { return bdd; }
+
+private:
+    BDD bdd;
+};
+
 class BddSet
 {
     friend class Bdd;
@@ -527,6 +589,8 @@ public:
     Mtbdd() { mtbdd = sylvan_false; mtbdd_protect(&mtbdd); }
     Mtbdd(const MTBDD from) : mtbdd(from) { mtbdd_protect(&mtbdd); }
     Mtbdd(const Mtbdd &from) : mtbdd(from.mtbdd) { mtbdd_protect(&mtbdd); }
+    /* Protection is tied to the address, so a move still protects the new object */
+    Mtbdd(Mtbdd &&from) : mtbdd(from.mtbdd) { from.mtbdd = mtbdd_false; mtbdd_protect(&mtbdd); }
     Mtbdd(const Bdd &from) : mtbdd(from.bdd) { mtbdd_protect(&mtbdd); }
     ~Mtbdd() { mtbdd_unprotect(&mtbdd); }
 
@@ -595,6 +659,7 @@ public:
     int operator==(const Mtbdd& other) const;
     int operator!=(const Mtbdd& other) const;
     Mtbdd& operator=(const Mtbdd& right);
+    Mtbdd& operator=(Mtbdd&& right);
     Mtbdd operator!() const;
     Mtbdd operator~() const;
     Mtbdd operator*(const Mtbdd& other) const;
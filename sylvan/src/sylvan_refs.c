@@ -293,6 +293,32 @@ refs_next(refs_table_t *tbl, uint64_t **_bucket, size_t end)
     return result;
 }
 
+void
+refs_remap(refs_table_t *tbl, uint64_t (*f)(uint64_t))
+{
+    // collect all entries, then insert them again with their new values
+    size_t count = refs_count(tbl);
+    uint64_t *entries = (uint64_t*)malloc(sizeof(uint64_t[count+1]));
+    if (entries == NULL) {
+        fprintf(stderr, "refs: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    size_t n = 0;
+    uint64_t *bucket = tbl->refs_table;
+    uint64_t * const end = bucket + tbl->refs_size;
+    while (bucket != end) {
+        if (*bucket != 0 && *bucket != refs_ts) entries[n++] = *bucket;
+        bucket++;
+    }
+
+    memset(tbl->refs_table, 0, tbl->refs_size * sizeof(uint64_t));
+    for (size_t i=0; i<n; i++) {
+        uint64_t v = entries[i];
+        refs_rehash(tbl, f(v & 0x000000ffffffffff) | (v & 0xffffff0000000000));
+    }
+    free(entries);
+}
+
 void
 refs_create(refs_table_t *tbl, size_t _refs_size)
 {
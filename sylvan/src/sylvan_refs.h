@@ -56,6 +56,10 @@ uint64_t *refs_iter(refs_table_t *tbl, size_t first, size_t end);
 // Continue iterating, set bucket to next bucket or NULL
 uint64_t refs_next(refs_table_t *tbl, uint64_t **bucket, size_t end);
 
+// Replace every 40-bit value a by f(a), keeping the reference counts
+// Not thread-safe, for example for use during garbage collection
+void refs_remap(refs_table_t *tbl, uint64_t (*f)(uint64_t));
+
 // User must supply a pointer, refs_create and refs_free handle initialization/destruction
 void refs_create(refs_table_t *tbl, size_t _refs_size);
 void refs_free(refs_table_t *tbl);
@@ -36,7 +36,8 @@ pthread_key_t sylvan_stats_key;
 struct
 {
     int type; /* 0 for print line, 1 for simple counter, 2 for operation with CACHED and CACHEDPUT */
-              /* 3 for timer, 4 for report table data */
+              /* 3 for timer, 4 for report table data, 5 for cache levels of an operation id */
+              /* 6 for cache levels of all operation ids from id that have no name */
     int id;
     const char *key;
 } sylvan_report_info[] =
@@ -58,6 +59,8 @@ struct
     {2, BDD_AND_EXISTS, "BDD andexists"},
     {2, BDD_AND_PROJECT, "BDD andproject"},
     {2, BDD_RELNEXT, "BDD relnext"},
+    {2, BDD_RELNEXT_MINUS, "BDD relnext_minus"},
+    {2, BDD_RELNEXT_UNION, "BDD relnext_union"},
     {2, BDD_RELPREV, "BDD relprev"},
     {2, BDD_CLOSURE, "BDD closure"},
     {2, BDD_COMPOSE, "BDD compose"},
@@ -97,8 +100,63 @@ struct
     {2, LDD_SATCOUNTL, "LDD satcountl"},
     {2, LDD_ZIP, "LDD zip"},
     {2, LDD_RELPROD_UNION, "LDD relprod_union"},
+    {2, LDD_RELPROD_MINUS, "LDD relprod_minus"},
     {2, LDD_PROJECT_MINUS, "LDD project_minus"},
 
+    {0, 0, "Operation cache      L1 hit           L2 hit           Miss             L1 %   L2 %"},
+    {5, 0, "BDD ite"},
+    {5, 1, "BDD and"},
+    {5, 2, "BDD xor"},
+    {5, 3, "BDD exists"},
+    {5, 4, "BDD project"},
+    {5, 5, "BDD andexists"},
+    {5, 6, "BDD andproject"},
+    {5, 7, "BDD relnext"},
+    {5, 8, "BDD relprev"},
+    {5, 9, "BDD satcount"},
+    {5, 10, "BDD compose"},
+    {5, 11, "BDD restrict"},
+    {5, 12, "BDD constrain"},
+    {5, 13, "BDD closure"},
+    {5, 14, "BDD isbdd"},
+    {5, 15, "BDD support"},
+    {5, 16, "BDD pathcount"},
+    {5, 17, "BDD relnext_minus"},
+    {5, 18, "BDD relnext_union"},
+
+    {5, 20, "LDD relprod"},
+    {5, 21, "LDD minus"},
+    {5, 22, "LDD union"},
+    {5, 23, "LDD intersect"},
+    {5, 24, "LDD project"},
+    {5, 25, "LDD join"},
+    {5, 26, "LDD match"},
+    {5, 27, "LDD relprev"},
+    {5, 28, "LDD satcount"},
+    {5, 29, "LDD satcountl1"},
+    {5, 30, "LDD satcountl2"},
+    {5, 31, "LDD relprod_minus"},
+
+    {5, 40, "MTBDD binary apply"},
+    {5, 41, "MTBDD unary apply"},
+    {5, 42, "MTBDD abstract"},
+    {5, 43, "MTBDD ite"},
+    {5, 44, "MTBDD and_abs_plus"},
+    {5, 45, "MTBDD and_abs_max"},
+    {5, 46, "MTBDD support"},
+    {5, 47, "MTBDD compose"},
+    {5, 48, "MTBDD eq norm"},
+    {5, 49, "MTBDD eq norm rel"},
+    {5, 50, "MTBDD minimum"},
+    {5, 51, "MTBDD maximum"},
+    {5, 52, "MTBDD leq"},
+    {5, 53, "MTBDD less"},
+    {5, 54, "MTBDD geq"},
+    {5, 55, "MTBDD greater"},
+    {5, 56, "MTBDD eval_compose"},
+    {6, 64, NULL},
+    {5, SYLVAN_CACHE_OPS-1, "Other operations"},
+
     {0, 0, "Garbage collection"},
     {1, SYLVAN_GC_COUNT, "GC executions"},
     {3, SYLVAN_GC, "Total time spent"},
@@ -115,6 +173,7 @@ VOID_TASK_0(sylvan_stats_reset_perthread)
     for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
         sylvan_stats.timers[i] = 0;
     }
+    memset(sylvan_stats.cache, 0, sizeof(sylvan_stats.cache));
 #else
     sylvan_stats_t *sylvan_stats = pthread_getspecific(sylvan_stats_key);
     if (sylvan_stats == NULL) {
@@ -131,6 +190,7 @@ VOID_TASK_0(sylvan_stats_reset_perthread)
     for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
         sylvan_stats->timers[i] = 0;
     }
+    memset(sylvan_stats->cache, 0, sizeof(sylvan_stats->cache));
 #endif
 }
 
@@ -159,6 +219,11 @@ VOID_TASK_1(sylvan_stats_sum, sylvan_stats_t*, target)
     for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
         __sync_fetch_and_add(&target->timers[i], sylvan_stats.timers[i]);
     }
+    for (int i=0; i<SYLVAN_CACHE_OPS; i++) {
+        for (int j=0; j<SYLVAN_CACHE_COUNTER; j++) {
+            __sync_fetch_and_add(&target->cache[i][j], sylvan_stats.cache[i][j]);
+        }
+    }
 #else
     sylvan_stats_t *sylvan_stats = pthread_getspecific(sylvan_stats_key);
     if (sylvan_stats != NULL) {
@@ -168,6 +233,11 @@ VOID_TASK_1(sylvan_stats_sum, sylvan_stats_t*, target)
         for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
             __sync_fetch_and_add(&target->timers[i], sylvan_stats->timers[i]);
         }
+        for (int i=0; i<SYLVAN_CACHE_OPS; i++) {
+            for (int j=0; j<SYLVAN_CACHE_COUNTER; j++) {
+                __sync_fetch_and_add(&target->cache[i][j], sylvan_stats->cache[i][j]);
+            }
+        }
     }
 #endif
 }
@@ -209,6 +279,17 @@ to_h(double size, char *buf)
     return buf;
 }
 
+static void
+report_cache_levels(FILE *target, const char *key, const uint64_t *c)
+{
+    const uint64_t total = c[CACHE_L1_HIT] + c[CACHE_L2_HIT] + c[CACHE_MISS];
+    if (total > 0) {
+        fprintf(target, "%-20s %'-16"PRIu64 " %'-16"PRIu64" %'-16"PRIu64 " %5.1f  %5.1f\n", key,
+                c[CACHE_L1_HIT], c[CACHE_L2_HIT], c[CACHE_MISS],
+                100.0*c[CACHE_L1_HIT]/total, 100.0*c[CACHE_L2_HIT]/total);
+    }
+}
+
 void
 sylvan_stats_report(FILE *target)
 {
@@ -243,6 +324,14 @@ sylvan_stats_report(FILE *target)
             if (totals.counters[id] > 0) {
                 fprintf(target, "%-20s %'-16"PRIu64 " %'-16"PRIu64" %'-16"PRIu64 "\n", sylvan_report_info[i].key, totals.counters[id], totals.counters[id+1], totals.counters[id+2]);
             }
+        } else if (type == 5) {
+            report_cache_levels(target, sylvan_report_info[i].key, totals.cache[id]);
+        } else if (type == 6) {
+            for (int op=id; op<SYLVAN_CACHE_OPS-1; op++) {
+                char name[32];
+                sprintf(name, "Operation %d", op);
+                report_cache_levels(target, name, totals.cache[op]);
+            }
         } else if (type == 3) {
             if (totals.timers[id] > 0) {
                 fprintf(target, "%-20s %'.6Lf sec.\n", sylvan_report_info[i].key, (long double)totals.timers[id]/1000000000);
@@ -42,6 +42,8 @@ typedef enum {
     OPCOUNTER(BDD_AND_EXISTS),
     OPCOUNTER(BDD_AND_PROJECT),
     OPCOUNTER(BDD_RELNEXT),
+    OPCOUNTER(BDD_RELNEXT_MINUS),
+    OPCOUNTER(BDD_RELNEXT_UNION),
     OPCOUNTER(BDD_RELPREV),
     OPCOUNTER(BDD_SATCOUNT),
     OPCOUNTER(BDD_COMPOSE),
@@ -83,6 +85,7 @@ typedef enum {
     OPCOUNTER(LDD_SATCOUNTL),
     OPCOUNTER(LDD_ZIP),
     OPCOUNTER(LDD_RELPROD_UNION),
+    OPCOUNTER(LDD_RELPROD_MINUS),
     OPCOUNTER(LDD_PROJECT_MINUS),
 
     /* Other counters */
@@ -100,9 +103,25 @@ typedef enum
     SYLVAN_TIMER_COUNTER
 } Sylvan_Timers;
 
+/**
+ * Operation cache lookups per level, counted per operation id (the built-in
+ * operations in sylvan_int.h and fixed ids of applications below 512, all
+ * operations of cache_next_opid share the last slot).
+ */
+typedef enum
+{
+    CACHE_L1_HIT,
+    CACHE_L2_HIT,
+    CACHE_MISS,
+    SYLVAN_CACHE_COUNTER
+} Sylvan_Cache_Counters;
+
+#define SYLVAN_CACHE_OPS 513
+
 typedef struct
 {
     uint64_t counters[SYLVAN_COUNTER_COUNTER];
+    uint64_t cache[SYLVAN_CACHE_OPS][SYLVAN_CACHE_COUNTER];
     /* the timers are in ns */
     uint64_t timers[SYLVAN_TIMER_COUNTER];
     /* startstop is for internal use */
@@ -177,6 +196,22 @@ sylvan_stats_add(size_t counter, size_t amount)
 #endif
 }
 
+/**
+ * Count a cache lookup of level <level> for the cache key <a> (operation id | node)
+ */
+static inline void
+sylvan_stats_cache(uint64_t a, size_t level)
+{
+    uint64_t op = (a >> 40) & 0x7fffff;
+    if (op >= SYLVAN_CACHE_OPS) op = SYLVAN_CACHE_OPS-1;
+#ifdef __ELF__
+    sylvan_stats.cache[op][level]++;
+#else
+    sylvan_stats_t *sylvan_stats = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
+    sylvan_stats->cache[op][level]++;
+#endif
+}
+
 static inline void
 sylvan_timer_start(size_t timer)
 {
@@ -218,6 +253,13 @@ sylvan_stats_add(size_t counter, size_t amount)
     (void)amount;
 }
 
+static inline void
+sylvan_stats_cache(uint64_t a, size_t level)
+{
+    (void)a;
+    (void)level;
+}
+
 static inline void
 sylvan_timer_start(size_t timer)
 {
@@ -126,7 +126,7 @@ llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const
 {
     uint64_t hash_rehash = 14695981039346656037LLU;
     if (custom) hash_rehash = dbs->hash_cb(a, b, hash_rehash);
-    else hash_rehash = sylvan_tabhash16(a, b, hash_rehash);
+    else hash_rehash = sylvan_hash16(a, b, hash_rehash);
 
     const uint64_t step = (((hash_rehash >> 20) | 1) << 3);
     const uint64_t hash = hash_rehash & MASK_HASH;
@@ -214,27 +214,47 @@ llmsset_lookupc(const llmsset_t dbs, const uint64_t a, const uint64_t b, int* cr
     return llmsset_lookup2(dbs, a, b, created, 1);
 }
 
-int
-llmsset_rehash_bucket(const llmsset_t dbs, uint64_t d_idx)
+/**
+ * Hash of the node in bucket d_idx, as used to find its place in the hash array
+ */
+static inline uint64_t
+llmsset_rehash_hash(const llmsset_t dbs, uint64_t d_idx)
 {
     const uint64_t * const d_ptr = ((uint64_t*)dbs->data) + 2*d_idx;
     const uint64_t a = d_ptr[0];
     const uint64_t b = d_ptr[1];
 
     uint64_t hash_rehash = 14695981039346656037LLU;
-    const int custom = is_custom_bucket(dbs, d_idx) ? 1 : 0;
-    if (custom) hash_rehash = dbs->hash_cb(a, b, hash_rehash);
-    else hash_rehash = sylvan_tabhash16(a, b, hash_rehash);
+    if (is_custom_bucket(dbs, d_idx)) hash_rehash = dbs->hash_cb(a, b, hash_rehash);
+    else hash_rehash = sylvan_hash16(a, b, hash_rehash);
+    return hash_rehash;
+}
+
+/**
+ * First position in the hash array on the probe sequence of the given hash
+ */
+static inline uint64_t
+llmsset_rehash_first(const llmsset_t dbs, uint64_t hash_rehash)
+{
+#if LLMSSET_MASK
+    return hash_rehash & dbs->mask;
+#else
+    return hash_rehash % dbs->table_size;
+#endif
+}
+
+/**
+ * Insert bucket d_idx with hash hash_rehash into the hash array
+ */
+static int
+llmsset_rehash_insert(const llmsset_t dbs, uint64_t d_idx, uint64_t hash_rehash)
+{
     const uint64_t step = (((hash_rehash >> 20) | 1) << 3);
     const uint64_t new_v = (hash_rehash & MASK_HASH) | d_idx;
     int i=0;
 
     uint64_t idx, last;
-#if LLMSSET_MASK
-    last = idx = hash_rehash & dbs->mask;
-#else
-    last = idx = hash_rehash % dbs->table_size;
-#endif
+    last = idx = llmsset_rehash_first(dbs, hash_rehash);
 
     for (;;) {
         volatile uint64_t *bucket = &dbs->table[idx];
@@ -251,16 +271,17 @@ llmsset_rehash_bucket(const llmsset_t dbs, uint64_t d_idx)
 
             // go to next cache line in probe sequence
             hash_rehash += step;
-
-#if LLMSSET_MASK
-            last = idx = hash_rehash & dbs->mask;
-#else
-            last = idx = hash_rehash % dbs->table_size;
-#endif
+            last = idx = llmsset_rehash_first(dbs, hash_rehash);
         }
     }
 }
 
+int
+llmsset_rehash_bucket(const llmsset_t dbs, uint64_t d_idx)
+{
+    return llmsset_rehash_insert(dbs, d_idx, llmsset_rehash_hash(dbs, d_idx));
+}
+
 llmsset_t
 llmsset_create(size_t initial_size, size_t max_size)
 {
@@ -330,6 +351,9 @@ llmsset_create(size_t initial_size, size_t max_size)
     dbs->create_cb = NULL;
     dbs->destroy_cb = NULL;
 
+    dbs->compact_data = NULL;
+    dbs->compact_custom = NULL;
+
     // yes, ugly. for now, we use a global thread-local value.
     // that is a problem with multiple tables.
     // so, for now, do NOT use multiple tables!!
@@ -411,26 +435,57 @@ llmsset_mark(const llmsset_t dbs, uint64_t index)
     }
 }
 
+/**
+ * Number of buckets per leaf task of the parallel rehash (64 words of bitmap2,
+ * 64 KB of data). Leaves are aligned to this size, so every worker rehashes
+ * whole pages of the data array and whole cache lines of the bitmap.
+ */
+#define LLMSSET_REHASH_LEAF 4096
+
+/**
+ * Number of buckets whose hashes are computed (and the first cache line of their
+ * probe sequence prefetched) before they are inserted.
+ */
+#define LLMSSET_REHASH_BATCH 16
+
 TASK_3(int, llmsset_rehash_par, llmsset_t, dbs, size_t, first, size_t, count)
 {
-    if (count > 512) {
-        SPAWN(llmsset_rehash_par, dbs, first, count/2);
-        int bad = CALL(llmsset_rehash_par, dbs, first + count/2, count - count/2);
+    if (count > LLMSSET_REHASH_LEAF) {
+        size_t split = (count/2 + LLMSSET_REHASH_LEAF - 1) & ~(size_t)(LLMSSET_REHASH_LEAF - 1);
+        SPAWN(llmsset_rehash_par, dbs, first, split);
+        int bad = CALL(llmsset_rehash_par, dbs, first + split, count - split);
         return bad + SYNC(llmsset_rehash_par);
     } else {
         int bad = 0;
-        uint64_t *ptr = dbs->bitmap2 + (first / 64);
-        uint64_t mask = 0x8000000000000000LL >> (first & 63);
-        for (size_t k=0; k<count; k++) {
-            if (*ptr & mask) {
-                if (llmsset_rehash_bucket(dbs, first+k) == 0) bad++;
-            }
-            mask >>= 1;
-            if (mask == 0) {
-                ptr++;
-                mask = 0x8000000000000000LL;
+        uint64_t batch_idx[LLMSSET_REHASH_BATCH];
+        uint64_t batch_hash[LLMSSET_REHASH_BATCH];
+        int n = 0;
+
+        /* scan bitmap2 a word at a time, skip empty words */
+        const size_t end = first + count;
+        for (size_t w = first / 64; w * 64 < end; w++) {
+            uint64_t word = dbs->bitmap2[w];
+            if (w * 64 < first) word &= 0xffffffffffffffffLL >> (first - w * 64);
+            if (w * 64 + 64 > end) word &= ~(0xffffffffffffffffLL >> (end - w * 64));
+            while (word) {
+                const int bit = __builtin_clzll(word);
+                word &= ~(0x8000000000000000LL >> bit);
+                const uint64_t d_idx = w * 64 + bit;
+                const uint64_t hash = llmsset_rehash_hash(dbs, d_idx);
+                __builtin_prefetch(&dbs->table[llmsset_rehash_first(dbs, hash)], 1);
+                batch_idx[n] = d_idx;
+                batch_hash[n] = hash;
+                if (++n == LLMSSET_REHASH_BATCH) {
+                    for (int i=0; i<n; i++) {
+                        if (llmsset_rehash_insert(dbs, batch_idx[i], batch_hash[i]) == 0) bad++;
+                    }
+                    n = 0;
+                }
             }
         }
+        for (int i=0; i<n; i++) {
+            if (llmsset_rehash_insert(dbs, batch_idx[i], batch_hash[i]) == 0) bad++;
+        }
         return bad;
     }
 }
@@ -509,6 +564,63 @@ VOID_TASK_IMPL_1(llmsset_destroy_unmarked, llmsset_t, dbs)
     CALL(llmsset_destroy_par, dbs, 0, dbs->table_size);
 }
 
+VOID_TASK_IMPL_1(llmsset_compact_begin, llmsset_t, dbs)
+{
+    // the hash array maps old indices to new indices, 0 is "not claimed"
+    CALL(llmsset_clear_hashes, dbs);
+
+    // the count includes the forbidden positions 0 and 1, which keep their index
+    dbs->compact_live = CALL(llmsset_count_marked, dbs);
+    dbs->compact_next = 2;
+    dbs->compact_data = (uint8_t*)malloc(dbs->compact_live * 16);
+    dbs->compact_custom = (uint64_t*)calloc((dbs->compact_live + 63) / 64, sizeof(uint64_t));
+    if (dbs->compact_data == NULL || dbs->compact_custom == NULL) {
+        fprintf(stderr, "llmsset_compact_begin: Unable to allocate memory!\n");
+        exit(1);
+    }
+}
+
+uint64_t
+llmsset_compact_claim(const llmsset_t dbs, uint64_t index)
+{
+    if (!llmsset_is_marked(dbs, index)) {
+        fprintf(stderr, "llmsset_compact_claim: bucket %zu is not marked!\n", (size_t)index);
+        exit(1);
+    }
+    const uint64_t new_index = dbs->compact_next++;
+    dbs->table[index] = new_index;
+    if (is_custom_bucket(dbs, index)) {
+        dbs->compact_custom[new_index/64] |= 0x8000000000000000LL >> (new_index&63);
+    }
+    return new_index;
+}
+
+TASK_IMPL_1(size_t, llmsset_compact_end, llmsset_t, dbs)
+{
+    const size_t count = dbs->compact_next;
+
+    // clear bitmap1 and bitmap2 (and let workers claim new regions)
+    CALL(llmsset_clear_data, dbs);
+
+    if (mmap(dbs->bitmapc, dbs->max_size / 8, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != (void*)-1) {
+    } else {
+        memset(dbs->bitmapc, 0, dbs->max_size / 8);
+    }
+
+    // the renumbered buckets are [0, count)
+    memcpy(dbs->data + 2 * 16, dbs->compact_data + 2 * 16, (count - 2) * 16);
+    for (size_t w = 0; w < count / 64; w++) dbs->bitmap2[w] = 0xffffffffffffffffLL;
+    if (count & 63) dbs->bitmap2[count / 64] = ~(0xffffffffffffffffLL >> (count & 63));
+    memcpy(dbs->bitmapc, dbs->compact_custom, sizeof(uint64_t[(count + 63) / 64]));
+
+    free(dbs->compact_data);
+    free(dbs->compact_custom);
+    dbs->compact_data = NULL;
+    dbs->compact_custom = NULL;
+
+    return dbs->compact_live - count;
+}
+
 /**
  * Set custom functions
  */
@@ -67,6 +67,10 @@ typedef struct llmsset
     llmsset_create_cb create_cb;    // custom create function
     llmsset_destroy_cb destroy_cb;  // custom destroy function
     int16_t           threshold;    // number of iterations for insertion until returning error
+    uint8_t           *compact_data;   // renumbered data (during compaction)
+    uint64_t          *compact_custom; // renumbered "use custom functions" bitmap (during compaction)
+    size_t            compact_next;    // next index to assign (during compaction)
+    size_t            compact_live;    // number of marked buckets (during compaction)
 } *llmsset_t;
 
 /**
@@ -78,6 +82,17 @@ llmsset_index_to_ptr(const llmsset_t dbs, size_t index)
     return dbs->data + index * 16;
 }
 
+/**
+ * Prefetch the "contains data" bit and the data of the node at the given index,
+ * e.g. for the children of a node before marking them recursively.
+ */
+static inline void
+llmsset_prefetch(const llmsset_t dbs, size_t index)
+{
+    __builtin_prefetch(dbs->bitmap2 + index/64, 1);
+    __builtin_prefetch(dbs->data + index * 16, 0);
+}
+
 /**
  * Create the set.
  * This will allocate a set of <max_size> buckets in virtual memory.
@@ -195,6 +210,52 @@ TASK_DECL_1(size_t, llmsset_count_marked, llmsset_t);
 VOID_TASK_DECL_1(llmsset_destroy_unmarked, llmsset_t);
 #define llmsset_destroy_unmarked(dbs) RUN(llmsset_destroy_unmarked, dbs)
 
+/**
+ * Compaction: move all marked buckets to the start of the table, in a new order.
+ *
+ * 1) call llmsset_compact_begin after marking (see llmsset_clear_data and llmsset_mark)
+ * 2) call llmsset_compact_claim for every marked bucket, in the new order, and
+ *    llmsset_compact_set with its data translated to the new indices
+ * 3) call llmsset_compact_end, then llmsset_clear_hashes and llmsset_rehash
+ *
+ * The hash array is used to map old indices to new indices in the meantime,
+ * so llmsset_lookup is not allowed until the buckets are rehashed.
+ */
+VOID_TASK_DECL_1(llmsset_compact_begin, llmsset_t);
+#define llmsset_compact_begin(dbs) RUN(llmsset_compact_begin, dbs)
+
+/**
+ * Retrieve the new index of the marked bucket <index>, or 0 if not yet claimed.
+ */
+static inline uint64_t
+llmsset_compact_get(const llmsset_t dbs, uint64_t index)
+{
+    return dbs->table[index];
+}
+
+/**
+ * Assign the next new index to the marked bucket <index> and return it.
+ */
+uint64_t llmsset_compact_claim(const llmsset_t dbs, uint64_t index);
+
+/**
+ * Set the data of the bucket with the new index <new_index>.
+ */
+static inline void
+llmsset_compact_set(const llmsset_t dbs, uint64_t new_index, uint64_t a, uint64_t b)
+{
+    uint64_t *d_ptr = (uint64_t*)(dbs->compact_data + new_index * 16);
+    d_ptr[0] = a;
+    d_ptr[1] = b;
+}
+
+/**
+ * Replace the data of the table by the renumbered data.
+ * Returns the number of buckets that were marked but not claimed (should be 0).
+ */
+TASK_DECL_1(size_t, llmsset_compact_end, llmsset_t);
+#define llmsset_compact_end(dbs) RUN(llmsset_compact_end, dbs)
+
 /**
  * Set custom functions
  */
@@ -94,6 +94,23 @@ test_cache()
         test_assert(res == 0 || val == arr[4*i+3]);
     }
 
+    /**
+     * Test entries with small node indices (as in cache_put3), some with
+     * complement marks and some with a 64-bit result
+     */
+    for (size_t i=0; i<number_add; i++) {
+        uint64_t a = ((uint64_t)(i & 0xff) << 40) | (arr[4*i] & 0x800000007fffffffLL);
+        uint64_t b = arr[4*i+1] & 0x800000007fffffffLL;
+        uint64_t c = (i & 1) ? 0 : (arr[4*i+2] & 0x7fffffff);
+        uint64_t r = (i & 7) ? (arr[4*i+3] & 0x800000007fffffffLL) : arr[4*i+3];
+        test_assert(cache_put(a, b, c, r));
+        uint64_t val;
+        test_assert(cache_get(a, b, c, &val) == 1);
+        test_assert(val == r);
+        // same key with another operation id is a different entry
+        test_assert(cache_get(a + (1LL<<40), b, c, &val) == 0 || val != r);
+    }
+
     /**
      * TODO: multithreaded test
      */
@@ -365,6 +382,27 @@ test_relprod()
     test_assert(sylvan_relprev(t, zeroes, all_vars_set) == zeroes);
     test_assert(sylvan_relnext(sylvan_not(zeroes), t, all_vars_set) == sylvan_false);
 
+    // relnext_minus(s, t, vars, v) == relnext(s, t, vars) \ v, for full and partial relations
+    // relnext_union(s, t, vars, v) == relnext(s, t, vars) \or v, likewise
+    BDDSET odd_vars = sylvan_set_fromarray(((BDDVAR[]){1,3,5,7,9}), 5);
+    BDDSET rel_vars[2];
+    rel_vars[0] = sylvan_set_fromarray(((BDDVAR[]){0,1,2,3,4,5,6,7,8,9}), 10);
+    rel_vars[1] = sylvan_set_fromarray(((BDDVAR[]){2,3,6,7}), 4);
+    for (int i=0; i<100; i++) {
+        t = make_random(0, 10);
+        s = sylvan_exists(make_random(0, 10), odd_vars);
+        BDD v = sylvan_exists(make_random(0, 10), odd_vars);
+        for (int k=0; k<2; k++) {
+            next = sylvan_relnext(s, t, rel_vars[k]);
+            test_assert(testEqual(sylvan_relnext_minus(s, t, rel_vars[k], v), sylvan_diff(next, v)));
+            test_assert(testEqual(sylvan_relnext_minus(s, t, rel_vars[k], next), sylvan_false));
+            test_assert(testEqual(sylvan_relnext_minus(s, t, rel_vars[k], sylvan_false), next));
+            test_assert(testEqual(sylvan_relnext_union(s, t, rel_vars[k], v), sylvan_or(next, v)));
+            test_assert(testEqual(sylvan_relnext_union(s, t, rel_vars[k], s), sylvan_or(next, s)));
+            test_assert(testEqual(sylvan_relnext_union(s, t, rel_vars[k], sylvan_false), next));
+        }
+    }
+
     return 0;
 }
 
@@ -504,11 +542,103 @@ test_ldd()
         states = make_random_ldd_set(2, 10, 10);
         MDD states2 = make_random_ldd_set(2, 10, 10);
         test_assert(lddmc_union(states, states2) == lddmc_relprod_union(states, rel, meta, states2));
+
+        // relprod_minus(states, rel, meta, avoid) == relprod(states, rel, meta) \ avoid
+        MDD metas[2];
+        metas[0] = lddmc_cube((uint32_t[]){1,2,3,0}, 4);
+        metas[1] = lddmc_cube((uint32_t[]){4,0,1,2}, 4);
+        for (int k=0; k<2; k++) {
+            states = make_random_ldd_set(3, 5, 20);
+            rel = make_random_ldd_set(3, 5, 10);
+            MDD avoid = make_random_ldd_set(3, 5, 40);
+            MDD succ = lddmc_relprod(states, rel, metas[k]);
+            test_assert(lddmc_relprod_minus(states, rel, metas[k], avoid) == lddmc_minus(succ, avoid));
+            test_assert(lddmc_relprod_minus(states, rel, metas[k], succ) == lddmc_false);
+        }
+        states = make_random_ldd_set(2, 10, 10);
+        rel = lddmc_cube_copy((uint32_t[]){0,0}, (int[]){1,1}, 2);
+        meta = lddmc_cube((uint32_t[]){4,4}, 2);
+        test_assert(lddmc_relprod_minus(states, rel, meta, states2) == lddmc_minus(states, states2));
     }
 
     return 0;
 }
 
+int
+test_compact()
+{
+    // roots of every kind: protected variables, pointer and value stacks, references
+    BDD a = make_random(0, 16);
+    BDD b = make_random(0, 16);
+    BDD c = make_random(0, 16);
+    sylvan_protect(&a);
+    sylvan_protect(&b);
+    bdd_refs_pushptr(&b); // also protected
+    bdd_refs_pushptr(&c);
+    bdd_refs_push(sylvan_or(b, c));
+    BDD ab = sylvan_and(a, b);
+    BDD bc = sylvan_xor(b, c);
+    sylvan_protect(&ab);
+    sylvan_protect(&bc);
+    sylvan_deref(a);
+    sylvan_deref(b);
+    sylvan_deref(c);
+    sylvan_ref(sylvan_not(sylvan_and(a, c)));
+
+    MDD m = make_random_ldd_set(4, 10, 50);
+    lddmc_protect(&m);
+    MDD l = make_random_ldd_set(4, 10, 50);
+    lddmc_protect(&l);
+    lddmc_ref(lddmc_union(m, l));
+    MDD ml = lddmc_minus(m, l);
+    lddmc_protect(&ml);
+    // a long sibling chain, renumbered in a loop
+    MDD wide = lddmc_false;
+    for (int i=65535; i>=0; i--) wide = lddmc_makenode(i, lddmc_true, wide);
+    lddmc_protect(&wide);
+
+    const double count_a = sylvan_satcount(a, sylvan_set_fromarray(((BDDVAR[]){0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}), 16));
+    const double count_m = lddmc_satcount(m);
+    const size_t refs = sylvan_count_refs() + lddmc_count_refs();
+
+    sylvan_gc();
+    const size_t live = sylvan_gc_last_info()->nodes_after;
+
+    sylvan_gc_compact();
+    const sylvan_gc_info_t *info = sylvan_gc_last_info();
+    test_assert(info->trigger == SYLVAN_GC_COMPACT);
+    test_assert(info->nodes_after == live);
+    // the live nodes are the first buckets of the table
+    for (size_t i=0; i<live; i++) test_assert(llmsset_is_marked(nodes, i));
+    test_assert(!llmsset_is_marked(nodes, live));
+
+    // all roots are rewritten and the renumbered nodes are found again
+    test_assert(sylvan_count_refs() + lddmc_count_refs() == refs);
+    test_assert(sylvan_satcount(a, sylvan_set_fromarray(((BDDVAR[]){0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}), 16)) == count_a);
+    test_assert(testEqual(sylvan_and(a, b), ab));
+    test_assert(testEqual(sylvan_xor(b, c), bc));
+    test_assert(lddmc_satcount(m) == count_m);
+    test_assert(lddmc_minus(m, l) == ml);
+    test_assert(lddmc_satcount(wide) == 65536);
+    test_assert(lddmc_makenode(0, lddmc_true, lddmc_getright(wide)) == wide);
+
+    sylvan_gc();
+    test_assert(sylvan_gc_last_info()->nodes_after == live);
+
+    bdd_refs_pop(1);
+    bdd_refs_popptr(2);
+    sylvan_unprotect(&a);
+    sylvan_unprotect(&b);
+    sylvan_unprotect(&ab);
+    sylvan_unprotect(&bc);
+    lddmc_unprotect(&m);
+    lddmc_unprotect(&l);
+    lddmc_unprotect(&ml);
+    lddmc_unprotect(&wide);
+
+    return 0;
+}
+
 int runtests()
 {
     // we are not testing garbage collection
@@ -530,6 +660,13 @@ int runtests()
     printf("Testing ldd.\n");
     if (test_ldd()) return 1;
 
+    printf("Testing compacting garbage collection.\n");
+    sylvan_gc_enable();
+    sylvan_gc_count_nodes(1);
+    if (test_compact()) return 1;
+    sylvan_gc_count_nodes(0);
+    sylvan_gc_disable();
+
     return 0;
 }
 
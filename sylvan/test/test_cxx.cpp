@@ -3,6 +3,7 @@
  */
 
 #include <assert.h>
+#include <thread>
 #include <sylvan.h>
 #include <sylvan_obj.hpp>
 
@@ -36,6 +37,63 @@ int runtest()
     return 0;
 }
 
+/* The result is created before nb is destroyed, so nb is not on top of the refs stack */
+static LocalBdd local_and_not(const LocalBdd& a, const LocalBdd& b)
+{
+    LocalBdd nb = !b;
+    return a & nb;
+}
+
+int test_local()
+{
+    LocalBdd v1 = Bdd::bddVar(1);
+    LocalBdd v2 = Bdd::bddVar(2);
+
+    LocalBdd t = v1 | v2;
+    {
+        LocalBdd u = v1;
+        u += v2;
+        test_assert(t == u);
+    }
+    Bdd b = (t & v1).toBdd();
+    test_assert(b == Bdd::bddVar(1));
+
+    // LocalBdd values of this (non-worker) thread survive garbage collection
+    LocalBdd x = !(v1 ^ v2);
+    sylvan_gc();
+    test_assert(mtbdd_test_isvalid(x.GetBDD()));
+    test_assert((x & v1) == (v1 & v2));
+
+    // destruction out of creation order
+    LocalBdd y = local_and_not(x, v2);
+    sylvan_gc();
+    test_assert(mtbdd_test_isvalid(y.GetBDD()));
+    test_assert(mtbdd_test_isvalid(x.GetBDD()));
+    test_assert(y == (x - v2));
+
+    // a thread that is not a Lace worker releases its stacks before it exits
+    Bdd z;
+    std::thread thread([&z, &v1, &v2]() {
+        {
+            LocalBdd w = v1.toBdd() ^ v2.toBdd();
+            z = w.toBdd();
+        }
+        bdd_refs_thread_exit();
+    });
+    thread.join();
+    sylvan_gc();
+    test_assert(z == (v1 ^ v2).toBdd());
+
+    Bdd m1 = Bdd::bddVar(3);
+    Bdd m2(std::move(m1));
+    test_assert(m1 == Bdd::bddZero());
+    test_assert(m2 == Bdd::bddVar(3));
+    m1 = std::move(m2);
+    test_assert(m1 == Bdd::bddVar(3));
+
+    return 0;
+}
+
 void test6()
 {
     BddMap m1;
@@ -55,6 +113,7 @@ int main()
     test6();
 
     int res = runtest();
+    if (res == 0) res = test_local();
 
     sylvan_quit();
     lace_stop();